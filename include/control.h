@@ -54,6 +54,7 @@ struct CommandLineArguments {
 	bool noconsole;
 	bool startmapper;
 	bool exit;
+	bool headless;
 	bool securemode;
 	bool noautoexec;
 	std::string working_dir;
@@ -92,6 +92,23 @@ Bits CPU_Core_Prefetch_Trap_Run() noexcept;
 
 void CPU_Reset_AutoAdjust(void);
 
+// Code cache counters of the dynamic core, shown by the debugger
+struct DynamicCoreCacheStats {
+	uint64_t blocks_created     = 0;
+	uint64_t blocks_evicted     = 0;
+	uint64_t blocks_spared      = 0; // recently used blocks skipped by eviction
+	uint64_t smc_invalidations  = 0; // blocks cleared by self-modifying code
+	uint64_t links              = 0;
+	uint64_t unlinks            = 0;
+	uint64_t cache_growths      = 0;
+	size_t cache_size_bytes     = 0;
+	size_t cache_max_size_bytes = 0;
+};
+
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+DynamicCoreCacheStats CPU_GetDynamicCoreCacheStats();
+#endif
+
 
 //CPU Stuff
 
@@ -64,6 +64,16 @@ public:
 
 	DMA_Callback callback = {};
 
+	// Running totals of the data moved by the channel, to see which devices
+	// make the heaviest use of DMA. READ transfers move guest memory to the
+	// device and WRITE transfers the other way around.
+	struct Statistics {
+		uint64_t bytes_read    = 0;
+		uint64_t bytes_written = 0;
+		uint64_t num_transfers = 0;
+	};
+	Statistics stats = {};
+
 	DmaChannel(uint8_t num, bool dma16);
 	~DmaChannel();
 
@@ -89,6 +99,7 @@ public:
 private:
 	void EvictReserver();
 	bool HasReservation() const;
+	void LogStatistics() const;
 	size_t ReadOrWrite(DMA_DIRECTION direction, size_t words,
 	                   uint8_t* const buffer);
 
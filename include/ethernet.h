@@ -74,6 +74,9 @@ public:
 	 * instead of jumping around between functions and sharing global state.
 	 * This function does not define the state of the packet data outside
 	 * the callback. Copy the packet data if you need to use it later.
+	 * The callback returns a negative value if the frame was meant for
+	 * the card but it had no room for it, so the connection can count it
+	 * as dropped.
 	 * @param callback The function called for each pending packet
 	 */
 	virtual void GetPackets(std::function<int(const uint8_t *, int)> callback) = 0;
@@ -92,4 +95,15 @@ public:
  */
 EthernetConnection *ETHERNET_OpenConnection(const std::string &backend);
 
+/** Overrides the connections ETHERNET_OpenConnection creates.
+ * This lets tests and benchmarks stand in their own connection, such as
+ * a loopback that injects and collects frames, for the real backend.
+ * The factory's connection must already be initialized; its ownership
+ * passes to the caller of ETHERNET_OpenConnection as usual.
+ * Pass an empty factory to go back to the real backends.
+ * @param factory The function creating the connections
+ */
+using EthernetConnectionFactory = std::function<EthernetConnection *()>;
+void ETHERNET_SetConnectionFactory(EthernetConnectionFactory factory);
+
 #endif
@@ -72,6 +72,34 @@ void IO_FreeWriteHandler(io_port_t port,
                          io_width_t max_width,
                          io_port_t range = 1);
 
+// Optional block IO handlers let a port move a run of same-sized units per
+// REP INS or REP OUTS instruction in one call, such as the sector data of a
+// disk controller. The buffer holds the units in guest (little-endian) byte
+// order. Handlers return the number of units they moved, which may be fewer
+// than requested (or zero); the remainder then goes through the regular
+// handlers one unit at a time.
+//
+// A block handler belongs to the port's regular handler, which must be
+// registered first. It's dropped when that handler is freed or replaced.
+using io_block_read_f = std::function<size_t(io_port_t port, io_width_t width,
+                                             uint8_t* buffer, size_t num_units)>;
+using io_block_write_f = std::function<size_t(io_port_t port, io_width_t width,
+                                              const uint8_t* buffer, size_t num_units)>;
+
+void IO_RegisterBlockReadHandler(io_port_t port, io_block_read_f handler);
+void IO_RegisterBlockWriteHandler(io_port_t port, io_block_write_f handler);
+void IO_FreeBlockReadHandler(io_port_t port);
+void IO_FreeBlockWriteHandler(io_port_t port);
+
+// Moves up to 'num_units' between the port and the buffer through the port's
+// block handler, applying the IO delay for all of them at once. Returns the
+// number of units moved, which is zero if the port has no block handler or
+// the access has to be trapped.
+size_t IO_ReadBlock(io_port_t port, io_width_t width, uint8_t* buffer,
+                    size_t num_units);
+size_t IO_WriteBlock(io_port_t port, io_width_t width, const uint8_t* buffer,
+                     size_t num_units);
+
 /* Classes to manage the IO objects created by the various devices.
  * The io objects will remove itself on destruction.*/
 class IO_Base{
@@ -103,6 +131,19 @@ public:
 	~IO_WriteHandleObject();
 };
 
+class IO_BlockReadHandleObject : private IO_Base {
+public:
+	void Install(io_port_t port, io_block_read_f handler);
+	void Uninstall();
+	~IO_BlockReadHandleObject();
+};
+class IO_BlockWriteHandleObject : private IO_Base {
+public:
+	void Install(io_port_t port, io_block_write_f handler);
+	void Uninstall();
+	~IO_BlockWriteHandleObject();
+};
+
 static inline void IO_Write(io_port_t port, uint8_t val)
 {
 	IO_WriteB(port,val);
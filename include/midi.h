@@ -209,31 +209,14 @@ void MIDI_RawOutByte(uint8_t data);
 void MIDI_Mute();
 void MIDI_Unmute();
 
+// A unit of work for a synth's render thread. Channel messages are carried
+// inline; SysEx payloads travel separately (see MidiWorkFifo) so queueing
+// work never allocates.
 struct MidiWork {
-	std::vector<uint8_t> message      = {};
+	MidiMessage message               = {};
+	uint16_t sysex_size               = 0;
 	uint16_t num_pending_audio_frames = 0;
 	MessageType message_type          = {};
-
-	// Default value constructor
-	MidiWork()                      = default;
-	MidiWork(MidiWork&&)            = default;
-	MidiWork& operator=(MidiWork&&) = default;
-
-	// Construct from movable values
-	MidiWork(std::vector<uint8_t>&& _message,
-	         const uint16_t _num_audio_frames_pending,
-	         const MessageType _message_type)
-	        : message(std::move(_message)),
-	          num_pending_audio_frames(_num_audio_frames_pending),
-	          message_type(_message_type)
-	{
-		// leave the source in a valid state
-		_message.clear();
-	}
-
-	// Prevent copy construction
-	MidiWork(const MidiWork&)            = delete;
-	MidiWork& operator=(const MidiWork&) = delete;
 };
 
 #if C_FLUIDSYNTH
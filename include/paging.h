@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 #include "debug.h"
+#include <array>
 #include <vector>
 
 #include "mem.h"
@@ -36,6 +37,11 @@ class PageDirectory;
 
 #if defined(USE_FULL_TLB)
 #define TLB_SIZE		(1024*1024)
+// the page handlers and physical pages are kept in second-level tables
+#define TLB_LEAF_SHIFT	10
+#define TLB_LEAF_SIZE	(1 << TLB_LEAF_SHIFT)
+#define TLB_LEAF_MASK	(TLB_LEAF_SIZE - 1)
+#define TLB_LEAVES		(TLB_SIZE / TLB_LEAF_SIZE)
 #else
 #define TLB_SIZE		65536	// This must a power of 2 and greater then LINK_START
 #define BANK_SHIFT		28
@@ -192,7 +198,16 @@ struct X86PageEntry {
 	}
 };
 
-#if !defined(USE_FULL_TLB)
+#if defined(USE_FULL_TLB)
+// Second-level table of the TLB, only allocated once a page in its range gets
+// linked; the tables of ranges without linked pages are all shared.
+struct TlbLeaf {
+	PageHandler* readhandler[TLB_LEAF_SIZE]  = {};
+	PageHandler* writehandler[TLB_LEAF_SIZE] = {};
+
+	uint32_t phys_page[TLB_LEAF_SIZE] = {};
+};
+#else
 typedef struct {
 	HostPt read  = {};
 	HostPt write = {};
@@ -213,14 +228,16 @@ struct PagingBlock {
 	} base = {};
 #if defined(USE_FULL_TLB)
 	struct {
-		HostPt read[TLB_SIZE]  = {};
-		HostPt write[TLB_SIZE] = {};
-
-		std::vector<PageHandler*> readhandler  = std::vector<PageHandler*>(TLB_SIZE);
-		std::vector<PageHandler*> writehandler = std::vector<PageHandler*>(TLB_SIZE);
-
-		std::vector<uint32_t> phys_page = std::vector<uint32_t>(TLB_SIZE);
-	} tlb = {};
+		// Flat for the fastest possible lookup (the dynamic core even
+		// indexes them from its generated code). Deliberately left without
+		// initializer: as static storage they start out zeroed, and only
+		// the entries of linked pages are ever written, so the untouched
+		// parts never become resident.
+		HostPt read[TLB_SIZE];
+		HostPt write[TLB_SIZE];
+
+		std::array<TlbLeaf*, TLB_LEAVES> leaves = {};
+	} tlb;
 #else
 	std::vector<tlb_entry> tlbh        = std::vector<tlb_entry>(TLB_SIZE);
 	std::vector<tlb_entry*> tlbh_banks = std::vector<tlb_entry*>(TLB_BANKS);
@@ -275,20 +292,23 @@ static inline HostPt get_tlb_read(PhysPt address)
 static inline HostPt get_tlb_write(PhysPt address) {
 	return paging.tlb.write[address>>12];
 }
+static inline TlbLeaf* get_tlb_leaf(PhysPt address) {
+	return paging.tlb.leaves[address >> (12 + TLB_LEAF_SHIFT)];
+}
 static inline PageHandler* get_tlb_readhandler(PhysPt address) {
-	return paging.tlb.readhandler[address>>12];
+	return get_tlb_leaf(address)->readhandler[(address >> 12) & TLB_LEAF_MASK];
 }
 static inline PageHandler* get_tlb_writehandler(PhysPt address) {
-	return paging.tlb.writehandler[address>>12];
+	return get_tlb_leaf(address)->writehandler[(address >> 12) & TLB_LEAF_MASK];
 }
 
 /* Use these helper functions to access linear addresses in readX/writeX functions */
 static inline PhysPt PAGING_GetPhysicalPage(PhysPt linePage) {
-	return (paging.tlb.phys_page[linePage>>12]<<12);
+	return (get_tlb_leaf(linePage)->phys_page[(linePage >> 12) & TLB_LEAF_MASK] << 12);
 }
 
 static inline PhysPt PAGING_GetPhysicalAddress(PhysPt linAddr) {
-	return (paging.tlb.phys_page[linAddr>>12]<<12)|(linAddr&0xfff);
+	return PAGING_GetPhysicalPage(linAddr) | (linAddr & 0xfff);
 }
 
 #else  // not USE_FULL_TLB
@@ -41,8 +41,11 @@
 #include <deque>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <vector>
 
+#include "spsc_queue.h"
+
 template <typename T>
 class RWQueue {
 private:
@@ -143,4 +146,97 @@ public:
 	bool BulkDequeue(std::vector<T>& into_target, const size_t num_requested);
 };
 
+/*  SPSC (Single-Producer/Single-Consumer) RW Queue
+ *  ------------------------------------------------
+ *  A lock-free variant of the RW Queue for a fixed pair of threads, such as the
+ *  emulation thread feeding a synthesizer's rendering thread, which in turn
+ *  feeds the mixer.
+ *
+ *  Items live in an SpscRing (see spsc_queue.h), and are moved in and out in
+ *  place; this class only adds blocking on top. Neither side takes a lock; a thread only goes to sleep (using an atomic
+ *  wait, i.e., a futex on Linux) when the queue is empty for the consumer or
+ *  full for the producer, and is woken up only if it's actually waiting.
+ *
+ *  Only one thread may enqueue and only one thread may dequeue at a time.
+ *  Resizing must be done while neither is using the queue.
+ *
+ *  The interface and the semantics on stopping match the RW Queue's, except
+ *  that the bulk operations work directly on spans of the caller's items.
+ */
+template <typename T>
+class SpscRWQueue {
+private:
+	static constexpr size_t CacheLineSize = 64;
+
+	// Waiting relies on the ring's positions being sequentially consistent
+	SpscRing<std::vector<T>, std::memory_order_seq_cst> ring = {};
+
+	// Waiting threads sleep on these signals, and are woken up by bumping
+	// them once the number of items (or room) they want is available
+	alignas(CacheLineSize) std::atomic<uint32_t> has_items_signal = 0;
+	std::atomic<size_t> num_items_wanted                         = 0;
+
+	alignas(CacheLineSize) std::atomic<uint32_t> has_room_signal = 0;
+	std::atomic<size_t> room_wanted                             = 0;
+
+	std::atomic<bool> is_running = true;
+
+	size_t WaitForItems(const size_t num_wanted);
+	size_t WaitForRoom(const size_t num_wanted);
+	void NotifyItems();
+	void NotifyRoom();
+
+public:
+	SpscRWQueue()                                          = delete;
+	SpscRWQueue(const SpscRWQueue<T>& other)               = delete;
+	SpscRWQueue<T>& operator=(const SpscRWQueue<T>& other) = delete;
+
+	SpscRWQueue(size_t queue_capacity);
+	void Resize(size_t queue_capacity);
+
+	// non-blocking call
+	bool IsEmpty() const;
+
+	// non-blocking call
+	bool IsRunning() const;
+
+	// non-blocking call
+	size_t Size() const;
+
+	// non-blocking call
+	void Start();
+
+	// non-blocking call
+	void Stop();
+
+	// non-blocking call
+	size_t MaxCapacity() const;
+
+	// non-blocking call
+	float GetPercentFull() const;
+
+	// Potentially blocks until the queue has room for the item; returns
+	// false without queueing it if queueing has stopped.
+	bool Enqueue(T&& item);
+
+	// Potentially blocks until an item is available. Once stopped, returns
+	// the remaining items followed by empty results.
+	std::optional<T> Dequeue();
+
+	// Items are moved out of the span into the queue, potentially blocking
+	// until all of them fit. Returns false if queueing stopped before all
+	// items were queued.
+	bool BulkEnqueue(std::span<T> from_source);
+
+	// Items are moved from the queue into the span, potentially blocking
+	// until it's filled. Once stopped, only the remaining items are moved.
+	// Returns the number of items dequeued.
+	size_t BulkDequeue(std::span<T> into_target);
+
+	// Non-blocking variants; they move as many items as possible and
+	// return that count.
+	size_t NonblockingBulkEnqueue(std::span<T> from_source);
+	size_t NonblockingBulkDequeue(std::span<T> into_target);
+};
+
 #endif
@@ -23,6 +23,7 @@
 
 #include "SDL.h"
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <string>
@@ -269,6 +270,18 @@ struct SDL_Block {
 		GLuint displaylist;
 		GLint max_texsize;
 		bool npot_textures_supported = false;
+		bool use_presentation_thread = false;
+		bool use_pbos                = false;
+		bool pbos_supported          = false;
+
+		// Pixel buffer object the frames are rendered into
+		struct {
+			GLuint buffer     = 0;
+			GLsync fence      = nullptr;
+			size_t size_bytes = 0;
+			bool is_mapped    = false;
+		} pbo = {};
+
 		bool use_shader;
 		bool framebuffer_is_srgb_encoded;
 		GLuint program_object;
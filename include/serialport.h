@@ -266,6 +266,11 @@ public:
 	void receiveByte(uint8_t data);
 	void receiveByteEx(uint8_t data, uint8_t error);
 
+	// Receives error-free bytes in one go, as many as the FIFO collects
+	// before raising its receive interrupt and at least one. Returns how
+	// many were taken; wait that many byte times before sending more.
+	size_t receiveBytes(const uint8_t *data, const size_t n);
+
 	// If an error was received, put it here (in LSR register format)
 	void receiveError(uint8_t errorword);
 
@@ -0,0 +1,238 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SPSC_QUEUE_H
+#define DOSBOX_SPSC_QUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+
+// The capacity of std::array storage, or zero for resizable storage
+template <typename Storage>
+inline constexpr size_t spsc_fixed_capacity = 0;
+
+template <typename T, size_t N>
+inline constexpr size_t spsc_fixed_capacity<std::array<T, N>> = N;
+
+// Lock-free ring shared by the single-producer/single-consumer queues below
+// and SpscRWQueue. Each side owns one free-running position (only their
+// difference wraps around) on its own cache line, and publishes it to the
+// other side once it's done with the items in between.
+//
+// The storage is either a std::array, fixing the capacity at compile time, or
+// a std::vector sized by Resize(). Its size must be a power of two so the
+// positions can be wrapped with a mask; a resized ring rounds it up and keeps
+// the requested capacity.
+//
+// The sides normally only synchronize through release and acquire ordering.
+// Rings that sleep until the other side has moved (see SpscRWQueue) need
+// their positions to be sequentially consistent instead.
+//
+template <typename Storage, std::memory_order PositionOrder = std::memory_order_release>
+class SpscRing {
+public:
+	using T = typename Storage::value_type;
+
+	static_assert(spsc_fixed_capacity<Storage> == 0 ||
+	                      std::has_single_bit(spsc_fixed_capacity<Storage>),
+	              "The capacity must be a power of two");
+
+	SpscRing() = default;
+
+	SpscRing(const SpscRing&)            = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// Drops any queued items; only call while neither side is active
+	void Resize(const size_t new_capacity)
+	{
+		static_assert(FixedCapacity == 0, "Only resizable storage can be resized");
+		assert(new_capacity > 0);
+
+		items.clear();
+		items.resize(std::bit_ceil(new_capacity));
+		capacity = new_capacity;
+
+		write_pos = 0;
+		read_pos  = 0;
+	}
+
+	// Producer side; returns nullptr if the ring is full
+	T* GetWriteSlot()
+	{
+		if (GetFreeSpace() == 0) {
+			return nullptr;
+		}
+		return &items[write_pos.load(std::memory_order_relaxed) & GetIndexMask()];
+	}
+
+	void Push()
+	{
+		const auto tail = write_pos.load(std::memory_order_relaxed);
+		write_pos.store(tail + 1, PositionOrder);
+	}
+
+	// Producer side; moves (or copies) in as many of the items as fit, and
+	// returns that count
+	template <typename InputIt>
+	size_t Write(const InputIt source, const size_t num_items)
+	{
+		const auto tail  = write_pos.load(std::memory_order_relaxed);
+		const auto count = std::min(num_items, GetFreeSpace());
+
+		// Two runs, split where the ring wraps
+		const auto start = tail & GetIndexMask();
+		const auto first = std::min(count, items.size() - start);
+
+		std::copy_n(source, first, items.begin() + start);
+		std::copy_n(std::next(source, first), count - first, items.begin());
+
+		write_pos.store(tail + count, PositionOrder);
+		return count;
+	}
+
+	// Consumer side; returns nullptr if the ring is empty
+	T* Front()
+	{
+		if (GetNumQueued() == 0) {
+			return nullptr;
+		}
+		return &items[read_pos.load(std::memory_order_relaxed) & GetIndexMask()];
+	}
+
+	void Pop()
+	{
+		const auto head = read_pos.load(std::memory_order_relaxed);
+		read_pos.store(head + 1, PositionOrder);
+	}
+
+	// Consumer side; moves out as many items as are available (up to the
+	// given maximum), and returns that count
+	template <typename OutputIt>
+	size_t Read(const OutputIt target, const size_t max_items)
+	{
+		const auto head  = read_pos.load(std::memory_order_relaxed);
+		const auto count = std::min(max_items, GetNumQueued());
+
+		const auto start = head & GetIndexMask();
+		const auto first = std::min(count, items.size() - start);
+
+		const auto ring = items.begin() + start;
+		std::move(ring, ring + first, target);
+		std::move(items.begin(),
+		          items.begin() + (count - first),
+		          std::next(target, first));
+
+		read_pos.store(head + count, PositionOrder);
+		return count;
+	}
+
+	// Exact on the producer side, and a lower bound otherwise
+	size_t GetFreeSpace() const
+	{
+		return GetCapacity() - (write_pos.load(std::memory_order_relaxed) -
+		                        read_pos.load(LoadOrder));
+	}
+
+	// Exact on the consumer side, and a lower bound otherwise
+	size_t GetNumQueued() const
+	{
+		return write_pos.load(LoadOrder) -
+		       read_pos.load(std::memory_order_relaxed);
+	}
+
+	// Only a snapshot when called while the other side is active
+	size_t Size() const
+	{
+		return write_pos.load(LoadOrder) - read_pos.load(LoadOrder);
+	}
+
+	bool IsEmpty() const
+	{
+		return Size() == 0;
+	}
+
+	size_t GetCapacity() const
+	{
+		if constexpr (FixedCapacity > 0) {
+			return FixedCapacity;
+		} else {
+			return capacity;
+		}
+	}
+
+private:
+	static constexpr size_t FixedCapacity = spsc_fixed_capacity<Storage>;
+
+	static constexpr auto LoadOrder = (PositionOrder == std::memory_order_seq_cst)
+	                                        ? std::memory_order_seq_cst
+	                                        : std::memory_order_acquire;
+
+	size_t GetIndexMask() const
+	{
+		return items.size() - 1;
+	}
+
+	// Keep the positions on separate cache lines so the producer and
+	// consumer don't keep invalidating each other's
+	static constexpr size_t CacheLineSize = 64;
+
+	alignas(CacheLineSize) std::atomic<size_t> write_pos = 0;
+	alignas(CacheLineSize) std::atomic<size_t> read_pos  = 0;
+
+	alignas(CacheLineSize) Storage items = {};
+
+	// Only used by resizable storage
+	size_t capacity = 0;
+};
+
+// Fixed-capacity, lock-free queue for passing items from one producer thread
+// to one consumer thread, such as network packets between the emulation
+// thread and an I/O thread.
+//
+// Items are filled and read in place: the producer gets the next free slot,
+// fills it, then pushes it; the consumer gets the oldest item, uses it, then
+// pops it. This avoids copying large items (e.g. Ethernet frames) in and out
+// of the queue. Neither side ever blocks; the producer simply gets no slot
+// when the queue is full, and the consumer no item when it's empty.
+//
+// The capacity must be a power of two.
+//
+template <typename T, size_t Capacity>
+using SpscQueue = SpscRing<std::array<T, Capacity>>;
+
+// Fixed-capacity, lock-free ring for streaming items (typically bytes) from
+// one producer thread to one consumer thread in bulk, such as the data of a
+// serial port's network connection.
+//
+// Unlike SpscQueue, items are copied in and out in runs with Write() and
+// Read(); every call transfers as many items as fit or are available and
+// returns that count. Neither side ever blocks.
+//
+// The capacity must be a power of two.
+//
+template <typename T, size_t Capacity>
+using SpscRingBuffer = SpscRing<std::array<T, Capacity>>;
+
+#endif // DOSBOX_SPSC_QUEUE_H
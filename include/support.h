@@ -242,7 +242,10 @@ int64_t stdio_size_bytes(FILE* f);
 int64_t stdio_size_kb(FILE* f);
 int64_t stdio_num_sectors(FILE* f);
 
+// Directory containing the running executable
 const std_fs::path& GetExecutablePath();
+// Full path of the running executable itself
+const std_fs::path& GetExecutableFilePath();
 std_fs::path GetResourcePath(const std_fs::path& name);
 std_fs::path GetResourcePath(const std_fs::path& subdir, const std_fs::path& name);
 
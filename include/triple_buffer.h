@@ -0,0 +1,90 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TRIPLE_BUFFER_H
+#define DOSBOX_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for handing the latest value from one writer thread
+// to one reader thread, such as frames from the emulation thread to a
+// presentation thread.
+//
+// The writer fills the write buffer and publishes it, which swaps it with the
+// shared middle buffer. The reader takes the middle buffer in exchange for the
+// one it's done with when something new was published since its last update.
+// Neither side ever waits for the other; values the reader didn't get to in
+// time are simply overwritten by newer ones.
+//
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() = default;
+
+	TripleBuffer(const TripleBuffer&)            = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// Writer side
+	T& GetWriteBuffer()
+	{
+		return buffers[write_index];
+	}
+
+	void Publish()
+	{
+		const auto previous = middle.exchange(write_index | IsNewFlag,
+		                                      std::memory_order_acq_rel);
+		write_index = previous & IndexMask;
+	}
+
+	// Reader side; returns true if a newer value was taken
+	bool Update()
+	{
+		if ((middle.load(std::memory_order_relaxed) & IsNewFlag) == 0) {
+			return false;
+		}
+		const auto previous = middle.exchange(read_index,
+		                                      std::memory_order_acq_rel);
+		read_index = previous & IndexMask;
+		return true;
+	}
+
+	const T& GetReadBuffer() const
+	{
+		return buffers[read_index];
+	}
+
+private:
+	static constexpr uint8_t IndexMask = 0b011;
+	static constexpr uint8_t IsNewFlag = 0b100;
+
+	std::array<T, 3> buffers = {};
+
+	// Index of the shared buffer, plus the flag if it's yet unread
+	std::atomic<uint8_t> middle = 1;
+
+	// Only ever touched by their own side
+	uint8_t write_index = 0;
+	uint8_t read_index  = 2;
+};
+
+#endif // DOSBOX_TRIPLE_BUFFER_H
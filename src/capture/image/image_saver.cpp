@@ -117,6 +117,7 @@ void ImageSaver::SaveImage(const SaveImageTask& task)
 }
 
 static void write_upscaled_png(FILE* outfile, PngWriter& png_writer,
+                               const RenderedImage& image,
                                ImageScaler& image_scaler, const uint16_t width,
                                const uint16_t height,
                                const Fraction& pixel_aspect_ratio,
@@ -143,11 +144,8 @@ static void write_upscaled_png(FILE* outfile, PngWriter& png_writer,
 		break;
 	};
 
-	auto rows_to_write = image_scaler.GetOutputHeight();
-	while (rows_to_write--) {
-		auto row = image_scaler.GetNextOutputRow();
-		png_writer.WriteRow(row);
-	}
+	png_writer.WriteScaledRowsInBands(image,
+	                                  image_scaler.GetOutputRowsPerInputRow());
 }
 
 void ImageSaver::SaveRawImage(const RenderedImage& image)
@@ -237,6 +235,7 @@ void ImageSaver::SaveUpscaledImage(const RenderedImage& image)
 	// data.
 	write_upscaled_png(outfile,
 	                   png_writer,
+	                   image,
 	                   image_scaler,
 	                   image_scaler.GetOutputWidth(),
 	                   image_scaler.GetOutputHeight(),
@@ -266,27 +265,48 @@ void ImageSaver::SaveRenderedImage(const RenderedImage& image)
 	// as-is.
 	const auto row_skip_count   = 0;
 	const auto pixel_skip_count = 0;
-	image_decoder.Init(image, row_skip_count, pixel_skip_count);
 
 	constexpr uint8_t BytesPerPixel = 3;
-	row_buf.resize(static_cast<size_t>(src.width) *
-	               static_cast<size_t>(BytesPerPixel));
 
-	auto rows_to_write = src.height;
-	while (rows_to_write--) {
-		auto out = row_buf.begin();
+	auto write_band = [&](const uint16_t first_row,
+	                      const uint16_t end_row,
+	                      PngBand& band) {
+		ImageDecoder decoder = {};
+		decoder.Init(image, row_skip_count, pixel_skip_count);
+
+		std::vector<uint8_t> band_row_buf(static_cast<size_t>(src.width) *
+		                                  static_cast<size_t>(BytesPerPixel));
+
+		auto decode_row = [&] {
+			auto out = band_row_buf.begin();
+
+			auto pixels_to_write = src.width;
+			while (pixels_to_write--) {
+				const auto pixel = decoder.GetNextPixelAsRgb888();
+
+				*out++ = pixel.red;
+				*out++ = pixel.green;
+				*out++ = pixel.blue;
+			}
+			decoder.AdvanceRow();
+		};
 
-		auto pixels_to_write = src.width;
-		while (pixels_to_write--) {
-			const auto pixel = image_decoder.GetNextPixelAsRgb888();
+		if (first_row > 0) {
+			for (auto y = 1; y < first_row; ++y) {
+				decoder.AdvanceRow();
+			}
+			decode_row();
+			band.SetPreviousRow(band_row_buf.begin());
+		}
 
-			*out++ = pixel.red;
-			*out++ = pixel.green;
-			*out++ = pixel.blue;
+		for (auto y = first_row; y < end_row; ++y) {
+			decode_row();
+			band.CompressRow(band_row_buf.begin());
 		}
-		png_writer.WriteRow(row_buf.begin());
-		image_decoder.AdvanceRow();
-	}
+	};
+
+	constexpr auto RowAlignment = 1;
+	png_writer.WriteRowsInBands(RowAlignment, write_band);
 }
 
 void ImageSaver::CloseOutFile()
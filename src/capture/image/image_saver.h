@@ -104,7 +104,7 @@ private:
 
 	void CloseOutFile();
 
-	RWQueue<SaveImageTask> image_fifo{MaxQueuedImages};
+	SpscRWQueue<SaveImageTask> image_fifo{MaxQueuedImages};
 	std::thread renderer = {};
 	bool is_open         = false;
 
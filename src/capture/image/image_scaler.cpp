@@ -233,6 +233,24 @@ void ImageScaler::AllocateBuffers()
 	// without branching (the interpolator operates on the current and the
 	// next pixel).
 	linear_row_buf.resize((input.params.width + 1u) * ComponentsPerRgbPixel);
+
+	sharp_samples.resize(output.width);
+
+	for (auto x = 0; x < output.width; ++x) {
+		const auto x0 = static_cast<float>(x) * output.one_per_horiz_scale;
+		const auto floor_x0 = static_cast<uint16_t>(x0);
+		assert(floor_x0 < input.params.width);
+
+		// Calculate linear interpolation factor `t` between the current
+		// and the next pixel so that the interpolation "band" is one
+		// pixel wide at most at the edges of the pixel.
+		const auto x1 = x0 + output.one_per_horiz_scale;
+		const auto t  = std::max(x1 - (floor_x0 + 1.0f), 0.0f) *
+		               output.horiz_scale;
+
+		sharp_samples[x] = {static_cast<uint16_t>(floor_x0 * ComponentsPerRgbPixel),
+		                    t};
+	}
 }
 
 uint16_t ImageScaler::GetOutputWidth() const
@@ -250,6 +268,12 @@ OutputPixelFormat ImageScaler::GetOutputPixelFormat() const
 	return output.pixel_format;
 }
 
+uint8_t ImageScaler::GetOutputRowsPerInputRow() const
+{
+	assert(output.vert_scaling_mode == PerAxisScaling::Integer);
+	return output.vert_scale;
+}
+
 void ImageScaler::DecodeNextRowToLinearRgb()
 {
 	auto out = linear_row_buf.begin();
@@ -307,13 +331,8 @@ void ImageScaler::GenerateNextSharpUpscaledOutputRow()
 	auto row_start = linear_row_buf.begin();
 	auto out       = output.row_buf.begin();
 
-	for (auto x = 0; x < output.width; ++x) {
-		const auto x0 = static_cast<float>(x) * output.one_per_horiz_scale;
-		const auto floor_x0 = static_cast<uint16_t>(x0);
-		assert(floor_x0 < input.params.width);
-
-		const auto row_offs = floor_x0 * ComponentsPerRgbPixel;
-		auto pixel_addr     = row_start + row_offs;
+	for (const auto& sample : sharp_samples) {
+		auto pixel_addr = row_start + sample.row_offs;
 
 		// Current pixel
 		const auto r0 = *pixel_addr++;
@@ -325,16 +344,9 @@ void ImageScaler::GenerateNextSharpUpscaledOutputRow()
 		const auto g1 = *pixel_addr++;
 		const auto b1 = *pixel_addr++;
 
-		// Calculate linear interpolation factor `t` between the current
-		// and the next pixel so that the interpolation "band" is one
-		// pixel wide at most at the edges of the pixel.
-		const auto x1 = x0 + output.one_per_horiz_scale;
-		const auto t  = std::max(x1 - (floor_x0 + 1.0f), 0.0f) *
-		               output.horiz_scale;
-
-		const auto out_r = lerp(r0, r1, t);
-		const auto out_g = lerp(g0, g1, t);
-		const auto out_b = lerp(b0, b1, t);
+		const auto out_r = lerp(r0, r1, sample.t);
+		const auto out_g = lerp(g0, g1, sample.t);
+		const auto out_b = lerp(b0, b1, sample.t);
 
 		*out++ = linear_to_srgb8_lut(out_r);
 		*out++ = linear_to_srgb8_lut(out_g);
@@ -344,6 +356,18 @@ void ImageScaler::GenerateNextSharpUpscaledOutputRow()
 	SetRowRepeat();
 }
 
+void ImageScaler::SeekToOutputRow(const uint16_t row)
+{
+	assert(output.curr_row == 0 && output.row_repeat == 0);
+	assert(row % GetOutputRowsPerInputRow() == 0);
+
+	while (output.curr_row < row) {
+		input_decoder.AdvanceRow();
+		output.curr_row = static_cast<uint16_t>(output.curr_row +
+		                                        output.vert_scale);
+	}
+}
+
 std::vector<uint8_t>::const_iterator ImageScaler::GetNextOutputRow()
 {
 	if (output.curr_row >= output.height) {
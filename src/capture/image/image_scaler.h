@@ -73,6 +73,11 @@ enum class PerAxisScaling { Integer, Fractional };
 // - Call `GetNextOutputRow()` repeatedly to get the upscaled output until the
 //   end of the iterator is reached.
 //
+// - Alternatively, call `SeekToOutputRow()` right after `Init()` to start
+//   from a given row; this allows multiple scalers to upscale separate bands
+//   of the same image in parallel. The row must be a multiple of
+//   `GetOutputRowsPerInputRow()`.
+//
 // - Call `Init()` again to process another image (no need to destruct &
 //   re-create).
 //
@@ -84,10 +89,12 @@ public:
 	void Init(const RenderedImage& image);
 
 	std::vector<uint8_t>::const_iterator GetNextOutputRow();
+	void SeekToOutputRow(const uint16_t row);
 
 	uint16_t GetOutputWidth() const;
 	uint16_t GetOutputHeight() const;
 	OutputPixelFormat GetOutputPixelFormat() const;
+	uint8_t GetOutputRowsPerInputRow() const;
 
 	// prevent copying
 	ImageScaler(const ImageScaler&) = delete;
@@ -114,6 +121,14 @@ private:
 
 	std::vector<float> linear_row_buf = {};
 
+	// The horizontal sampling positions are the same for every row, so
+	// they're calculated only once per image
+	struct SharpSample {
+		uint16_t row_offs = 0;
+		float t           = 0.0f;
+	};
+	std::vector<SharpSample> sharp_samples = {};
+
 	struct {
 		uint16_t width  = 0;
 		uint16_t height = 0;
@@ -19,10 +19,15 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <thread>
 
 #include "png_writer.h"
 
+#include "image_scaler.h"
+
 #include "checks.h"
 #include "string_utils.h"
 #include "support.h"
@@ -141,6 +146,10 @@ void PngWriter::WritePngInfo(const uint16_t width, const uint16_t height,
 	assert(png_ptr);
 	assert(png_info_ptr);
 
+	this->height    = height;
+	bytes_per_pixel = is_paletted ? 1 : 3;
+	row_size_bytes  = width * bytes_per_pixel;
+
 	constexpr auto png_bit_depth = 8;
 	const auto png_color_type    = is_paletted ? PNG_COLOR_TYPE_PALETTE
 	                                           : PNG_COLOR_TYPE_RGB;
@@ -246,11 +255,306 @@ void PngWriter::WriteRow(std::vector<uint8_t>::const_iterator row)
 	png_write_row(png_ptr, const_cast<png_bytep>(&*row));
 }
 
+void PngWriter::WriteRowsInBands(const uint16_t row_alignment,
+                                 BandWriter write_band, const unsigned num_threads)
+{
+	assert(png_ptr);
+	assert(row_alignment > 0);
+
+	// Bands smaller than this aren't worth the thread and the slightly
+	// worse compression at the band boundaries
+	constexpr auto MinRowsPerBand = 128;
+	constexpr auto MaxNumBands    = 16;
+
+	const auto num_aligned_rows = (height + row_alignment - 1) / row_alignment;
+	const auto rows_per_band_min = (MinRowsPerBand + row_alignment - 1) /
+	                               row_alignment;
+
+	const auto num_bands = std::clamp(
+	        std::min(static_cast<int>(num_threads),
+	                 num_aligned_rows / rows_per_band_min),
+	        1,
+	        MaxNumBands);
+
+	std::vector<PngBand> bands(static_cast<size_t>(num_bands));
+
+	auto compress_band = [&](const int band_index) {
+		const auto first_row = num_aligned_rows * band_index / num_bands *
+		                       row_alignment;
+		const auto end_row = std::min(num_aligned_rows * (band_index + 1) /
+		                                      num_bands * row_alignment,
+		                              static_cast<int>(height));
+
+		auto& band = bands[static_cast<size_t>(band_index)];
+		band.Init(row_size_bytes, bytes_per_pixel, band_index == num_bands - 1);
+
+		write_band(static_cast<uint16_t>(first_row),
+		           static_cast<uint16_t>(end_row),
+		           band);
+		band.Finish();
+	};
+
+	// The calling thread compresses the first band
+	std::vector<std::thread> workers = {};
+	for (auto i = 1; i < num_bands; ++i) {
+		workers.emplace_back(compress_band, i);
+	}
+	compress_band(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	// The compressed bands make up a single zlib stream: the header for a
+	// 32K window at the default compression level, the concatenated deflate
+	// data, and the Adler-32 checksum of all the filtered rows.
+	constexpr uint8_t ZlibHeader[] = {0x78, 0x9c};
+
+	auto adler       = adler32(0L, Z_NULL, 0);
+	size_t data_size = sizeof(ZlibHeader) + sizeof(uint32_t);
+
+	for (const auto& band : bands) {
+		adler = adler32_combine(adler,
+		                        band.GetAdler32(),
+		                        static_cast<z_off_t>(band.GetUncompressedSize()));
+		data_size += band.GetCompressedData().size();
+	}
+
+	const png_byte adler_be[] = {static_cast<png_byte>(adler >> 24),
+	                             static_cast<png_byte>(adler >> 16),
+	                             static_cast<png_byte>(adler >> 8),
+	                             static_cast<png_byte>(adler)};
+
+	png_write_chunk_start(png_ptr,
+	                      reinterpret_cast<png_const_bytep>("IDAT"),
+	                      static_cast<png_uint_32>(data_size));
+
+	png_write_chunk_data(png_ptr, ZlibHeader, sizeof(ZlibHeader));
+	for (const auto& band : bands) {
+		const auto& data = band.GetCompressedData();
+		png_write_chunk_data(png_ptr, data.data(), data.size());
+	}
+	png_write_chunk_data(png_ptr, adler_be, sizeof(adler_be));
+	png_write_chunk_end(png_ptr);
+
+	// libpng only knows about IDATs it wrote itself, so we need to end the
+	// image on our own
+	png_write_chunk(png_ptr, reinterpret_cast<png_const_bytep>("IEND"), nullptr, 0);
+	is_finalised = true;
+}
+
+void PngWriter::WriteScaledRowsInBands(const RenderedImage& image,
+                                       const uint16_t rows_per_input_row,
+                                       const unsigned num_threads)
+{
+	auto write_band = [&](const uint16_t first_row,
+	                      const uint16_t end_row,
+	                      PngBand& band) {
+		ImageScaler band_scaler = {};
+		band_scaler.Init(image);
+
+		if (first_row > 0) {
+			const auto prev_input_row = static_cast<uint16_t>(
+			        first_row - rows_per_input_row);
+
+			band_scaler.SeekToOutputRow(prev_input_row);
+
+			auto row = band_scaler.GetNextOutputRow();
+			for (auto i = 1; i < rows_per_input_row; ++i) {
+				row = band_scaler.GetNextOutputRow();
+			}
+			band.SetPreviousRow(row);
+		}
+
+		for (auto y = first_row; y < end_row; ++y) {
+			band.CompressRow(band_scaler.GetNextOutputRow());
+		}
+	};
+
+	WriteRowsInBands(rows_per_input_row, write_band, num_threads);
+}
+
 void PngWriter::FinalisePng()
 {
 	assert(png_ptr);
+	if (is_finalised) {
+		return;
+	}
 
 	const png_infop end_info_ptr = nullptr;
 	png_write_end(png_ptr, end_info_ptr);
 }
 
+PngBand::~PngBand()
+{
+	if (is_stream_open) {
+		deflateEnd(&stream);
+	}
+}
+
+void PngBand::Init(const uint32_t _row_size_bytes, const uint8_t _bytes_per_pixel,
+                   const bool is_last_band)
+{
+	row_size        = _row_size_bytes;
+	bytes_per_pixel = _bytes_per_pixel;
+	is_last         = is_last_band;
+
+	prev_row.assign(row_size, 0);
+	for (auto& filtered_row : filtered_rows) {
+		filtered_row.resize(row_size + 1);
+	}
+
+	adler             = adler32(0L, Z_NULL, 0);
+	uncompressed_size = 0;
+	compressed.clear();
+
+	// Same parameters as libpng uses for whole images (see
+	// PngWriter::SetPngCompressionsParams()), but without the zlib
+	// header and trailer as those are written for the whole image
+	constexpr auto RawDeflateWindowBits = -15;
+	constexpr auto DefaultMemLevel      = 8;
+
+	stream = {};
+	is_stream_open = (deflateInit2(&stream,
+	                               Z_DEFAULT_COMPRESSION,
+	                               Z_DEFLATED,
+	                               RawDeflateWindowBits,
+	                               DefaultMemLevel,
+	                               Z_DEFAULT_STRATEGY) == Z_OK);
+	if (!is_stream_open) {
+		LOG_ERR("PNG: Error initialising zlib");
+	}
+}
+
+void PngBand::SetPreviousRow(std::vector<uint8_t>::const_iterator row)
+{
+	std::copy_n(row, row_size, prev_row.begin());
+}
+
+static uint8_t paeth_predictor(const uint8_t a, const uint8_t b, const uint8_t c)
+{
+	const auto p  = a + b - c;
+	const auto pa = std::abs(p - a);
+	const auto pb = std::abs(p - b);
+	const auto pc = std::abs(p - c);
+
+	if (pa <= pb && pa <= pc) {
+		return a;
+	}
+	return (pb <= pc) ? b : c;
+}
+
+// Filters a row with the given predictor and returns the sum of the absolute
+// values of the filtered bytes (treated as signed). `a` is the byte to the
+// left, `b` the byte above, and `c` the byte above and to the left; `a` and
+// `c` are zero for the first pixel.
+template <typename Predictor>
+static uint32_t filter_row(const uint8_t* row, const uint8_t* prev_row,
+                           const uint32_t row_size, const uint8_t bpp,
+                           uint8_t* out, Predictor predict)
+{
+	uint32_t sum = 0;
+
+	auto filter_byte = [&](const uint32_t i, const uint8_t predicted) {
+		const auto filtered = static_cast<uint8_t>(row[i] - predicted);
+		out[i]              = filtered;
+		sum += static_cast<uint32_t>(std::abs(static_cast<int8_t>(filtered)));
+	};
+
+	const auto first_pixel_size = std::min(static_cast<uint32_t>(bpp), row_size);
+	for (uint32_t i = 0; i < first_pixel_size; ++i) {
+		filter_byte(i, predict(0, prev_row[i], 0));
+	}
+	for (uint32_t i = first_pixel_size; i < row_size; ++i) {
+		filter_byte(i, predict(row[i - bpp], prev_row[i], prev_row[i - bpp]));
+	}
+	return sum;
+}
+
+void PngBand::CompressRow(std::vector<uint8_t>::const_iterator row_it)
+{
+	const auto row  = &*row_it;
+	const auto prev = prev_row.data();
+	const auto bpp  = bytes_per_pixel;
+
+	// Apply every filter type, then pick the one with the smallest sum of
+	// absolute differences; this is the same heuristic libpng uses with
+	// PNG_ALL_FILTERS.
+	auto filter = [&](const uint8_t type, auto predict) {
+		auto& out = filtered_rows[type];
+		out[0]    = type;
+		return filter_row(row, prev, row_size, bpp, out.data() + 1, predict);
+	};
+
+	const uint32_t sums[NumFilterTypes] = {
+	        filter(0, [](uint8_t, uint8_t, uint8_t) { return uint8_t(0); }),
+	        filter(1, [](uint8_t a, uint8_t, uint8_t) { return a; }),
+	        filter(2, [](uint8_t, uint8_t b, uint8_t) { return b; }),
+	        filter(3,
+	               [](uint8_t a, uint8_t b, uint8_t) {
+		               return static_cast<uint8_t>((a + b) / 2);
+	               }),
+	        filter(4, paeth_predictor),
+	};
+
+	auto best_type = 0;
+	for (auto type = 1; type < NumFilterTypes; ++type) {
+		if (sums[type] < sums[best_type]) {
+			best_type = type;
+		}
+	}
+
+	const auto best_filtered = filtered_rows[best_type].data();
+	const auto filtered_size = row_size + 1;
+
+	adler = adler32(adler, best_filtered, filtered_size);
+	uncompressed_size += filtered_size;
+	Deflate(best_filtered, filtered_size, Z_NO_FLUSH);
+
+	std::copy_n(row, row_size, prev_row.begin());
+}
+
+void PngBand::Finish()
+{
+	Deflate(nullptr, 0, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+
+	if (is_stream_open) {
+		deflateEnd(&stream);
+		is_stream_open = false;
+	}
+}
+
+void PngBand::Deflate(const uint8_t* data, const size_t size, const int flush)
+{
+	if (!is_stream_open) {
+		return;
+	}
+	constexpr size_t OutputChunkSize = 8192;
+	uint8_t chunk[OutputChunkSize];
+
+	stream.next_in  = const_cast<Bytef*>(data);
+	stream.avail_in = static_cast<uInt>(size);
+	do {
+		stream.next_out  = chunk;
+		stream.avail_out = OutputChunkSize;
+		deflate(&stream, flush);
+
+		const auto num_bytes = OutputChunkSize - stream.avail_out;
+		compressed.insert(compressed.end(), chunk, chunk + num_bytes);
+	} while (stream.avail_out == 0);
+}
+
+const std::vector<uint8_t>& PngBand::GetCompressedData() const
+{
+	return compressed;
+}
+
+uLong PngBand::GetAdler32() const
+{
+	return adler;
+}
+
+size_t PngBand::GetUncompressedSize() const
+{
+	return uncompressed_size;
+}
+
@@ -23,7 +23,9 @@
 #define DOSBOX_PNG_WRITER_H
 
 #include <cstdlib>
+#include <functional>
 #include <optional>
+#include <thread>
 #include <vector>
 
 #include "image_saver.h"
@@ -31,6 +33,57 @@
 #include "render.h"
 
 #include <png.h>
+#include <zlib.h>
+
+// Filters and deflates a horizontal band of image rows independently of the
+// other bands, so the bands of an image can be compressed in parallel. The
+// deflate stream of every band but the last one ends with a sync flush, so
+// the compressed bands simply concatenate into the image's zlib stream.
+class PngBand {
+public:
+	PngBand() = default;
+	~PngBand();
+
+	void Init(const uint32_t row_size_bytes, const uint8_t bytes_per_pixel,
+	          const bool is_last_band);
+
+	// The "Up", "Average", and "Paeth" filters need the row preceding the
+	// band (the last row of the previous band); the first band starts
+	// with the all-zero row as per the PNG spec.
+	void SetPreviousRow(std::vector<uint8_t>::const_iterator row);
+
+	void CompressRow(std::vector<uint8_t>::const_iterator row);
+	void Finish();
+
+	const std::vector<uint8_t>& GetCompressedData() const;
+	uLong GetAdler32() const;
+	size_t GetUncompressedSize() const;
+
+	// prevent copying
+	PngBand(const PngBand&) = delete;
+	// prevent assignment
+	PngBand& operator=(const PngBand&) = delete;
+
+private:
+	static constexpr auto NumFilterTypes = 5;
+
+	void Deflate(const uint8_t* data, const size_t size, const int flush);
+
+	z_stream stream          = {};
+	bool is_stream_open      = false;
+	bool is_last             = false;
+	uint8_t bytes_per_pixel  = 0;
+	uint32_t row_size        = 0;
+	uLong adler              = 0;
+	size_t uncompressed_size = 0;
+
+	std::vector<uint8_t> prev_row = {};
+
+	// The filter type byte followed by the filtered row, for each type
+	std::vector<uint8_t> filtered_rows[NumFilterTypes] = {};
+
+	std::vector<uint8_t> compressed = {};
+};
 
 // A row-based PNG writer that also writes the pixel aspect ratio of the image
 // into the standard pHYs PNG chunk.
@@ -49,6 +102,25 @@ public:
 
 	void WriteRow(std::vector<uint8_t>::const_iterator row);
 
+	// Writes all rows of the image by splitting it into horizontal bands
+	// that are generated and compressed in parallel, one band per thread
+	// at most. The band writer is called on a separate thread for each
+	// band with its range of rows and must pass them to the band's
+	// CompressRow() in order. The bands start on multiples of
+	// `row_alignment` rows.
+	using BandWriter = std::function<void(const uint16_t first_row,
+	                                      const uint16_t end_row, PngBand& band)>;
+
+	void WriteRowsInBands(const uint16_t row_alignment, BandWriter write_band,
+	                      const unsigned num_threads = std::thread::hardware_concurrency());
+
+	// Upscales the image with the image scaler and writes it in parallel
+	// bands. Every band is upscaled by its own scaler, and the bands start
+	// on input row boundaries so the scalers can seek to them directly.
+	void WriteScaledRowsInBands(const RenderedImage& image,
+	                            const uint16_t rows_per_input_row,
+	                            const unsigned num_threads = std::thread::hardware_concurrency());
+
 	// prevent copying
 	PngWriter(const PngWriter&) = delete;
 	// prevent assignment
@@ -67,6 +139,12 @@ private:
 
 	png_structp png_ptr    = nullptr;
 	png_infop png_info_ptr = nullptr;
+
+	uint16_t height         = 0;
+	uint32_t row_size_bytes = 0;
+	uint8_t bytes_per_pixel = 0;
+
+	bool is_finalised = false;
 };
 
 #endif
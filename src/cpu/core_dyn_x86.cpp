@@ -357,6 +357,7 @@ restart_core:
 		}
 	}
 run_block:
+	block->MarkUsed();
 	cache.block.running=nullptr;
 	const auto ret = sync_normal_fpu_and_run_dyn_code(block->cache.start);
 #	if C_DEBUG
@@ -511,6 +512,10 @@ void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache) {
 	cache_init(enable_cache);
 }
 
+void CPU_Core_Dyn_X86_Cache_SetMaxSize(size_t max_size) {
+	cache_set_max_size(max_size);
+}
+
 void CPU_Core_Dyn_X86_Cache_Close(void) {
 	cache_close();
 }
@@ -164,6 +164,8 @@ static_assert(offsetof(core_dynrec_t, readdata) % sizeof(uint32_t) == 0,
 #define ARMV8LE		0x07
 #define PPC64LE		0x08
 
+#include "core_dynrec/persistent_cache.h"
+
 #if C_TARGETCPU == X86_64
 #include "core_dynrec/risc_x64.h"
 #elif C_TARGETCPU == X86
@@ -263,8 +265,10 @@ Bits CPU_Core_Dynrec_Run() noexcept
 			// no block found, thus translate the instruction stream
 			// unless the instruction is known to be modified
 			if (!chandler->invalidation_map || (chandler->invalidation_map[ip_point&4095]<4)) {
-				// translate up to 32 instructions
-				block=CreateCacheBlock(chandler,ip_point,32);
+				// reuse a block from an earlier session if possible,
+				// otherwise translate up to 32 instructions
+				block=persistent_cache.Restore(chandler,ip_point);
+				if (!block) block=CreateCacheBlock(chandler,ip_point,32);
 			} else {
 				// let the normal core handle this instruction to avoid zero-sized blocks
 				Bitu old_cycles=CPU_Cycles;
@@ -280,6 +284,7 @@ Bits CPU_Core_Dynrec_Run() noexcept
 		}
 
 run_block:
+		block->MarkUsed();
 		cache.block.running=nullptr;
 		// now we're ready to run the dynamic code block
 //		BlockReturn ret=((BlockReturn (*)(void))(block->cache.start))();
@@ -389,8 +394,17 @@ void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
 	cache_init(enable_cache);
 }
 
+void CPU_Core_Dynrec_Cache_SetMaxSize(size_t max_size) {
+	cache_set_max_size(max_size);
+}
+
 void CPU_Core_Dynrec_Cache_Close(void) {
+	persistent_cache.Close();
 	cache_close();
 }
 
+void CPU_Core_Dynrec_PersistentCache_Init(bool enable) {
+	persistent_cache.Init(enable);
+}
+
 #endif
@@ -52,11 +52,15 @@ static CacheBlock *CreateCacheBlock(CodePageHandler *codepage, PhysPt start, Bit
 
 	InitFlagsOptimization();
 
+	persistent_cache.BeginTranslation();
+
 	// every codeblock that is run sets cache.block.running to itself
 	// so the block linking knows the last executed block
 	gen_mov_direct_ptr(&cache.block.running,(Bitu)decode.block);
 
-	// start with the cycles check
+	// start with the cycles check, loops within the block continue here
+	gen_branch_target();
+	decode.loop_entry=cache.pos;
 	gen_mov_word_to_reg(FC_RETOP,&CPU_Cycles,true);
 	save_info_dynrec[used_save_info_dynrec].branch_pos=gen_create_branch_long_leqzero(FC_RETOP);
 	save_info_dynrec[used_save_info_dynrec].type=cycle_check;
@@ -1001,6 +1005,12 @@ finish_block:
 	// setup the correct end-address
 	decode.page.index--;
 	decode.active_block->page.end=(uint16_t)decode.page.index;
+	// blocks spanning two pages or checking for self-modification
+	// can't be reused in later sessions
+	persistent_cache.EndTranslation(decode.block, start,
+	                                (decode.active_block == decode.block) &&
+	                                        !decode.page.invmap &&
+	                                        !decode.block->cache.wmapmask);
 	dyn_mem_execute(cache_addr, cache_bytes);
 	const auto cache_flush_bytes = static_cast<size_t>(decode.block->cache.size);
 	dyn_cache_invalidate(cache_addr, cache_flush_bytes);
@@ -97,6 +97,8 @@ static struct DynDecode {
 	CacheBlock *block;
 	// block that contains the current byte of the instruction stream
 	CacheBlock *active_block;
+	// start of the cycles check at the beginning of the generated code
+	const uint8_t* loop_entry;
 
 	// the active page (containing the current byte of the instruction stream)
 	struct {
@@ -629,6 +631,20 @@ static void dyn_fill_blocks(void) {
 }
 
 
+// branch back to the cycles check at the start of the current block as long
+// as it is valid, this keeps loops that jump to their own start inside the
+// generated code; once the block was cleared (its code was modified) the
+// code following this branch leaves the block the regular way
+static void dyn_loop_to_block_start(void) {
+	gen_mov_word_to_reg(FC_RETOP,&decode.block->valid,true);
+	const uint8_t* data=gen_create_branch_long_nonzero(FC_RETOP,true);
+	// the branch destination is taken from cache.pos
+	const uint8_t* pos=cache.pos;
+	cache.pos=decode.loop_entry;
+	gen_fill_branch_long(data);
+	cache.pos=pos;
+}
+
 static void dyn_closeblock(void) {
 	//Shouldn't create empty block normally but let's do it like this
 	dyn_fill_blocks();
@@ -1150,26 +1166,85 @@ static void gen_restore_reg(HostReg reg,HostReg dest_reg) {
 // they try to find out if a function can be replaced by another
 // one that does not generate any flags at all
 
+// every queued function keeps track of the condition flags it writes that
+// have neither been overwritten nor been required by a later instruction
+// yet; as soon as all of them are overwritten the function can be replaced,
+// if any of them is required the function has to stay as it is
+
 static Bitu mf_functions_num=0;
 static struct {
 	const uint8_t* pos;
 	void* fct_ptr;
 	Bitu ftype;
+	Bitu live_flags;
 } mf_functions[64];
 
 static void InitFlagsOptimization(void) {
 	mf_functions_num=0;
 }
 
+#ifdef DRC_FLAGS_INVALIDATION
+// condition flags that might be modified by an instruction of flags_type
+static Bitu FlagsWritten(Bitu flags_type) {
+	switch (flags_type) {
+		case t_INCb: case t_INCw: case t_INCd:
+		case t_DECb: case t_DECw: case t_DECd:
+			return FMASK_TEST & ~FLAG_CF;
+		case t_ROLb: case t_ROLw: case t_ROLd:
+		case t_RORb: case t_RORw: case t_RORd:
+			return FLAG_CF | FLAG_OF;
+		default:
+			return FMASK_TEST;
+	}
+}
+
+// condition flags that are always overwritten by an instruction of flags_type
+// (shifts and rotates leave the flags untouched if the count is zero)
+static Bitu FlagsOverwritten(Bitu flags_type) {
+	switch (flags_type) {
+		case t_INCb: case t_INCw: case t_INCd:
+		case t_DECb: case t_DECw: case t_DECd:
+			return FMASK_TEST & ~FLAG_CF;
+		case t_ADCb: case t_ADCw: case t_ADCd:
+		case t_SBBb: case t_SBBw: case t_SBBd:
+			return FMASK_TEST;
+		default:
+			return 0;
+	}
+}
+
+// the flags in flags_mask are overwritten by the current instruction, replace
+// all queued functions whose flags are all dead now with their simpler variants
+static void KillFlags(Bitu flags_mask) {
+	Bitu num=0;
+	for (Bitu ct=0; ct<mf_functions_num; ct++) {
+		mf_functions[ct].live_flags&=~flags_mask;
+		if (mf_functions[ct].live_flags) {
+			mf_functions[num++]=mf_functions[ct];
+		} else {
+			gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
+		}
+	}
+	mf_functions_num=num;
+}
+
+// add a function to the queue, if it is full the function is left alone
+static void QueueFlagsFunction(void* current_simple_function,const uint8_t* cpos,Bitu flags_type) {
+	if (mf_functions_num>=(sizeof(mf_functions)/sizeof(mf_functions[0]))) return;
+	mf_functions[mf_functions_num].pos=cpos;
+	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
+	mf_functions[mf_functions_num].ftype=flags_type;
+	mf_functions[mf_functions_num].live_flags=FlagsWritten(flags_type);
+	++mf_functions_num;
+}
+#endif
+
 // replace all queued functions with their simpler variants
 // because the current instruction destroys all condition flags and
 // the flags are not required before
 static void InvalidateFlags(void) {
 #ifdef DRC_FLAGS_INVALIDATION
-	for (Bitu ct=0; ct<mf_functions_num; ct++) {
-		gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
-	}
-	mf_functions_num=0;
+	KillFlags(FMASK_TEST);
 #endif
 }
 
@@ -1178,43 +1253,43 @@ static void InvalidateFlags(void) {
 // the flags are not required before
 static void InvalidateFlags(void* current_simple_function,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION
-	for (Bitu ct=0; ct<mf_functions_num; ct++) {
-		gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
-	}
-	mf_functions_num=1;
-	mf_functions[0].pos=cache.pos;
-	mf_functions[0].fct_ptr=current_simple_function;
-	mf_functions[0].ftype=flags_type;
+	KillFlags(FMASK_TEST);
+	QueueFlagsFunction(current_simple_function,cache.pos,flags_type);
 #endif
 }
 
 // enqueue this instruction, if later an instruction is encountered that
 // destroys all condition flags and the flags weren't needed in-between
-// this function can be replaced by a simpler one as well
+// this function can be replaced by a simpler one as well; queued functions
+// whose remaining flags are all overwritten by this instruction are replaced
 static void InvalidateFlagsPartially(void* current_simple_function,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION
-	mf_functions[mf_functions_num].pos=cache.pos;
-	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
-	mf_functions[mf_functions_num].ftype=flags_type;
-	++mf_functions_num;
+	KillFlags(FlagsOverwritten(flags_type));
+	QueueFlagsFunction(current_simple_function,cache.pos,flags_type);
 #endif
 }
 
 // enqueue this instruction, if later an instruction is encountered that
 // destroys all condition flags and the flags weren't needed in-between
-// this function can be replaced by a simpler one as well
+// this function can be replaced by a simpler one as well; queued functions
+// whose remaining flags are all overwritten by this instruction are replaced
 static void InvalidateFlagsPartially(void* current_simple_function,const uint8_t* cpos,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION
-	mf_functions[mf_functions_num].pos=cpos;
-	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
-	mf_functions[mf_functions_num].ftype=flags_type;
-	++mf_functions_num;
+	KillFlags(FlagsOverwritten(flags_type));
+	QueueFlagsFunction(current_simple_function,cpos,flags_type);
 #endif
 }
 
-// the current function needs the condition flags thus reset the queue
+// the current function needs the condition flags in flags_mask thus
+// remove all functions that still provide some of them from the queue
 static void AcquireFlags([[maybe_unused]] Bitu flags_mask) {
 #ifdef DRC_FLAGS_INVALIDATION
-	mf_functions_num=0;
+	Bitu num=0;
+	for (Bitu ct=0; ct<mf_functions_num; ct++) {
+		if (!(mf_functions[ct].live_flags & flags_mask)) {
+			mf_functions[num++]=mf_functions[ct];
+		}
+	}
+	mf_functions_num=num;
 #endif
 }
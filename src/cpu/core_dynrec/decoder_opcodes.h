@@ -1101,6 +1101,7 @@ static void dyn_sahf(void) {
 static void dyn_exit_link(Bits eip_change) {
 	gen_add_direct_word(&reg_eip,(decode.code-decode.code_start)+eip_change,decode.big_op);
 	dyn_reduce_cycles();
+	if ((decode.code-decode.code_start)+eip_change==0) dyn_loop_to_block_start();
 	gen_jmp_ptr(&decode.block->link[0].to, offsetof(CacheBlock, cache.start));
 	dyn_closeblock();
 }
@@ -1119,6 +1120,7 @@ static void dyn_branched_exit(BranchTypes btype,int32_t eip_add) {
 	gen_fill_branch(data);
 
  	// Branch taken
+	if (eip_base+eip_add==0) dyn_loop_to_block_start();
 	gen_add_direct_word(&reg_eip,eip_base+eip_add,decode.big_op);
 	gen_jmp_ptr(&decode.block->link[1].to, offsetof(CacheBlock, cache.start));
 	dyn_closeblock();
@@ -1171,6 +1173,7 @@ static void dyn_loop(LoopTypes type) {
 		branch2=gen_create_branch_on_nonzero(FC_OP1,decode.big_addr);
 		break;
 	}
+	if (eip_base+eip_add==0) dyn_loop_to_block_start();
 	gen_add_direct_word(&reg_eip,eip_base+eip_add,true);
 	gen_jmp_ptr(&decode.block->link[0].to, offsetof(CacheBlock, cache.start));
 	if (branch1) {
@@ -0,0 +1,585 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+	Persistent translation cache
+
+	Optionally keeps translated code blocks in a file in the config
+	directory, so later sessions running the same programs can reuse them
+	instead of translating everything again.
+
+	Stored blocks are looked up by the physical address of their first
+	instruction and the CPU mode they were translated for, and are only
+	reused if the guest code bytes still match. The translated code refers
+	to host addresses, so while a block is translated the backend notes
+	every address it places into the code (see cache_add_reloc). A stored
+	block keeps these as offsets from either the emulator's executable
+	image or the block's own CacheBlock, and gets relocated when it's
+	brought back.
+
+	Blocks are never stored if they refer to anything else, span two
+	pages, or were translated for code that is known to modify itself.
+	A stored block whose relocated addresses can't be encoded the way the
+	original ones were is simply translated afresh.
+
+	Only the x86-64 backend notes its host addresses, so the cache is
+	unavailable with the other backends. The file format is implemented
+	in dynrec_cache_file.cpp.
+*/
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(WIN32)
+#include <dlfcn.h>
+#endif
+
+#include "cross.h"
+#include "dynrec_cache_file.h"
+#include "support.h"
+
+constexpr bool persistent_cache_supported = (C_TARGETCPU == X86_64);
+
+class PersistentCache {
+public:
+	void Init(const bool enable);
+	void Close();
+
+	// Called by the backend for every host address placed into the code
+	void NoteReloc(const uint8_t* pos, const void* target,
+	               const RelocForm form, const uint8_t tail);
+	// Replaces the address noted at pos, or forgets it if target is null
+	void RenoteReloc(const uint8_t* pos, const void* target, const RelocForm form);
+
+	void BeginTranslation();
+	void EndTranslation(const CacheBlock* block, const PhysPt start,
+	                    const bool can_store);
+
+	// Returns a block restored from the cache, or nullptr if the code at
+	// 'start' has to be translated
+	CacheBlock* Restore(CodePageHandler* codepage, const PhysPt start);
+
+	bool IsRecording() const
+	{
+		return is_recording;
+	}
+
+private:
+	struct PendingReloc {
+		const uint8_t* pos = nullptr;
+		const void* target = nullptr;
+		RelocForm form     = RelocForm::Abs64;
+		uint8_t tail       = 0;
+	};
+
+	struct Statistics {
+		uint32_t lookups = 0;
+		uint32_t hits = 0;
+		uint32_t relocation_failures = 0;
+		uint32_t translations = 0;
+		uint32_t stored = 0;
+		uint32_t unrelocatable = 0;
+		int64_t translate_ns = 0;
+		int64_t restore_ns = 0;
+	};
+
+	static uint64_t MakeKey(const PhysPt phys_start, const uint32_t mode)
+	{
+		return (static_cast<uint64_t>(mode) << 32) | phys_start;
+	}
+
+	static uint32_t GetCurrentMode();
+	static bool ReadGuestCode(const PhysPt start, const size_t size,
+	                          std::vector<uint8_t>& code);
+	static const void* GetImageBaseOf(const void* address);
+
+	bool MatchesGuestCode(const StoredBlock& stored, const PhysPt start) const;
+	bool ClassifyReloc(const PendingReloc& pending, const CacheBlock* block,
+	                   StoredReloc& stored);
+	bool Relocate(const StoredBlock& stored, const CacheBlock* block,
+	              const uint8_t* code_start);
+	CacheBlock* Instantiate(CodePageHandler* codepage, const StoredBlock& stored);
+
+	uint64_t GetBuildId() const;
+	bool Load();
+	void Save() const;
+	void LogStatistics() const;
+
+	StoredBlocks blocks = {};
+	std::vector<PendingReloc> pending_relocs = {};
+	std::vector<uint8_t> scratch_code = {};
+
+	// Targets already checked against the executable image
+	std::unordered_map<const void*, bool> image_targets = {};
+	const void* image_base = nullptr;
+
+	std_fs::path file_path = {};
+	uint64_t build_id = 0;
+	int64_t previous_translate_ns = 0;
+
+	std::chrono::steady_clock::time_point translation_start = {};
+	Statistics stats = {};
+
+	bool is_active    = false;
+	bool is_recording = false;
+	bool is_dirty     = false;
+};
+
+static PersistentCache persistent_cache;
+
+// Notes a host address about to be placed at the current cache position
+static inline void cache_add_reloc(const void* target, const RelocForm form,
+                                   const uint8_t tail = 0)
+{
+	if (persistent_cache.IsRecording()) {
+		persistent_cache.NoteReloc(cache.pos, target, form, tail);
+	}
+}
+
+// Notes a host address patched into already generated code
+static inline void cache_replace_reloc(const uint8_t* pos, const void* target,
+                                       const RelocForm form)
+{
+	if (persistent_cache.IsRecording()) {
+		persistent_cache.RenoteReloc(pos, target, form);
+	}
+}
+
+// Keep the file and memory use bounded
+constexpr size_t MaxStoredBlocks   = CACHE_BLOCKS;
+constexpr size_t MaxVariantsPerKey = 4;
+
+void PersistentCache::Init(const bool enable)
+{
+	if (!enable || is_active) {
+		return;
+	}
+	if (!persistent_cache_supported) {
+		LOG_WARNING("DYNREC: The persistent cache isn't supported by this backend");
+		return;
+	}
+	image_base = GetImageBaseOf(reinterpret_cast<const void*>(&CPU_Core_Dynrec_Run));
+	build_id   = GetBuildId();
+	if (!image_base || !build_id) {
+		LOG_WARNING("DYNREC: Can't identify the executable, not using the persistent cache");
+		return;
+	}
+	file_path = GetConfigDir() / "dynrec_cache.bin";
+	is_active = true;
+
+	if (Load()) {
+		LOG_MSG("DYNREC: Loaded %zu translated blocks from '%s'",
+		        blocks.size(),
+		        file_path.string().c_str());
+	}
+}
+
+void PersistentCache::Close()
+{
+	if (!is_active) {
+		return;
+	}
+	LogStatistics();
+	if (is_dirty) {
+		Save();
+	}
+	blocks.clear();
+	is_active = false;
+	is_dirty  = false;
+}
+
+void PersistentCache::NoteReloc(const uint8_t* pos, const void* target,
+                                const RelocForm form, const uint8_t tail)
+{
+	pending_relocs.push_back({pos, target, form, tail});
+}
+
+void PersistentCache::RenoteReloc(const uint8_t* pos, const void* target,
+                                  const RelocForm form)
+{
+	for (auto it = pending_relocs.begin(); it != pending_relocs.end(); ++it) {
+		if (it->pos == pos) {
+			pending_relocs.erase(it);
+			break;
+		}
+	}
+	if (target) {
+		NoteReloc(pos, target, form, 0);
+	}
+}
+
+void PersistentCache::BeginTranslation()
+{
+	if (!is_active) {
+		return;
+	}
+	pending_relocs.clear();
+	is_recording      = true;
+	translation_start = std::chrono::steady_clock::now();
+}
+
+// The translation time is kept for all blocks, stored or not, as it's the
+// basis of the estimated time the cache saves
+void PersistentCache::EndTranslation(const CacheBlock* block,
+                                     const PhysPt start, const bool can_store)
+{
+	if (!is_recording) {
+		return;
+	}
+	is_recording = false;
+
+	const auto elapsed = std::chrono::steady_clock::now() - translation_start;
+	stats.translate_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	++stats.translations;
+
+	if (!can_store || blocks.size() >= MaxStoredBlocks) {
+		return;
+	}
+
+	StoredBlock stored = {};
+	stored.page_start = block->page.start;
+	stored.page_end   = block->page.end;
+
+	const size_t host_size = check_cast<size_t>(cache.pos - block->cache.start);
+	const size_t guest_size = stored.page_end - stored.page_start + 1u;
+	if (stored.page_end < stored.page_start || host_size > CACHE_MAXSIZE ||
+	    !ReadGuestCode(start, guest_size, stored.guest_code)) {
+		return;
+	}
+
+	for (const auto& pending : pending_relocs) {
+		StoredReloc reloc = {};
+		if (!ClassifyReloc(pending, block, reloc)) {
+			++stats.unrelocatable;
+			return;
+		}
+		stored.relocs.push_back(reloc);
+	}
+
+	stored.code_hash = hash_bytes(stored.guest_code.data(), guest_size);
+	stored.host_code.assign(block->cache.start, block->cache.start + host_size);
+
+	const auto key = MakeKey(PAGING_GetPhysicalAddress(start), GetCurrentMode());
+
+	// Replace an older translation of the same code, and limit the number
+	// of different programs seen at the same address
+	auto [it, last] = blocks.equal_range(key);
+	size_t num_variants = 0;
+	for (; it != last; ++it, ++num_variants) {
+		if (it->second.code_hash == stored.code_hash &&
+		    it->second.guest_code == stored.guest_code) {
+			it->second = std::move(stored);
+			is_dirty   = true;
+			return;
+		}
+	}
+	if (num_variants >= MaxVariantsPerKey) {
+		blocks.erase(blocks.find(key));
+	}
+	blocks.emplace(key, std::move(stored));
+	++stats.stored;
+	is_dirty = true;
+}
+
+CacheBlock* PersistentCache::Restore(CodePageHandler* codepage, const PhysPt start)
+{
+	// Blocks in pages with self-modifying code are translated with extra
+	// checks, which the stored ones don't have
+	if (!is_active || codepage->invalidation_map) {
+		return nullptr;
+	}
+	++stats.lookups;
+
+	const auto key = MakeKey(PAGING_GetPhysicalAddress(start), GetCurrentMode());
+	auto [it, last] = blocks.equal_range(key);
+	for (; it != last; ++it) {
+		if (!MatchesGuestCode(it->second, start)) {
+			continue;
+		}
+		const auto restore_start = std::chrono::steady_clock::now();
+
+		auto block = Instantiate(codepage, it->second);
+		if (!block) {
+			++stats.relocation_failures;
+			return nullptr;
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - restore_start;
+		stats.restore_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		++stats.hits;
+		return block;
+	}
+	return nullptr;
+}
+
+// Everything the translation of a block depends on besides its code bytes
+uint32_t PersistentCache::GetCurrentMode()
+{
+	return (cpu.code.big ? 1u : 0u) | (cpu.pmode ? 2u : 0u) |
+	       (GETFLAG(VM) ? 4u : 0u) | (check_cast<uint32_t>(cpu.cpl) << 4) |
+	       (static_cast<uint32_t>(CPU_ArchitectureType) << 8);
+}
+
+bool PersistentCache::ReadGuestCode(const PhysPt start, const size_t size,
+                                    std::vector<uint8_t>& code)
+{
+	// Blocks never leave their page
+	if ((start & 4095) + size > 4096) {
+		return false;
+	}
+	code.resize(size);
+	const auto host_page = get_tlb_read(start);
+	if (host_page) {
+		memcpy(code.data(), host_page + start, size);
+	} else {
+		for (size_t i = 0; i < size; ++i) {
+			code[i] = mem_readb(start + check_cast<PhysPt>(i));
+		}
+	}
+	return true;
+}
+
+const void* PersistentCache::GetImageBaseOf(const void* address)
+{
+#if defined(WIN32)
+	HMODULE module = nullptr;
+	if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+	                                GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+	                        static_cast<LPCSTR>(address),
+	                        &module)) {
+		return nullptr;
+	}
+	return module;
+#else
+	Dl_info info = {};
+	if (!dladdr(address, &info)) {
+		return nullptr;
+	}
+	return info.dli_fbase;
+#endif
+}
+
+bool PersistentCache::MatchesGuestCode(const StoredBlock& stored, const PhysPt start) const
+{
+	if ((start & 4095) != stored.page_start) {
+		return false;
+	}
+	const auto host_page = get_tlb_read(start);
+	if (host_page) {
+		return memcmp(host_page + start,
+		              stored.guest_code.data(),
+		              stored.guest_code.size()) == 0;
+	}
+	for (size_t i = 0; i < stored.guest_code.size(); ++i) {
+		if (mem_readb(start + check_cast<PhysPt>(i)) != stored.guest_code[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PersistentCache::ClassifyReloc(const PendingReloc& pending,
+                                    const CacheBlock* block, StoredReloc& stored)
+{
+	const auto offset = pending.pos - block->cache.start;
+	if (offset < 0 || offset > UINT16_MAX) {
+		return false;
+	}
+	stored.offset = static_cast<uint16_t>(offset);
+	stored.form   = pending.form;
+	stored.tail   = pending.tail;
+
+	const auto target = reinterpret_cast<uintptr_t>(pending.target);
+	const auto block_address = reinterpret_cast<uintptr_t>(block);
+	if (target >= block_address && target < block_address + sizeof(CacheBlock)) {
+		stored.base   = RelocBase::Block;
+		stored.addend = static_cast<int64_t>(target - block_address);
+		return true;
+	}
+
+	auto [it, is_new] = image_targets.try_emplace(pending.target, false);
+	if (is_new) {
+		it->second = (GetImageBaseOf(pending.target) == image_base);
+	}
+	if (!it->second) {
+		return false;
+	}
+	stored.base   = RelocBase::Image;
+	stored.addend = static_cast<int64_t>(target - reinterpret_cast<uintptr_t>(image_base));
+	return true;
+}
+
+// Relocates the stored code into the scratch buffer for the given block and
+// code position. Fails if an address doesn't fit its original encoding.
+bool PersistentCache::Relocate(const StoredBlock& stored, const CacheBlock* block,
+                               const uint8_t* code_start)
+{
+	scratch_code = stored.host_code;
+
+	for (const auto& reloc : stored.relocs) {
+		const auto base = (reloc.base == RelocBase::Block)
+		                        ? reinterpret_cast<uintptr_t>(block)
+		                        : reinterpret_cast<uintptr_t>(image_base);
+		const auto target = static_cast<int64_t>(base + static_cast<uintptr_t>(reloc.addend));
+
+		auto field = scratch_code.data() + reloc.offset;
+		switch (reloc.form) {
+		case RelocForm::Abs64:
+			write_unaligned_uint64(field, static_cast<uint64_t>(target));
+			break;
+		case RelocForm::Abs32:
+			if (target < 0 || target > static_cast<int64_t>(UINT32_MAX)) {
+				return false;
+			}
+			write_unaligned_uint32(field, static_cast<uint32_t>(target));
+			break;
+		case RelocForm::Disp32:
+			if (target < 0 || target > INT32_MAX) {
+				return false;
+			}
+			write_unaligned_uint32(field, static_cast<uint32_t>(target));
+			break;
+		case RelocForm::Rel32: {
+			const auto next = reinterpret_cast<int64_t>(code_start) +
+			                  reloc.offset + reloc.tail;
+			const auto diff = target - next;
+			if (diff < INT32_MIN || diff > INT32_MAX) {
+				return false;
+			}
+			write_unaligned_uint32(field, static_cast<uint32_t>(diff));
+			break;
+		}
+		}
+	}
+	return true;
+}
+
+// Mirrors what CreateCacheBlock does to set up a new block, with the stored
+// code taking the place of the translation
+CacheBlock* PersistentCache::Instantiate(CodePageHandler* codepage,
+                                         const StoredBlock& stored)
+{
+	// The code can only be relocated once its place is known. If that
+	// fails, the opened block is given back for the fresh translation.
+	auto block = cache_openblock();
+	if (!Relocate(stored, block, block->cache.start)) {
+		cache_abandonblock();
+		return nullptr;
+	}
+	block->page.start = stored.page_start;
+	codepage->AddCacheBlock(block);
+
+	auto cache_addr = static_cast<void*>(const_cast<uint8_t*>(block->cache.start));
+	constexpr size_t cache_bytes = CACHE_MAXSIZE;
+
+	dyn_mem_write(cache_addr, cache_bytes);
+	memcpy(cache_addr, scratch_code.data(), scratch_code.size());
+	cache.pos = block->cache.start + scratch_code.size();
+
+	for (auto i = stored.page_start; i <= stored.page_end; ++i) {
+		++codepage->write_map[i];
+	}
+
+	cache_block_before_close();
+	cache_closeblock();
+	cache_block_closing(block->cache.start, block->cache.size);
+
+	block->page.end = stored.page_end;
+	dyn_mem_execute(cache_addr, cache_bytes);
+	dyn_cache_invalidate(cache_addr, static_cast<size_t>(block->cache.size));
+	return block;
+}
+
+// Stored blocks are only valid for the exact same executable, so tie them to
+// its path, size, and modification time
+uint64_t PersistentCache::GetBuildId() const
+{
+	std::error_code ec = {};
+
+	const auto& exe_path  = GetExecutableFilePath();
+	const auto exe_size   = std_fs::file_size(exe_path, ec);
+	if (ec) {
+		return 0;
+	}
+	const auto exe_time = std_fs::last_write_time(exe_path, ec);
+	if (ec) {
+		return 0;
+	}
+
+	const auto path_str = exe_path.string();
+	const uint64_t properties[] = {
+	        hash_bytes(reinterpret_cast<const uint8_t*>(path_str.data()),
+	                   path_str.size()),
+	        static_cast<uint64_t>(exe_size),
+	        static_cast<uint64_t>(exe_time.time_since_epoch().count()),
+	        sizeof(CacheBlock),
+	        CACHE_MAXSIZE,
+	        C_TARGETCPU,
+	};
+	return hash_bytes(reinterpret_cast<const uint8_t*>(properties), sizeof(properties));
+}
+
+bool PersistentCache::Load()
+{
+	return load_dynrec_cache(file_path,
+	                         build_id,
+	                         MaxStoredBlocks,
+	                         CACHE_MAXSIZE,
+	                         blocks,
+	                         previous_translate_ns) ==
+	       DynrecCacheLoadResult::Loaded;
+}
+
+void PersistentCache::Save() const
+{
+	const int64_t translate_ns = stats.translations
+	                                   ? stats.translate_ns / stats.translations
+	                                   : previous_translate_ns;
+
+	save_dynrec_cache(file_path, build_id, translate_ns, blocks);
+}
+
+void PersistentCache::LogStatistics() const
+{
+	if (!stats.lookups && !stats.translations) {
+		return;
+	}
+	const auto hit_percent = stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0;
+
+	// Estimate the time saved from this session's average translation
+	// time, or the previous one's if everything came from the cache
+	const auto translate_ns = stats.translations
+	                                ? stats.translate_ns / stats.translations
+	                                : previous_translate_ns;
+	const auto saved_ns = std::max<int64_t>(0, stats.hits * translate_ns - stats.restore_ns);
+
+	LOG_MSG("DYNREC: Persistent cache hits: %u of %u lookups (%.1f%%), "
+	        "%u relocation failures, about %.1f ms of translation saved",
+	        stats.hits,
+	        stats.lookups,
+	        hit_percent,
+	        stats.relocation_failures,
+	        static_cast<double>(saved_ns) / 1e6);
+	LOG_MSG("DYNREC: Persistent cache stored %u of %u new translations "
+	        "(%u not relocatable)",
+	        stats.stored,
+	        stats.translations,
+	        stats.unrelocatable);
+}
@@ -902,6 +902,11 @@ static void inline gen_fill_branch_long(const uint8_t* data) {
 	gen_fill_branch(data);
 }
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	// no register contents are cached between instructions
+}
+
 static void gen_run_code(void) {
 #if C_TARGETCPU == ARMV7LE
 	cache_addd(0xe92d4df0);			// stmfd sp!, {v1-v5,v7,v8,lr}
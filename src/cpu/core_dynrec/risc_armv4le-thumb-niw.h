@@ -1018,6 +1018,11 @@ static void inline gen_fill_branch_long(const uint8_t* data) {
 	cache_addd((uint32_t)cache.pos + 1,data); // add 1 to keep processor in thumb state
 }
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	// no register contents are cached between instructions
+}
+
 static void gen_run_code(void) {
 	const uint8_t *pos1, *pos2, *pos3;
 
@@ -544,6 +544,11 @@ static void inline gen_fill_branch_long(const uint8_t* data) {
 }
 #endif
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	temp1_valid = false;			// the branch may come with another value
+}
+
 static void gen_run_code(void) {
 	temp1_valid = false;
 	cache_addd(0x27bdfff0);			// addiu $sp, $sp, -16
@@ -673,6 +673,11 @@ static void gen_fill_branch_long(const uint8_t* data)
 	return gen_fill_branch(data);
 }
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	// no register contents are cached between instructions
+}
+
 static void cache_block_closing(const uint8_t *block_start, Bitu block_size)
 {
 	// in the Linux kernel i-cache and d-cache are flushed separately
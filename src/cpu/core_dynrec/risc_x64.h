@@ -33,6 +33,11 @@
 #define DRC_CALL_CONV	/* nothing */
 #define DRC_FC			/* nothing */
 
+// use FC_REGS_ADDR to hold the address of "cpu_regs" and to access it using FC_REGS_ADDR
+#define DRC_USE_REGS_ADDR
+// use FC_SEGS_ADDR to hold the address of "Segs" and to access it using FC_SEGS_ADDR
+#define DRC_USE_SEGS_ADDR
+
 
 // register mapping
 typedef uint8_t HostReg;
@@ -43,6 +48,8 @@ typedef uint8_t HostReg;
 #define HOST_EBX 3
 #define HOST_ESI 6
 #define HOST_EDI 7
+#define HOST_R14 14
+#define HOST_R15 15
 
 
 // register that holds function return values
@@ -77,6 +84,17 @@ typedef uint8_t HostReg;
 // temporary register for LEA
 #define TEMP_REG_DRC HOST_ESI
 
+// callee-saved registers holding the address of cpu_regs and Segs; the
+// guest registers and segments are accessed relative to these, which is
+// shorter than addressing them directly, and much shorter than going
+// through a temporary register when the code cache is more than 2GB away
+// from them (as is common for position-independent executables).
+// Only the addressing changes: guest registers still live in memory and
+// are loaded and stored around every instruction, as on the other
+// backends that use DRC_USE_REGS_ADDR.
+#define FC_REGS_ADDR HOST_R14
+#define FC_SEGS_ADDR HOST_R15
+
 
 // move a full register from reg_src to reg_dst
 static void gen_mov_regs(HostReg reg_dst,HostReg reg_src) {
@@ -97,12 +115,14 @@ static inline void gen_reg_memaddr(HostReg reg,void* data,uint8_t op,uint8_t pre
 		cache_addb(op);
 		cache_addb(0x05+(reg<<3));
 		// RIP-relative addressing is offset after the instruction 
+		cache_add_reloc(data,RelocForm::Rel32,4);
 		cache_addd((uint32_t)(((uint64_t)diff)&0xffffffffLL)); 
 	} else if ((uint64_t)data<0x100000000LL) {
 		// mov reg,[data] (or similar, depending on the op) when absolute address of data is <4GB
 		if(prefix) cache_addb(prefix);
 		cache_addb(op);
 		cache_addw(0x2504+(reg<<3));
+		cache_add_reloc(data,RelocForm::Disp32);
 		cache_addd((uint32_t)(((uint64_t)data)&0xffffffffLL));
 	} else {
 		// load 64-bit data into tmp_reg and do mov reg,[tmp_reg] (or similar, depending on the op)
@@ -128,6 +148,7 @@ static inline void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,uint8_t
 		// RIP-relative addressing is offset after the instruction 
 		if(prefix) cache_addb(prefix);
 		cache_addw(op+((modreg+1)<<8));
+		cache_add_reloc(data,RelocForm::Rel32,(uint8_t)(4+off));
 		cache_addd((uint32_t)(((uint64_t)diff)&0xffffffffLL));
 
 		switch(off) {
@@ -140,6 +161,7 @@ static inline void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,uint8_t
 		if(prefix) cache_addb(prefix);
 		cache_addw(op+(modreg<<8));
 		cache_addb(0x25);
+		cache_add_reloc(data,RelocForm::Disp32);
 		cache_addd((uint32_t)(((uint64_t)data)&0xffffffffLL));
 
 		switch(off) {
@@ -188,13 +210,17 @@ static void gen_mov_dword_to_reg_imm(HostReg dest_reg,uint32_t imm) {
 }
 
 // move a 64bit constant value into a full register
+// only used for host addresses, which are noted for the persistent cache
 static void gen_mov_reg_qword(HostReg dest_reg,uint64_t imm) {
 	if (imm==(uint32_t)imm) {
-		gen_mov_dword_to_reg_imm(dest_reg, (uint32_t)imm);
+		cache_addb(0xb8+dest_reg);		// mov dest_reg,imm (zero extended)
+		cache_add_reloc((void*)imm,RelocForm::Abs32);
+		cache_addd((uint32_t)imm);
 		return;
 	}
 	cache_addb(0x48);
 	cache_addb(0xb8+dest_reg);			// mov dest_reg,imm
+	cache_add_reloc((void*)imm,RelocForm::Abs64);
 	cache_addq(imm);
 }
 
@@ -238,7 +264,7 @@ static void gen_mov_byte_to_reg_low_imm_canuseword(HostReg dest_reg,uint8_t imm)
 }
 
 // move the lowest 8bit of a register into memory
-static void gen_mov_byte_from_reg_low(HostReg src_reg,void* dest) {
+[[maybe_unused]] static void gen_mov_byte_from_reg_low(HostReg src_reg,void* dest) {
 	gen_reg_memaddr(src_reg,dest,0x88);	// mov byte [data],reg
 }
 
@@ -373,6 +399,7 @@ static inline void gen_lea(HostReg dest_reg,Bitu scale,Bits imm) {
 // generate a call to a parameterless function
 static void inline gen_call_function_raw(void * func) {
 	cache_addw(0xb848);
+	cache_add_reloc(func,RelocForm::Abs64);
 	cache_addq((uint64_t)func);
 	cache_addw(0xd0ff);
 }
@@ -433,10 +460,12 @@ static void inline gen_load_param_addr(Bitu addr,Bitu param) {
 #if defined (_WIN64)
 		case 2:			// mov r8,addr64
 			cache_addw(0xb849);
+			cache_add_reloc((void*)addr,RelocForm::Abs64);
 			cache_addq(addr);
 			break;
 		case 3:			// mov r9,addr64
 			cache_addw(0xb949);
+			cache_add_reloc((void*)addr,RelocForm::Abs64);
 			cache_addq(addr);
 			break;
 #else
@@ -522,6 +551,7 @@ static void inline gen_load_param_mem(Bitu mem,Bitu param) {
 // jump to an address pointed at by ptr, offset is in imm
 static void gen_jmp_ptr(void * ptr,Bits imm=0) {
 	cache_addw(0xa148);		// mov rax,[data]
+	cache_add_reloc(ptr,RelocForm::Abs64);
 	cache_addq((uint64_t)ptr);
 
 	cache_addb(0xff);		// jmp [rax+imm]
@@ -599,13 +629,22 @@ static void gen_fill_branch_long(const uint8_t* data) {
 	cache_addd((uint32_t)(cache.pos-data-4),data);
 }
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	// no register contents are cached between instructions
+}
+
 static void gen_run_code(void) {
 	cache_addw(0x5355);     // push rbp,rbx
 	cache_addb(0x56);       // push rsi
+	cache_addd(0x57415641); // push r14,r15
 	cache_addd(0x20EC8348); // sub rsp, 32
+	cache_addw(0xbe49);cache_addq((uint64_t)&cpu_regs); // mov FC_REGS_ADDR, &cpu_regs
+	cache_addw(0xbf49);cache_addq((uint64_t)&Segs);     // mov FC_SEGS_ADDR, &Segs
 	cache_addb(0x48);cache_addw(0x2D8D);cache_addd(2); // lea rbp, [rip+2]
 	cache_addw(0xE0FF+(FC_OP1<<8)); // jmp FC_OP1
 	cache_addd(0x20C48348); // add rsp, 32
+	cache_addd(0x5E415F41); // pop r15,r14
 	cache_addd(0xC35D5B5E); // pop rsi,rbx,rbp;ret
 }
 
@@ -620,6 +659,8 @@ static void gen_return_function(void) {
 // check gen_call_function_raw and gen_call_function_setup
 // for the targeted code
 static void gen_fill_function_ptr(const uint8_t * pos,void* fct_ptr,Bitu flags_type) {
+	// the original function pointer is replaced (or removed)
+	cache_replace_reloc(pos+2,nullptr,RelocForm::Abs64);
 #ifdef DRC_FLAGS_INVALIDATION_DCODE
 	// try to avoid function calls but rather directly fill in code
 	switch (flags_type) {
@@ -689,6 +730,7 @@ static void gen_fill_function_ptr(const uint8_t * pos,void* fct_ptr,Bitu flags_t
 			return;
 	}
 #endif
+	cache_replace_reloc(pos+2,fct_ptr,RelocForm::Abs64);
 	cache_addq((uint64_t)fct_ptr,pos+2);      // fill function pointer
 }
 #endif
@@ -696,3 +738,106 @@ static void gen_fill_function_ptr(const uint8_t * pos,void* fct_ptr,Bitu flags_t
 static void cache_block_closing([[maybe_unused]] const uint8_t* block_start, [[maybe_unused]] Bitu block_size) { }
 
 static void cache_block_before_close(void) { }
+
+// This function generates an instruction with register addressing and a
+// memory location at base_reg+index, where base_reg is one of r8-r15
+// (but not r12 or r13, which would need a different encoding)
+static void gen_reg_baseaddr(HostReg reg,HostReg base_reg,Bitu index,uint8_t op,uint8_t prefix=0) {
+	if (prefix==0x66) cache_addb(prefix);
+	cache_addb(0x41);		// REX.B to select the base register
+	if (prefix==0x0f) cache_addb(prefix);
+	cache_addb(op);
+	if (index<0x80) {
+		cache_addb(0x40+(reg<<3)+(base_reg&7));	// [base_reg+disp8]
+		cache_addb((uint8_t)index);
+	} else {
+		cache_addb(0x80+(reg<<3)+(base_reg&7));	// [base_reg+disp32]
+		cache_addd((uint32_t)index);
+	}
+}
+
+#ifdef DRC_USE_SEGS_ADDR
+
+// mov 16bit value from Segs[index] into dest_reg using FC_SEGS_ADDR (index modulo 2 must be zero)
+// 16bit moves may destroy the upper 16bit of the destination register
+static void gen_mov_seg16_to_reg(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_SEGS_ADDR,index,0xb7,0x0f);	// movzx dest_reg,word [FC_SEGS_ADDR+index]
+}
+
+// mov 32bit value from Segs[index] into dest_reg using FC_SEGS_ADDR (index modulo 4 must be zero)
+static void gen_mov_seg32_to_reg(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_SEGS_ADDR,index,0x8b);	// mov dest_reg,[FC_SEGS_ADDR+index]
+}
+
+// add a 32bit value from Segs[index] to a full register using FC_SEGS_ADDR (index modulo 4 must be zero)
+static void gen_add_seg32_to_reg(HostReg reg,Bitu index) {
+	gen_reg_baseaddr(reg,FC_SEGS_ADDR,index,0x03);	// add reg,[FC_SEGS_ADDR+index]
+}
+
+#endif
+
+#ifdef DRC_USE_REGS_ADDR
+
+// mov 16bit value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (index modulo 2 must be zero)
+// 16bit moves may destroy the upper 16bit of the destination register
+static void gen_mov_regval16_to_reg(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_REGS_ADDR,index,0xb7,0x0f);	// movzx dest_reg,word [FC_REGS_ADDR+index]
+}
+
+// mov 32bit value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (index modulo 4 must be zero)
+static void gen_mov_regval32_to_reg(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_REGS_ADDR,index,0x8b);	// mov dest_reg,[FC_REGS_ADDR+index]
+}
+
+// move a 32bit (dword==true) or 16bit (dword==false) value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
+// 16bit moves may destroy the upper 16bit of the destination register
+static void gen_mov_regword_to_reg(HostReg dest_reg,Bitu index,bool dword) {
+	if (dword) gen_mov_regval32_to_reg(dest_reg,index);
+	else gen_mov_regval16_to_reg(dest_reg,index);
+}
+
+// move an 8bit value from cpu_regs[index]  into dest_reg using FC_REGS_ADDR
+// the upper 24bit of the destination register can be destroyed
+// this function does not use FC_OP1/FC_OP2 as dest_reg as these
+// registers might not be directly byte-accessible on some architectures
+static void gen_mov_regbyte_to_reg_low(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_REGS_ADDR,index,0xb6,0x0f);	// movzx dest_reg,byte [FC_REGS_ADDR+index]
+}
+
+// move an 8bit value from cpu_regs[index]  into dest_reg using FC_REGS_ADDR
+// the upper 24bit of the destination register can be destroyed
+// this function can use FC_OP1/FC_OP2 as dest_reg which are
+// not directly byte-accessible on some architectures
+static void gen_mov_regbyte_to_reg_low_canuseword(HostReg dest_reg,Bitu index) {
+	gen_reg_baseaddr(dest_reg,FC_REGS_ADDR,index,0xb6,0x0f);	// movzx dest_reg,byte [FC_REGS_ADDR+index]
+}
+
+
+// add a 32bit value from cpu_regs[index] to a full register using FC_REGS_ADDR (index modulo 4 must be zero)
+static void gen_add_regval32_to_reg(HostReg reg,Bitu index) {
+	gen_reg_baseaddr(reg,FC_REGS_ADDR,index,0x03);	// add reg,[FC_REGS_ADDR+index]
+}
+
+
+// move 16bit of register into cpu_regs[index] using FC_REGS_ADDR (index modulo 2 must be zero)
+static void gen_mov_regval16_from_reg(HostReg src_reg,Bitu index) {
+	gen_reg_baseaddr(src_reg,FC_REGS_ADDR,index,0x89,0x66);	// mov word [FC_REGS_ADDR+index],src_reg
+}
+
+// move 32bit of register into cpu_regs[index] using FC_REGS_ADDR (index modulo 4 must be zero)
+static void gen_mov_regval32_from_reg(HostReg src_reg,Bitu index) {
+	gen_reg_baseaddr(src_reg,FC_REGS_ADDR,index,0x89);	// mov [FC_REGS_ADDR+index],src_reg
+}
+
+// move 32bit (dword==true) or 16bit (dword==false) of a register into cpu_regs[index] using FC_REGS_ADDR (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
+static void gen_mov_regword_from_reg(HostReg src_reg,Bitu index,bool dword) {
+	if (dword) gen_mov_regval32_from_reg(src_reg,index);
+	else gen_mov_regval16_from_reg(src_reg,index);
+}
+
+// move the lowest 8bit of a register into cpu_regs[index] using FC_REGS_ADDR
+static void gen_mov_regbyte_from_reg_low(HostReg src_reg,Bitu index) {
+	gen_reg_baseaddr(src_reg,FC_REGS_ADDR,index,0x88);	// mov byte [FC_REGS_ADDR+index],src_reg
+}
+
+#endif
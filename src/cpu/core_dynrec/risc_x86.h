@@ -419,6 +419,11 @@ static void gen_fill_branch_long(const uint8_t* data) {
 	cache_addd((uint32_t)(cache.pos-data-4),data);
 }
 
+// the following code is also reached by a branch generated later on
+static void inline gen_branch_target(void) {
+	// no register contents are cached between instructions
+}
+
 
 static void gen_run_code(void) {
 	cache_addd(0x0424448b);		// mov eax,[esp+4]
@@ -56,6 +56,10 @@
 	auto add_index = cpu.direction;
 	if (count) switch (inst.code.op) {
 	case R_OUTSB:
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::byte>(
+			        reg_dx, si_base, si_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			IO_WriteB(reg_dx,LoadMb(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
@@ -63,6 +67,10 @@
 		break;
 	case R_OUTSW:
 		add_index *= 2;
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::word>(
+			        reg_dx, si_base, si_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			IO_WriteW(reg_dx,LoadMw(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
@@ -70,12 +78,20 @@
 		break;
 	case R_OUTSD:
 		add_index *= 4;
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::dword>(
+			        reg_dx, si_base, si_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			IO_WriteD(reg_dx,LoadMd(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
 		}
 		break;
 	case R_INSB:
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::byte>(
+			        reg_dx, di_base, di_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			SaveMb(di_base+di_index,IO_ReadB(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
@@ -83,6 +99,10 @@
 		break;
 	case R_INSW:
 		add_index *= 2;
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::word>(
+			        reg_dx, di_base, di_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			SaveMw(di_base+di_index,IO_ReadW(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
@@ -90,6 +110,10 @@
 		break;
 	case R_INSD:
 		add_index *= 4;
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::dword>(
+			        reg_dx, di_base, di_index, add_mask, static_cast<uint32_t>(count));
+		}
 		for (;count>0;count--) {
 			SaveMd(di_base+di_index,IO_ReadD(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
@@ -52,6 +52,10 @@ static void DoString(STRING_OP type) {
 	auto add_index = cpu.direction;
 	if (count) switch (type) {
 	case R_OUTSB:
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::byte>(
+			        reg_dx, si_base, si_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			IO_WriteB(reg_dx,LoadMb(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
@@ -59,6 +63,10 @@ static void DoString(STRING_OP type) {
 		break;
 	case R_OUTSW:
 		add_index *= 2;
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::word>(
+			        reg_dx, si_base, si_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			IO_WriteW(reg_dx,LoadMw(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
@@ -66,12 +74,20 @@ static void DoString(STRING_OP type) {
 		break;
 	case R_OUTSD:
 		add_index *= 4;
+		if (count > 1 && add_index > 0) {
+			count -= rep_outs_block<io_width_t::dword>(
+			        reg_dx, si_base, si_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			IO_WriteD(reg_dx,LoadMd(si_base+si_index));
 			si_index=(si_index+add_index) & add_mask;
 		}
 		break;
 	case R_INSB:
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::byte>(
+			        reg_dx, di_base, di_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			SaveMb(di_base+di_index,IO_ReadB(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
@@ -79,6 +95,10 @@ static void DoString(STRING_OP type) {
 		break;
 	case R_INSW:
 		add_index *= 2;
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::word>(
+			        reg_dx, di_base, di_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			SaveMw(di_base+di_index,IO_ReadW(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
@@ -86,6 +106,10 @@ static void DoString(STRING_OP type) {
 		break;
 	case R_INSD:
 		add_index *= 4;
+		if (count > 1 && add_index > 0) {
+			count -= rep_ins_block<io_width_t::dword>(
+			        reg_dx, di_base, di_index, add_mask, count);
+		}
 		for (;count>0;count--) {
 			SaveMd(di_base+di_index,IO_ReadD(reg_dx));
 			di_index=(di_index+add_index) & add_mask;
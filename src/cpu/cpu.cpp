@@ -79,11 +79,14 @@ void CPU_Core_Simple_Init(void);
 void CPU_Core_Dyn_X86_Init(void);
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
 void CPU_Core_Dyn_X86_Cache_Close(void);
+void CPU_Core_Dyn_X86_Cache_SetMaxSize(size_t max_size);
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 #elif (C_DYNREC)
 void CPU_Core_Dynrec_Init(void);
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close(void);
+void CPU_Core_Dynrec_Cache_SetMaxSize(size_t max_size);
+void CPU_Core_Dynrec_PersistentCache_Init(bool enable);
 #endif
 
 /* In debug mode exceptions are tested and dosbox exits when 
@@ -2427,9 +2430,16 @@ public:
 #endif
 		}
 
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+		const auto dyn_cache_max_size = static_cast<size_t>(
+		        section->Get_int("dynamic_core_memsize")) * 1024 * 1024;
+#endif
 #if (C_DYNAMIC_X86)
+		CPU_Core_Dyn_X86_Cache_SetMaxSize(dyn_cache_max_size);
 		CPU_Core_Dyn_X86_Cache_Init((core == "dynamic") || (core == "dynamic_nodhfpu"));
 #elif (C_DYNREC)
+		CPU_Core_Dynrec_Cache_SetMaxSize(dyn_cache_max_size);
+		CPU_Core_Dynrec_PersistentCache_Init(section->Get_bool("dynamic_core_cache"));
 		CPU_Core_Dynrec_Cache_Init( core == "dynamic" );
 #endif
 
@@ -19,10 +19,13 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <memory>
 #include <new>
 #include <type_traits>
+#include <vector>
 
 #include "mem_unaligned.h"
 #include "paging.h"
@@ -47,6 +50,8 @@
 
 class CodePageHandler;
 
+static DynamicCoreCacheStats cache_stats = {};
+
 // basic cache block representation
 class CacheBlock {
 public:
@@ -69,6 +74,15 @@ public:
 		link[index].to=toblock;
 		link[index].next = toblock->link[index].from; // set target block
 		toblock->link[index].from = this; // remember who links me
+		++cache_stats.links;
+	}
+
+	// count the entries from the core, so eviction can spare hot blocks
+	void MarkUsed()
+	{
+		if (use_count < UINT8_MAX) {
+			++use_count;
+		}
 	}
 
 	struct Page {
@@ -116,6 +130,14 @@ public:
 	} link[2] = {};                // maximum two links (conditional jumps)
 
 	CacheBlock* crossblock = {};
+
+	// entries since the block was created, halved each time eviction
+	// spares the block
+	uint8_t use_count = 0;
+
+	// nonzero from translation until the block is cleared, checked by the
+	// generated code before it jumps back to the start of its own block
+	uint32_t valid = 0;
 };
 
 static_assert(std::is_standard_layout_v<CacheBlock::Page>, "standard-layout is required for offsetof");
@@ -151,7 +173,18 @@ static uint8_t* cache_code_start_ptr   = {};
 static uint8_t* cache_code             = {};
 static uint8_t* cache_code_link_blocks = {};
 
-static std::vector<CacheBlock> cache_blocks(CACHE_BLOCKS);
+// the code cache starts at CACHE_TOTAL bytes and grows up to the
+// configured maximum when it fills up
+static size_t cache_code_total = CACHE_TOTAL;
+static size_t cache_code_max   = CACHE_TOTAL;
+// bytes from cache_code_start_ptr on that are committed (Windows only)
+static size_t cache_code_committed = 0;
+// end of the highest code written so far, which can lie past the end of
+// the last block if it overran
+static const uint8_t* cache_code_high_water = {};
+
+// the cache blocks are allocated in chunks so they never move
+static std::vector<std::unique_ptr<CacheBlock[]>> cache_block_chunks = {};
 static CacheBlock link_blocks[2] = {}; // default linking (specially marked)
 
 // the CodePageHandler class provides access to the contained
@@ -215,6 +248,7 @@ public:
 					block->Clear(); // clear the block,
 					                // decrements the
 					                // write_map accordingly
+					++cache_stats.smc_invalidations;
 				}
 				block=nextblock;
 			}
@@ -570,12 +604,23 @@ static inline void cache_add_unused_block(CacheBlock *block)
 	cache.block.free = block;
 }
 
+static void cache_add_blocks(const size_t num_blocks)
+{
+	auto& chunk = cache_block_chunks.emplace_back(
+	        std::make_unique<CacheBlock[]>(num_blocks));
+	for (size_t i = 0; i < num_blocks; ++i) {
+		chunk[i].link[0].to = (CacheBlock *)1;
+		chunk[i].link[1].to = (CacheBlock *)1;
+		cache_add_unused_block(&chunk[i]);
+	}
+}
+
 static CacheBlock *cache_getblock()
 {
 	// get a free cache block and advance the free pointer
+	if (!cache.block.free)
+		cache_add_blocks(CACHE_BLOCKS / 4);
 	CacheBlock *ret = cache.block.free;
-	if (!ret)
-		E_Exit("Ran out of CacheBlocks");
 	cache.block.free=ret->cache.next;
 	ret->cache.next=nullptr;
 	return ret;
@@ -660,6 +705,7 @@ inline void CacheBlock::Cache::AddDwordToWriteMaskAt(const size_t page_index)
 
 void CacheBlock::Clear()
 {
+	valid=0;
 	Bitu ind;
 	// check if this is not a cross page block
 	if (hash.index) for (ind=0;ind<2;ind++) {
@@ -671,6 +717,7 @@ void CacheBlock::Clear()
 			// standard linkcode
 			fromlink->link[ind].next=nullptr;
 			fromlink->link[ind].to=&link_blocks[ind];
+			++cache_stats.unlinks;
 
 			fromlink=nextlink;
 		}
@@ -682,9 +729,10 @@ void CacheBlock::Clear()
 				wherelink = &(*wherelink)->link[ind].next;
 			}
 			// now remove the link
-			if (*wherelink)
+			if (*wherelink) {
 				*wherelink = (*wherelink)->link[ind].next;
-			else
+				++cache_stats.unlinks;
+			} else
 				LOG(LOG_CPU, LOG_ERROR)("Cache anomaly. please investigate");
 		}
 	} else {
@@ -704,14 +752,70 @@ void CacheBlock::Clear()
 	cache.DeleteWriteMask();
 }
 
+static bool cache_grow(CacheBlock *block);
+
+// see if the code following this block leaves no room for another one
+static bool cache_is_full_after(const CacheBlock *block)
+{
+#if (C_DYNAMIC_X86)
+	return !block->cache.next;
+#elif (C_DYNREC)
+	const uint8_t *limit = (cache_code_start_ptr + cache_code_total - CACHE_MAXSIZE);
+	return (!block->cache.next || (block->cache.next->cache.start > limit));
+#endif
+}
+
+// advance the active block pointer past this block, growing the cache
+// or restarting at its beginning when the end is reached
+static void cache_advance_active(CacheBlock *block)
+{
+	if (cache_is_full_after(block) && !cache_grow(block)) {
+		// LOG_DEBUG("Cache full; restarting");
+		cache.block.active=cache.block.first;
+	} else {
+		cache.block.active=block->cache.next;
+	}
+}
+
+// Blocks that were entered since the allocation last passed them are likely
+// to be needed again soon, so don't evict them right away but halve their
+// use count and move on (a second chance as in CLOCK replacement). The
+// number of skips is limited to keep the allocation cheap.
+static void cache_skip_used_blocks()
+{
+	constexpr int max_skips = 16;
+	for (int skips = 0; skips < max_skips; ++skips) {
+		// look at all the blocks a new block would take over
+		CacheBlock *used_block = nullptr;
+		Bitu size = 0;
+		for (auto block = cache.block.active; block && size < CACHE_MAXSIZE;
+		     block = block->cache.next) {
+			if (block->page.handler && block->use_count) {
+				used_block = block;
+				break;
+			}
+			size += block->cache.size;
+		}
+		if (!used_block)
+			return;
+		used_block->use_count >>= 1;
+		++cache_stats.blocks_spared;
+		cache_advance_active(used_block);
+	}
+}
+
 static CacheBlock *cache_openblock()
 {
+	cache_skip_used_blocks();
+
 	CacheBlock *block = cache.block.active;
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlock *nextblock = block->cache.next;
-	if (block->page.handler)
+	if (block->page.handler) {
 		block->Clear();
+		++cache_stats.blocks_evicted;
+	}
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
 		if (!nextblock)
@@ -719,8 +823,10 @@ static CacheBlock *cache_openblock()
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlock *tempblock = nextblock->cache.next;
-		if (nextblock->page.handler)
+		if (nextblock->page.handler) {
 			nextblock->Clear();
+			++cache_stats.blocks_evicted;
+		}
 		// block is free now
 		cache_add_unused_block(nextblock);
 		nextblock=tempblock;
@@ -729,6 +835,8 @@ skipresize:
 	// adjust parameters and open this block
 	block->cache.size=size;
 	block->cache.next=nextblock;
+	block->use_count=0;
+	block->valid=1;
 	cache.pos=block->cache.start;
 	return block;
 }
@@ -745,6 +853,8 @@ static void cache_closeblock()
 	block->link[1].next=nullptr;
 	// close the block with correct alignment
 	Bitu written = (Bitu)(cache.pos - block->cache.start);
+	cache_code_high_water = std::max(cache_code_high_water, cache.pos);
+	++cache_stats.blocks_created;
 	if (written>block->cache.size) {
 		if (!block->cache.next) {
 			if (written > block->cache.size + CACHE_MAXSIZE)
@@ -769,20 +879,16 @@ static void cache_closeblock()
 			block->cache.size=new_size;
 		}
 	}
-	// advance the active block pointer
-#if (C_DYNAMIC_X86)
-	const bool cache_is_full = !block->cache.next;
-#elif (C_DYNREC)
-	const uint8_t *limit = (cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE);
-	const bool cache_is_full = (!block->cache.next ||
-	                            (block->cache.next->cache.start > limit));
-#endif
-	if (cache_is_full) {
-		// LOG_DEBUG("Cache full; restarting");
-		cache.block.active=cache.block.first;
-	} else {
-		cache.block.active=block->cache.next;
-	}
+	cache_advance_active(block);
+}
+
+// give back an opened block that ends up without code; it stays the active
+// block, so the next cache_openblock reuses it
+static void cache_abandonblock()
+{
+	CacheBlock *block = cache.block.active;
+	block->valid = 0;
+	cache.pos = block->cache.start;
 }
 
 // TODO functions cache_addb, cache_addw, cache_addd, cache_addq definitely
@@ -857,7 +963,12 @@ static void cache_block_before_close();
 static void cache_block_closing(const uint8_t *block_start, Bitu block_size);
 #endif
 
-static constexpr size_t cache_code_size = CACHE_TOTAL + CACHE_MAXSIZE + host_pagesize - 1 + host_pagesize;
+// the address space for the largest cache is reserved up front so the code
+// never moves when the cache grows
+static size_t cache_code_reserve_size()
+{
+	return cache_code_max + CACHE_MAXSIZE + host_pagesize - 1 + host_pagesize;
+}
 constexpr bool is_64bit_platform = sizeof(void *) == 8;
 
 static inline void dyn_mem_adjust(void *&ptr, size_t &size)
@@ -965,6 +1076,110 @@ static inline void dyn_cache_invalidate([[maybe_unused]] void *ptr,
 #endif
 }
 
+// make the code cache memory up to the given cache size usable; only
+// needed on Windows, where the address space is merely reserved up front.
+// Only the pages past the already committed part are committed, so the
+// protection of pages holding live code is left alone.
+static bool cache_commit_code([[maybe_unused]] const size_t total)
+{
+#if defined(WIN32)
+	const auto page_mask = static_cast<size_t>(host_pagesize) - 1;
+	const auto wanted = std::min((static_cast<size_t>(cache_code - cache_code_start_ptr) +
+	                              total + CACHE_MAXSIZE + page_mask) & ~page_mask,
+	                             cache_code_reserve_size());
+	if (wanted <= cache_code_committed) {
+		return true;
+	}
+	const DWORD flags = CPU_UseRwxMemProtect
+	                          ? PAGE_EXECUTE_READWRITE // all operations allowed
+	                          : PAGE_READWRITE; // needs on-going management
+	const auto lp_vmem = VirtualAlloc(cache_code_start_ptr + cache_code_committed,
+	                                  wanted - cache_code_committed,
+	                                  MEM_COMMIT,
+	                                  flags);
+	if (!lp_vmem) {
+		LOG_ERR("DYNCACHE: Failed committing %zu bytes of cache memory, error %lu",
+		        wanted - cache_code_committed,
+		        GetLastError());
+		return false;
+	}
+	cache_code_committed = wanted;
+#endif
+	return true;
+}
+
+static void cache_add_code_pages(const size_t num_pages)
+{
+	for (size_t i = 0; i < num_pages; ++i) {
+		auto newpage = new (std::nothrow) CodePageHandler();
+		if (!newpage) {
+			E_Exit("DYN_CACHE: Failed to allocate code-page handler");
+		}
+		newpage->next = cache.free_pages;
+		cache.free_pages=newpage;
+	}
+}
+
+// The cache doubles in size (up to its maximum) whenever it fills up, rather
+// than starting over and evicting all the blocks in its way. The new space is
+// added as a free block after the last one.
+static bool cache_grow(CacheBlock *block)
+{
+	if (cache_code_total >= cache_code_max)
+		return false;
+	const auto new_total = std::min(cache_code_total * 2, cache_code_max);
+	if (!cache_commit_code(new_total)) {
+		// keep running with the cache we have rather than retrying
+		LOG_WARNING("DYNCACHE: Keeping the code cache at %zu MB",
+		            cache_code_total / (1024 * 1024));
+		cache_code_max = cache_code_total;
+		return false;
+	}
+
+	CacheBlock *last_block = block;
+	while (last_block->cache.next)
+		last_block = last_block->cache.next;
+
+	// skip code that overran the end of the last block
+	const auto end_of_code = std::max(last_block->cache.start + last_block->cache.size,
+	                                  cache_code_high_water);
+	const auto new_start = reinterpret_cast<const uint8_t *>(
+	        (reinterpret_cast<uintptr_t>(end_of_code) + CACHE_ALIGN - 1) &
+	        ~static_cast<uintptr_t>(CACHE_ALIGN - 1));
+	const auto new_end = cache_code + new_total;
+	assert(new_start < new_end);
+
+	last_block->cache.size = static_cast<Bitu>(new_start - last_block->cache.start);
+
+	CacheBlock *newblock = cache_getblock();
+	newblock->cache.start = new_start;
+	newblock->cache.size = static_cast<Bitu>(new_end - new_start);
+	last_block->cache.next = newblock;
+
+	// keep the number of code pages in proportion
+	cache_add_code_pages(CACHE_PAGES * (new_total - cache_code_total) / CACHE_TOTAL);
+
+	cache_code_total = new_total;
+	++cache_stats.cache_growths;
+	return true;
+}
+
+// the maximum can only be set before the cache is first initialized
+static void cache_set_max_size(const size_t max_size)
+{
+	if (cache_code_start_ptr == nullptr) {
+		cache_code_max = std::max(max_size, static_cast<size_t>(CACHE_TOTAL));
+	}
+}
+
+DynamicCoreCacheStats CPU_GetDynamicCoreCacheStats()
+{
+	auto stats = cache_stats;
+	stats.cache_size_bytes = cache_code_total;
+	stats.cache_max_size_bytes = cache_code_max;
+	return stats;
+}
+
 static bool cache_initialized = false;
 
 static void cache_init(bool enable) {
@@ -974,27 +1189,18 @@ static void cache_init(bool enable) {
 			return;
 		}
 		cache_initialized = true;
-		cache.block.free = &cache_blocks[0];
 		// initialize the cache blocks
-		for (int i=0;i<CACHE_BLOCKS-1;i++) {
-			cache_blocks[i].link[0].to = (CacheBlock *)1;
-			cache_blocks[i].link[1].to = (CacheBlock *)1;
-			cache_blocks[i].cache.next = &cache_blocks[i + 1];
-		}
+		cache_add_blocks(CACHE_BLOCKS);
 		if (cache_code_start_ptr == nullptr) {
 			// allocate the code cache memory
+			const auto cache_code_size = cache_code_reserve_size();
 #if defined (WIN32)
-			LPVOID lp_vmem = nullptr;
-			if (CPU_UseRwxMemProtect) {
-				lp_vmem = VirtualAlloc(nullptr, cache_code_size,
-				                       MEM_COMMIT,
-				                       PAGE_EXECUTE_READWRITE); // all operations allowed
-			} else {
-				lp_vmem = VirtualAlloc(nullptr, cache_code_size,
-				                       MEM_COMMIT | MEM_RESERVE,
-				                       PAGE_READWRITE); // needs on-going management
+			LPVOID lp_vmem = VirtualAlloc(nullptr, cache_code_size,
+			                              MEM_RESERVE, PAGE_NOACCESS);
+			if (!lp_vmem) {
+				E_Exit("DYNCACHE: Failed reserving cache memory, error %lu",
+				       GetLastError());
 			}
-			assert(lp_vmem);
 			cache_code_start_ptr = static_cast<uint8_t *>(lp_vmem);
 #elif defined(HAVE_MMAP)
 			int map_flags = MAP_PRIVATE | MAP_ANON;
@@ -1002,6 +1208,7 @@ static void cache_init(bool enable) {
 #if defined(HAVE_MAP_JIT)
 			map_flags |= MAP_JIT;
 #endif
+			// pages of the mapping only take up memory once used
 			cache_code_start_ptr=static_cast<uint8_t *>(mmap(nullptr, cache_code_size, prot_flags, map_flags, -1, 0));
 			if (cache_code_start_ptr == MAP_FAILED) {
 				E_Exit("DYNCACHE: Failed memory-mapping cache memory because: %s", strerror(errno));
@@ -1019,11 +1226,14 @@ static void cache_init(bool enable) {
 
 			cache_code_link_blocks=cache_code;
 			cache_code=cache_code+host_pagesize;
+			if (!cache_commit_code(cache_code_total)) {
+				E_Exit("DYNCACHE: Failed committing the initial cache memory");
+			}
 			CacheBlock *block = cache_getblock();
 			cache.block.first=block;
 			cache.block.active=block;
 			block->cache.start=&cache_code[0];
-			block->cache.size=CACHE_TOTAL;
+			block->cache.size=cache_code_total;
 			block->cache.next = nullptr; // last block in the list
 		}
 
@@ -1073,14 +1283,7 @@ static void cache_init(bool enable) {
 		cache.last_page=nullptr;
 		cache.used_pages=nullptr;
 		// setup the code pages
-		for (int i=0;i<CACHE_PAGES;i++) {
-			auto newpage = new (std::nothrow) CodePageHandler();
-			if (!newpage) {
-				E_Exit("DYN_CACHE: Failed to allocate code-page handler");
-			}
-			newpage->next = cache.free_pages;
-			cache.free_pages=newpage;
-		}
+		cache_add_code_pages(CACHE_PAGES * cache_code_total / CACHE_TOTAL);
 	}
 }
 
@@ -0,0 +1,248 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "dynrec_cache_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "logging.h"
+
+constexpr char DynrecCacheMagic[8] = {'D', 'R', 'C', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t DynrecCacheVersion = 3;
+
+uint64_t hash_bytes(const uint8_t* data, const size_t size, uint64_t hash)
+{
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ data[i]) * 0x100000001b3;
+	}
+	return hash;
+}
+
+template <typename T>
+static uint64_t hash_value(const T& value, const uint64_t hash)
+{
+	return hash_bytes(reinterpret_cast<const uint8_t*>(&value), sizeof(value), hash);
+}
+
+// Covers everything that ends up in the executed code. The relocations are
+// hashed field by field, as their struct has padding.
+static uint64_t checksum_block(const StoredBlock& stored)
+{
+	auto hash = hash_bytes(stored.host_code.data(), stored.host_code.size());
+	for (const auto& reloc : stored.relocs) {
+		hash = hash_value(reloc.offset, hash);
+		hash = hash_value(reloc.form, hash);
+		hash = hash_value(reloc.base, hash);
+		hash = hash_value(reloc.tail, hash);
+		hash = hash_value(reloc.addend, hash);
+	}
+	return hash;
+}
+
+template <typename T>
+static bool read_value(std::ifstream& file, T& value)
+{
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+template <typename T>
+static void write_value(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Returns nullptr if the block is valid, otherwise the reason it isn't
+static const char* read_block(std::ifstream& file, const size_t max_code_size,
+                              uint64_t& key, StoredBlock& stored)
+{
+	uint32_t phys_start = 0;
+	uint32_t mode       = 0;
+	uint64_t checksum   = 0;
+	uint16_t guest_size = 0;
+	uint16_t host_size  = 0;
+	uint16_t num_relocs = 0;
+
+	if (!read_value(file, phys_start) || !read_value(file, mode) ||
+	    !read_value(file, stored.code_hash) || !read_value(file, checksum) ||
+	    !read_value(file, guest_size) || !read_value(file, host_size) ||
+	    !read_value(file, num_relocs)) {
+		return "truncated block";
+	}
+	key = (static_cast<uint64_t>(mode) << 32) | phys_start;
+
+	stored.page_start = static_cast<uint16_t>(phys_start & 4095);
+	if (guest_size == 0 || stored.page_start + guest_size > 4096 ||
+	    host_size > max_code_size) {
+		return "bad block size";
+	}
+	stored.page_end = static_cast<uint16_t>(stored.page_start + guest_size - 1);
+
+	stored.guest_code.resize(guest_size);
+	stored.host_code.resize(host_size);
+	if (!file.read(reinterpret_cast<char*>(stored.guest_code.data()), guest_size) ||
+	    !file.read(reinterpret_cast<char*>(stored.host_code.data()), host_size)) {
+		return "truncated code";
+	}
+	if (hash_bytes(stored.guest_code.data(), guest_size) != stored.code_hash) {
+		return "guest code hash mismatch";
+	}
+
+	stored.relocs.resize(num_relocs);
+	for (auto& reloc : stored.relocs) {
+		if (!read_value(file, reloc.offset) || !read_value(file, reloc.form) ||
+		    !read_value(file, reloc.base) || !read_value(file, reloc.tail) ||
+		    !read_value(file, reloc.addend)) {
+			return "truncated relocations";
+		}
+		const auto field_size = (reloc.form == RelocForm::Abs64) ? 8 : 4;
+		if (reloc.form > RelocForm::Rel32 || reloc.base > RelocBase::Block ||
+		    reloc.offset + field_size > host_size) {
+			return "bad relocation";
+		}
+	}
+	if (checksum_block(stored) != checksum) {
+		return "host code checksum mismatch";
+	}
+	return nullptr;
+}
+
+DynrecCacheLoadResult load_dynrec_cache(const std_fs::path& path,
+                                        const uint64_t build_id,
+                                        const size_t max_blocks,
+                                        const size_t max_code_size,
+                                        StoredBlocks& blocks,
+                                        int64_t& translate_ns)
+{
+	blocks.clear();
+	translate_ns = 0;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return DynrecCacheLoadResult::NoFile;
+	}
+
+	auto reject = [&](const char* reason) {
+		LOG_WARNING("DYNREC: Discarding corrupt persistent cache (%s)", reason);
+		blocks.clear();
+		translate_ns = 0;
+
+		file.close();
+		std::error_code ec = {};
+		std_fs::remove(path, ec);
+		return DynrecCacheLoadResult::Corrupt;
+	};
+
+	char magic[sizeof(DynrecCacheMagic)] = {};
+	uint32_t version    = 0;
+	uint64_t file_build = 0;
+	uint32_t num_blocks = 0;
+
+	if (!file.read(magic, sizeof(magic)) || !read_value(file, version) ||
+	    !read_value(file, file_build) || !read_value(file, translate_ns) ||
+	    !read_value(file, num_blocks)) {
+		return reject("truncated header");
+	}
+	if (memcmp(magic, DynrecCacheMagic, sizeof(magic)) != 0 ||
+	    version != DynrecCacheVersion || file_build != build_id) {
+		LOG_MSG("DYNREC: Ignoring the persistent cache from a different build");
+		translate_ns = 0;
+		return DynrecCacheLoadResult::OtherBuild;
+	}
+	if (num_blocks > max_blocks) {
+		return reject("too many blocks");
+	}
+
+	for (uint32_t i = 0; i < num_blocks; ++i) {
+		uint64_t key       = 0;
+		StoredBlock stored = {};
+		if (const auto reason = read_block(file, max_code_size, key, stored)) {
+			return reject(reason);
+		}
+		blocks.emplace(key, std::move(stored));
+	}
+
+	// Anything after the last block means the file isn't what was written
+	if (file.peek() != std::ifstream::traits_type::eof()) {
+		return reject("trailing data");
+	}
+	return DynrecCacheLoadResult::Loaded;
+}
+
+bool save_dynrec_cache(const std_fs::path& path, const uint64_t build_id,
+                       const int64_t translate_ns, const StoredBlocks& blocks)
+{
+	// Write to a unique temporary file first, as other instances might be
+	// saving the cache at the same time
+	auto temp_path = path;
+	temp_path += ".tmp" + std::to_string(std::random_device{}());
+
+	std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		LOG_WARNING("DYNREC: Can't write the persistent cache to '%s'",
+		            temp_path.string().c_str());
+		return false;
+	}
+
+	file.write(DynrecCacheMagic, sizeof(DynrecCacheMagic));
+	write_value(file, DynrecCacheVersion);
+	write_value(file, build_id);
+	write_value(file, translate_ns);
+	write_value(file, static_cast<uint32_t>(blocks.size()));
+
+	for (const auto& [key, stored] : blocks) {
+		write_value(file, static_cast<uint32_t>(key));
+		write_value(file, static_cast<uint32_t>(key >> 32));
+		write_value(file, stored.code_hash);
+		write_value(file, checksum_block(stored));
+		write_value(file, static_cast<uint16_t>(stored.guest_code.size()));
+		write_value(file, static_cast<uint16_t>(stored.host_code.size()));
+		write_value(file, static_cast<uint16_t>(stored.relocs.size()));
+		file.write(reinterpret_cast<const char*>(stored.guest_code.data()),
+		           static_cast<std::streamsize>(stored.guest_code.size()));
+		file.write(reinterpret_cast<const char*>(stored.host_code.data()),
+		           static_cast<std::streamsize>(stored.host_code.size()));
+		for (const auto& reloc : stored.relocs) {
+			write_value(file, reloc.offset);
+			write_value(file, reloc.form);
+			write_value(file, reloc.base);
+			write_value(file, reloc.tail);
+			write_value(file, reloc.addend);
+		}
+	}
+	file.close();
+
+	std::error_code ec = {};
+	if (!file) {
+		std_fs::remove(temp_path, ec);
+		LOG_WARNING("DYNREC: Failed writing the persistent cache");
+		return false;
+	}
+	std_fs::rename(temp_path, path, ec);
+	if (ec) {
+		std_fs::remove(temp_path, ec);
+		LOG_WARNING("DYNREC: Failed replacing the persistent cache");
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,100 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DOSBOX_DYNREC_CACHE_FILE_H
+#define DOSBOX_DYNREC_CACHE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "std_filesystem.h"
+
+// The file format of the dynrec core's persistent translation cache (see
+// core_dynrec/persistent_cache.h).
+//
+// Every stored block carries a checksum over its host code and relocations,
+// and the whole file is rejected and deleted if any block fails validation,
+// so a truncated or corrupted file never ends up as executed code.
+
+// How a host address is encoded in the translated code
+enum class RelocForm : uint8_t {
+	Abs64,  // 64-bit address
+	Abs32,  // 32-bit address, zero-extended
+	Disp32, // 32-bit address, sign-extended
+	Rel32,  // 32-bit displacement from the end of the instruction
+};
+
+// What a stored host address is relative to
+enum class RelocBase : uint8_t {
+	Image, // the emulator's executable image
+	Block, // the CacheBlock the code belongs to
+};
+
+struct StoredReloc {
+	uint16_t offset = 0;
+	RelocForm form  = RelocForm::Abs64;
+	RelocBase base  = RelocBase::Image;
+	// bytes from the start of a Rel32 field to the end of its instruction
+	uint8_t tail   = 0;
+	int64_t addend = 0;
+
+	bool operator==(const StoredReloc&) const = default;
+};
+
+struct StoredBlock {
+	uint64_t code_hash = 0;
+	uint16_t page_start = 0;
+	uint16_t page_end = 0;
+	std::vector<uint8_t> guest_code = {};
+	std::vector<uint8_t> host_code = {};
+	std::vector<StoredReloc> relocs = {};
+
+	bool operator==(const StoredBlock&) const = default;
+};
+
+// Blocks are keyed by the physical address of their first instruction in
+// the low 32 bits, and the CPU mode they were translated for in the high ones
+using StoredBlocks = std::unordered_multimap<uint64_t, StoredBlock>;
+
+enum class DynrecCacheLoadResult { Loaded, NoFile, OtherBuild, Corrupt };
+
+// 64-bit FNV-1a, optionally continuing from an earlier hash
+constexpr uint64_t FnvOffsetBasis = 0xcbf29ce484222325;
+uint64_t hash_bytes(const uint8_t* data, const size_t size,
+                    const uint64_t hash = FnvOffsetBasis);
+
+// Loads the blocks into 'blocks', which is left empty unless the file was
+// loaded. Files with more blocks or larger host code than the given limits
+// are considered corrupt, and a corrupt file is deleted.
+DynrecCacheLoadResult load_dynrec_cache(const std_fs::path& path,
+                                        const uint64_t build_id,
+                                        const size_t max_blocks,
+                                        const size_t max_code_size,
+                                        StoredBlocks& blocks,
+                                        int64_t& translate_ns);
+
+// Replaces the file atomically; returns false if it couldn't be written
+bool save_dynrec_cache(const std_fs::path& path, const uint64_t build_id,
+                       const int64_t translate_ns, const StoredBlocks& blocks);
+
+#endif // DOSBOX_DYNREC_CACHE_FILE_H
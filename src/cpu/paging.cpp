@@ -777,36 +777,64 @@ bool PAGING_ForcePageInit(Bitu lin_addr) {
 }
 
 #if defined(USE_FULL_TLB)
+// shared by all ranges of the TLB that have no linked pages
+static TlbLeaf unlinked_tlb_leaf;
+
+// get the second-level table of lin_page for modification
+static TlbLeaf* GetTLBLeafForLink(uint32_t lin_page)
+{
+	auto& leaf = paging.tlb.leaves[lin_page >> TLB_LEAF_SHIFT];
+	if (leaf == &unlinked_tlb_leaf) {
+		leaf = new TlbLeaf(unlinked_tlb_leaf);
+	}
+	return leaf;
+}
+
+static void UnlinkTLBEntry(Bitu lin_page)
+{
+	paging.tlb.read[lin_page]=nullptr;
+	paging.tlb.write[lin_page]=nullptr;
+	auto leaf = paging.tlb.leaves[lin_page >> TLB_LEAF_SHIFT];
+	if (leaf != &unlinked_tlb_leaf) {
+		leaf->readhandler[lin_page & TLB_LEAF_MASK]=&init_page_handler;
+		leaf->writehandler[lin_page & TLB_LEAF_MASK]=&init_page_handler;
+	}
+}
+
+// unlink everything and hand the tables allocated for linked ranges back,
+// so every range shares the unlinked table again
+static void FreeTLBLeaves()
+{
+	PAGING_ClearTLB();
+	for (auto& leaf : paging.tlb.leaves) {
+		if (leaf!=&unlinked_tlb_leaf) delete leaf;
+		leaf=&unlinked_tlb_leaf;
+	}
+}
+
 void PAGING_InitTLB()
 {
-	for (auto i=0;i<TLB_SIZE;i++) {
-		paging.tlb.read[i]=nullptr;
-		paging.tlb.write[i]=nullptr;
-		paging.tlb.readhandler[i]=&init_page_handler;
-		paging.tlb.writehandler[i]=&init_page_handler;
+	for (auto i=0;i<TLB_LEAF_SIZE;i++) {
+		unlinked_tlb_leaf.readhandler[i]=&init_page_handler;
+		unlinked_tlb_leaf.writehandler[i]=&init_page_handler;
 	}
-	paging.links.used=0;
+	// only linked pages differ from the initial state, so resetting them
+	// is enough and keeps the untouched parts of the TLB untouched
+	FreeTLBLeaves();
 }
 
 void PAGING_ClearTLB()
 {
 	uint32_t * entries=&paging.links.entries[0];
 	for (;paging.links.used>0;paging.links.used--) {
-		const auto page=*entries++;
-		paging.tlb.read[page]=nullptr;
-		paging.tlb.write[page]=nullptr;
-		paging.tlb.readhandler[page]=&init_page_handler;
-		paging.tlb.writehandler[page]=&init_page_handler;
+		UnlinkTLBEntry(*entries++);
 	}
 	paging.links.used=0;
 }
 
 void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	for (;pages>0;pages--) {
-		paging.tlb.read[lin_page]=nullptr;
-		paging.tlb.write[lin_page]=nullptr;
-		paging.tlb.readhandler[lin_page]=&init_page_handler;
-		paging.tlb.writehandler[lin_page]=&init_page_handler;
+		UnlinkTLBEntry(lin_page);
 		lin_page++;
 	}
 }
@@ -814,10 +842,7 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
-		paging.tlb.read[lin_page]=nullptr;
-		paging.tlb.write[lin_page]=nullptr;
-		paging.tlb.readhandler[lin_page]=&init_page_handler;
-		paging.tlb.writehandler[lin_page]=&init_page_handler;
+		UnlinkTLBEntry(lin_page);
 	} else {
 		PAGING_LinkPage(lin_page,phys_page);
 	}
@@ -835,15 +860,17 @@ void PAGING_LinkPage(uint32_t lin_page,uint32_t phys_page) {
 		assert(paging.links.used == 0);
 	}
 
-	paging.tlb.phys_page[lin_page]=phys_page;
+	const auto leaf=GetTLBLeafForLink(lin_page);
+	const auto index=lin_page & TLB_LEAF_MASK;
+	leaf->phys_page[index]=phys_page;
 	if (handler->flags & PFLAG_READABLE) paging.tlb.read[lin_page]=handler->GetHostReadPt(phys_page)-lin_base;
 	else paging.tlb.read[lin_page]=nullptr;
 	if (handler->flags & PFLAG_WRITEABLE) paging.tlb.write[lin_page]=handler->GetHostWritePt(phys_page)-lin_base;
 	else paging.tlb.write[lin_page]=nullptr;
 
 	paging.links.entries[paging.links.used++]=lin_page;
-	paging.tlb.readhandler[lin_page]=handler;
-	paging.tlb.writehandler[lin_page]=handler;
+	leaf->readhandler[index]=handler;
+	leaf->writehandler[index]=handler;
 }
 
 void PAGING_LinkPage_ReadOnly(uint32_t lin_page,uint32_t phys_page) {
@@ -858,14 +885,16 @@ void PAGING_LinkPage_ReadOnly(uint32_t lin_page,uint32_t phys_page) {
 		assert(paging.links.used == 0);
 	}
 
-	paging.tlb.phys_page[lin_page]=phys_page;
+	const auto leaf=GetTLBLeafForLink(lin_page);
+	const auto index=lin_page & TLB_LEAF_MASK;
+	leaf->phys_page[index]=phys_page;
 	if (handler->flags & PFLAG_READABLE) paging.tlb.read[lin_page]=handler->GetHostReadPt(phys_page)-lin_base;
 	else paging.tlb.read[lin_page]=nullptr;
 	paging.tlb.write[lin_page]=nullptr;
 
 	paging.links.entries[paging.links.used++]=lin_page;
-	paging.tlb.readhandler[lin_page]=handler;
-	paging.tlb.writehandler[lin_page]=&init_page_handler_userro;
+	leaf->readhandler[index]=handler;
+	leaf->writehandler[index]=&init_page_handler_userro;
 }
 
 #else
@@ -1024,6 +1053,12 @@ public:
 		}
 		pf_queue.used=0;
 	}
+
+#if defined(USE_FULL_TLB)
+	~PAGING() override {
+		FreeTLBLeaves();
+	}
+#endif
 };
 
 static std::unique_ptr<PAGING> paging_instance = nullptr;
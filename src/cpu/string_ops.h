@@ -20,6 +20,13 @@
 #ifndef DOSBOX_STRING_OPS_H
 #define DOSBOX_STRING_OPS_H
 
+#include "dosbox.h"
+
+#include <algorithm>
+
+#include "inout.h"
+#include "paging.h"
+
 // string instructions
 enum STRING_OP {
 	R_OUTSB = 0,
@@ -45,4 +52,72 @@ enum STRING_OP {
 	R_CMPSD,
 };
 
+// REP INS and REP OUTS fast path
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Moves as many units as possible between a port's block handler and guest
+// memory, a page at a time, for as long as the pages are directly backed by
+// host memory. Only ascending transfers (direction flag clear) are handled;
+// the caller moves any remaining units one at a time. Returns the number of
+// units moved and advances the index past them.
+
+template <io_width_t width, typename transfer_f>
+static inline uint32_t rep_io_block(const PhysPt base, uint32_t& index,
+                                    const uint32_t add_mask,
+                                    const uint32_t num_units,
+                                    transfer_f&& transfer)
+{
+	constexpr auto unit_bytes = static_cast<uint32_t>(width);
+
+	uint32_t moved = 0;
+	while (moved < num_units) {
+		const auto address = base + index;
+
+		// Stay within the page and don't wrap around the segment
+		const uint64_t page_bytes = dos_pagesize - (address & (dos_pagesize - 1));
+		const uint64_t wrap_bytes = uint64_t{add_mask} - index + 1;
+
+		const auto units = static_cast<uint32_t>(
+		        std::min({uint64_t{num_units - moved},
+		                  page_bytes / unit_bytes,
+		                  wrap_bytes / unit_bytes}));
+		if (units == 0) {
+			break;
+		}
+		const auto transferred = static_cast<uint32_t>(transfer(address, units));
+
+		moved += transferred;
+		index = (index + transferred * unit_bytes) & add_mask;
+		if (transferred < units) {
+			break;
+		}
+	}
+	return moved;
+}
+
+template <io_width_t width>
+static inline uint32_t rep_ins_block(const io_port_t port, const PhysPt base,
+                                     uint32_t& index, const uint32_t add_mask,
+                                     const uint32_t num_units)
+{
+	auto read_into_page = [=](const PhysPt address, const uint32_t units) -> size_t {
+		const auto host_page = get_tlb_write(address);
+		return host_page ? IO_ReadBlock(port, width, host_page + address, units)
+		                 : 0;
+	};
+	return rep_io_block<width>(base, index, add_mask, num_units, read_into_page);
+}
+
+template <io_width_t width>
+static inline uint32_t rep_outs_block(const io_port_t port, const PhysPt base,
+                                      uint32_t& index, const uint32_t add_mask,
+                                      const uint32_t num_units)
+{
+	auto write_from_page = [=](const PhysPt address, const uint32_t units) -> size_t {
+		const auto host_page = get_tlb_read(address);
+		return host_page ? IO_WriteBlock(port, width, host_page + address, units)
+		                 : 0;
+	};
+	return rep_io_block<width>(base, index, add_mask, num_units, write_from_page);
+}
+
 #endif
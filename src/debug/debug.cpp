@@ -22,6 +22,7 @@
 #if C_DEBUG
 
 #include <cctype>
+#include <cinttypes>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
@@ -67,6 +68,9 @@ static void LogLDT(void);
 static void LogIDT(void);
 static void LogPages(char* selname);
 static void LogCPUInfo(void);
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+static void LogDynamicCoreCache();
+#endif
 static void OutputVecTable(char* filename);
 static void DrawVariables(void);
 
@@ -1375,6 +1379,10 @@ bool ParseCommand(char* str) {
 
 	if (command == "CPU") {LogCPUInfo(); return true;}
 
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+	if (command == "DYNCACHE") {LogDynamicCoreCache(); return true;}
+#endif
+
 	if (command == "INTVEC") {
 		if (found[0] != 0) {
 			OutputVecTable(found);
@@ -1460,6 +1468,9 @@ bool ParseCommand(char* str) {
 		DEBUG_ShowMsg("INTHAND [intNum]          - Set code view to interrupt handler.\n");
 
 		DEBUG_ShowMsg("CPU                       - Display CPU status information.\n");
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+		DEBUG_ShowMsg("DYNCACHE                  - Display dynamic core code cache counters.\n");
+#endif
 		DEBUG_ShowMsg("GDT                       - Lists descriptors of the GDT.\n");
 		DEBUG_ShowMsg("LDT                       - Lists descriptors of the LDT.\n");
 		DEBUG_ShowMsg("IDT                       - Lists descriptors of the IDT.\n");
@@ -2220,6 +2231,28 @@ static void LogCPUInfo(void) {
 	}
 }
 
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+static void LogDynamicCoreCache()
+{
+	const auto stats = CPU_GetDynamicCoreCacheStats();
+
+	DEBUG_ShowMsg("Code cache size: %zu of %zu KB (grown %" PRIu64 " times)\n",
+	              stats.cache_size_bytes / 1024,
+	              stats.cache_max_size_bytes / 1024,
+	              stats.cache_growths);
+	DEBUG_ShowMsg("Blocks created: %" PRIu64 ", evicted: %" PRIu64
+	              ", spared from eviction: %" PRIu64 "\n",
+	              stats.blocks_created,
+	              stats.blocks_evicted,
+	              stats.blocks_spared);
+	DEBUG_ShowMsg("Blocks invalidated by self-modifying code: %" PRIu64 "\n",
+	              stats.smc_invalidations);
+	DEBUG_ShowMsg("Block links: %" PRIu64 ", unlinks: %" PRIu64 "\n",
+	              stats.links,
+	              stats.unlinks);
+}
+#endif
+
 #if C_HEAVY_DEBUG
 static void LogInstruction(uint16_t segValue, uint32_t eipValue, std::ofstream &out)
 {
@@ -413,7 +413,8 @@ static void DOSBOX_RealInit(Section* sec)
 	/* Initialize some dosbox internals */
 	ticksRemain = 0;
 	ticksLast   = GetTicks();
-	ticksLocked = false;
+	// headless batch jobs run in permanent fast forward mode
+	ticksLocked = control->arguments.headless;
 	DOSBOX_SetLoop(&Normal_Loop);
 
 	MAPPER_AddHandler(DOSBOX_UnlockSpeed, SDL_SCANCODE_F12, MMOD2, "speedlock", "Speedlock");
@@ -696,6 +697,24 @@ void DOSBOX_Init()
 	pstring->SetDeprecatedWithAlternateValue("486_prefetch", "486");
 	pstring->SetDeprecatedWithAlternateValue("pentium_slow", "pentium");
 
+#if (C_DYNAMIC_X86) || (C_DYNREC)
+	pint = secprop->Add_int("dynamic_core_memsize", only_at_start, 32);
+	pint->SetMinMax(8, 512);
+	pint->Set_help(
+	        "Maximum size of the dynamic core's code cache in MB (32 by default).\n"
+	        "The cache starts at 8 MB and grows up to this size when it fills up. Larger\n"
+	        "values can help big protected mode programs and Windows that otherwise spend\n"
+	        "a lot of time translating the same code again.");
+
+#endif
+#if (C_DYNREC)
+	pbool = secprop->Add_bool("dynamic_core_cache", only_at_start, false);
+	pbool->Set_help(
+	        "Keep the code translated by the dynamic core in a file in the config directory\n"
+	        "and reuse it in later sessions (disabled by default). This shortens the warm-up\n"
+	        "of programs that were run before. Only supported on x86-64 hosts.");
+
+#endif
 	pmulti_remain = secprop->AddMultiValRemain("cycles", always, " ");
 	pmulti_remain->Set_help(
 	        "Number of instructions DOSBox tries to emulate per millisecond\n"
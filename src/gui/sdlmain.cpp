@@ -22,14 +22,17 @@
 #include "dosbox.h"
 
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <cinttypes>
 #include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <sys/types.h>
+#include <thread>
 #include <tuple>
 #include <unistd.h>
 
@@ -55,6 +58,7 @@
 #include "cpu.h"
 #include "cross.h"
 #include "debug.h"
+#include "dos_inc.h"
 #include "fs_utils.h"
 #include "gui_msgs.h"
 #include "joystick.h"
@@ -68,11 +72,14 @@
 #include "rect.h"
 #include "render.h"
 #include "sdlmain.h"
+#include "semaphore_internal.h"
 #include "setup.h"
 #include "string_utils.h"
+#include "support.h"
 #include "timer.h"
 #include "titlebar.h"
 #include "tracy.h"
+#include "triple_buffer.h"
 #include "vga.h"
 #include "video.h"
 
@@ -112,6 +119,17 @@ typedef void (APIENTRYP PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
 typedef void (APIENTRYP PFNGLUSEPROGRAMPROC) (GLuint program);
 typedef void (APIENTRYP PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
 
+// Pixel buffer objects and fences for streaming texture uploads
+typedef void (APIENTRYP PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
+typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
+typedef void (APIENTRYP PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+typedef void (APIENTRYP PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void *(APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRYP PFNGLUNMAPBUFFERPROC) (GLenum target);
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+
 /* Apple defines these functions in their GL header (as core functions)
  * so we can't use their names as function pointers. We can't link
  * directly as some platforms may not have them. So they get their own
@@ -137,6 +155,16 @@ PFNGLUNIFORM2FPROC glUniform2f = nullptr;
 PFNGLUNIFORM1IPROC glUniform1i = nullptr;
 PFNGLUSEPROGRAMPROC glUseProgram = nullptr;
 PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer = nullptr;
+
+PFNGLGENBUFFERSPROC glGenBuffers = nullptr;
+PFNGLDELETEBUFFERSPROC glDeleteBuffers = nullptr;
+PFNGLBINDBUFFERPROC glBindBuffer = nullptr;
+PFNGLBUFFERDATAPROC glBufferData = nullptr;
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange = nullptr;
+PFNGLUNMAPBUFFERPROC glUnmapBuffer = nullptr;
+PFNGLFENCESYNCPROC glFenceSync = nullptr;
+PFNGLCLIENTWAITSYNCPROC glClientWaitSync = nullptr;
+PFNGLDELETESYNCPROC glDeleteSync = nullptr;
 }
 
 /* "using" is meant to hide identical names declared in outer scope
@@ -162,6 +190,16 @@ PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer = nullptr;
 #define glUseProgram              gl2::glUseProgram
 #define glVertexAttribPointer     gl2::glVertexAttribPointer
 
+#define glGenBuffers              gl2::glGenBuffers
+#define glDeleteBuffers           gl2::glDeleteBuffers
+#define glBindBuffer              gl2::glBindBuffer
+#define glBufferData              gl2::glBufferData
+#define glMapBufferRange          gl2::glMapBufferRange
+#define glUnmapBuffer             gl2::glUnmapBuffer
+#define glFenceSync               gl2::glFenceSync
+#define glClientWaitSync          gl2::glClientWaitSync
+#define glDeleteSync              gl2::glDeleteSync
+
 #endif // C_OPENGL
 
 #ifdef WIN32
@@ -208,11 +246,18 @@ static SDL_Rect to_sdl_rect(const DosBox::Rect& r)
 static void clean_up_sdl_resources();
 static void handle_video_resize(int width, int height);
 
-static void update_frame_texture([[maybe_unused]] const uint16_t* changedLines);
+static void update_frame_texture(const uint16_t* changedLines);
 static bool present_frame_texture();
 #if C_OPENGL
 static void update_frame_gl(const uint16_t *changedLines);
 static bool present_frame_gl();
+static void create_pbo(const size_t size_bytes);
+static void release_pbo();
+static uint8_t* map_next_pbo();
+static bool is_presentation_thread_running();
+static void maybe_start_presentation_thread();
+static void stop_presentation_thread();
+static void publish_frame_to_presentation_thread();
 static const char* safe_gl_get_string(const GLenum requested_name,
                                       const char* default_result);
 #endif
@@ -587,6 +632,9 @@ uint8_t GFX_GetBestMode(const uint8_t flags)
 // Useful during output initialization or transitions.
 void GFX_DisengageRendering()
 {
+#if C_OPENGL
+	stop_presentation_thread();
+#endif
 	sdl.frame.update  = update_frame_noop;
 	sdl.frame.present = present_frame_noop;
 }
@@ -961,6 +1009,9 @@ static void update_vsync_state()
 
 static void remove_window()
 {
+#if C_OPENGL
+	stop_presentation_thread();
+#endif
 	if (sdl.window) {
 		SDL_DestroyWindow(sdl.window);
 		sdl.window = nullptr;
@@ -1796,6 +1847,7 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
 #if C_OPENGL
 		free(sdl.opengl.framebuf);
 		sdl.opengl.framebuf = nullptr;
+		release_pbo();
 		if (!(flags & GFX_CAN_32)) {
 			goto fallback_texture;
 		}
@@ -1959,7 +2011,14 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
 		/* Create the texture and display list */
 		const auto framebuffer_bytes = static_cast<size_t>(render_width_px) *
 		                               render_height_px * MAX_BYTES_PER_PIXEL;
-		sdl.opengl.framebuf = malloc(framebuffer_bytes); // 32 bit colour
+		// Frames are rendered straight into the mapped pixel buffer
+		// object if it's used, so no intermediate buffer is needed
+		if (sdl.opengl.use_pbos && sdl.opengl.pbos_supported &&
+		    !sdl.opengl.use_presentation_thread) {
+			create_pbo(framebuffer_bytes);
+		} else {
+			sdl.opengl.framebuf = malloc(framebuffer_bytes); // 32 bit colour
+		}
 		sdl.opengl.pitch = render_width_px * 4;
 
 		// One-time initialize the window size
@@ -2163,6 +2222,10 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
     }
 #endif
 
+#if C_OPENGL
+	maybe_start_presentation_thread();
+#endif
+
 	if (retFlags) {
 		GFX_Start();
 	}
@@ -2176,6 +2239,8 @@ void GFX_SetShader([[maybe_unused]] const ShaderInfo& shader_info,
 	sdl.opengl.shader_info   = shader_info;
 	sdl.opengl.shader_source = shader_source;
 
+	stop_presentation_thread();
+
 	if (!sdl.opengl.use_shader) {
 		return;
 	}
@@ -2336,7 +2401,8 @@ bool GFX_StartUpdate(uint8_t * &pixels, int &pitch)
 		return true;
 	case RenderingBackend::OpenGl:
 #if C_OPENGL
-		pixels = static_cast<uint8_t*>(sdl.opengl.framebuf);
+		pixels = sdl.opengl.pbo.buffer ? map_next_pbo()
+		                               : static_cast<uint8_t*>(sdl.opengl.framebuf);
 		OPENGL_ERROR("end of start update");
 		if (pixels == nullptr) {
 			return false;
@@ -2358,6 +2424,34 @@ extern int64_t ticksDone;
 
 void GFX_EndUpdate(const uint16_t* changedLines)
 {
+	// Nobody is watching in headless mode, only present the frames that
+	// have to be captured after rendering. The texture is still kept up to
+	// date, as only the changed lines get uploaded.
+	if (control->arguments.headless && !CAPTURE_IsCapturingPostRenderImage()) {
+		sdl.frame.update(changedLines);
+		sdl.updating = false;
+		return;
+	}
+
+#if C_OPENGL
+	const auto restart_presentation_thread = is_presentation_thread_running();
+	const uint16_t all_lines[] = {0, check_cast<uint16_t>(sdl.draw.render_height_px)};
+	if (restart_presentation_thread) {
+		if (!CAPTURE_IsCapturingPostRenderImage()) {
+			if (sdl.updating) {
+				publish_frame_to_presentation_thread();
+			}
+			sdl.updating = false;
+			FrameMark;
+			return;
+		}
+		// Rendered captures read the frame back on this thread; upload
+		// all of it as the texture might lag behind the changed lines
+		stop_presentation_thread();
+		changedLines = all_lines;
+	}
+#endif
+
 	static int64_t cumulative_time_rendered = 0;
 	const auto start                        = GetTicksUs();
 
@@ -2411,16 +2505,51 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 
 	sdl.updating = false;
 	FrameMark;
+
+#if C_OPENGL
+	if (restart_presentation_thread) {
+		maybe_start_presentation_thread();
+	}
+#endif
 }
 
 // Texture update and presentation
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-static void update_frame_texture([[maybe_unused]] const uint16_t *changedLines)
+static void update_frame_texture(const uint16_t* changedLines)
 {
-	SDL_UpdateTexture(sdl.texture.texture,
-	                  nullptr, // update entire texture
-	                  sdl.texture.input_surface->pixels,
-	                  sdl.texture.input_surface->pitch);
+	const auto surface = sdl.texture.input_surface;
+
+	if (!changedLines) {
+		// Nothing was rendered since the last update
+		if (!sdl.updating) {
+			return;
+		}
+		SDL_UpdateTexture(sdl.texture.texture,
+		                  nullptr, // update entire texture
+		                  surface->pixels,
+		                  surface->pitch);
+		return;
+	}
+
+	// Only upload the changed line spans; the list alternates between
+	// the number of unchanged and changed lines
+	const auto pixels = static_cast<const uint8_t*>(surface->pixels);
+	int y        = 0;
+	size_t index = 0;
+	while (y < sdl.draw.render_height_px) {
+		if (!(index & 1)) {
+			y += changedLines[index];
+		} else {
+			const int height_px = changedLines[index];
+			const SDL_Rect span = {0, y, sdl.draw.render_width_px, height_px};
+			SDL_UpdateTexture(sdl.texture.texture,
+			                  &span,
+			                  pixels + y * surface->pitch,
+			                  surface->pitch);
+			y += height_px;
+		}
+		index++;
+	}
 }
 
 static std::optional<RenderedImage> get_rendered_output_from_backbuffer()
@@ -2570,10 +2699,102 @@ static bool present_frame_texture()
 // OpenGL frame-based update and presentation
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #if C_OPENGL
+// Pixel buffer object streaming
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Frames are rendered straight into a mapped pixel buffer object, from which
+// the changed lines are uploaded asynchronously by the driver. A fence is
+// placed after the uploads, which is waited on before the buffer is mapped
+// for rendering the next frame. Usually the GPU is done by then, so the
+// emulation rarely stalls on the uploads.
+//
+// A single buffer is used, and its contents are kept between frames. The
+// scalers skip the unchanged pixels within a changed line, but the whole line
+// is uploaded, so the skipped pixels must still hold the previous frame's,
+// just like in the client-memory framebuffer.
+
+// How long to wait for the GPU to finish reading the buffer before giving up
+// and mapping it anyway
+constexpr GLuint64 PboFenceTimeoutNs = 100'000'000;
+
+static void create_pbo(const size_t size_bytes)
+{
+	auto& pbo = sdl.opengl.pbo;
+
+	glGenBuffers(1, &pbo.buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER,
+	             check_cast<GLsizeiptr>(size_bytes),
+	             nullptr,
+	             GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	pbo.size_bytes = size_bytes;
+	OPENGL_ERROR("create pixel buffer object");
+}
+
+static void release_pbo()
+{
+	auto& pbo = sdl.opengl.pbo;
+	if (!pbo.buffer) {
+		return;
+	}
+	if (pbo.is_mapped) {
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		pbo.is_mapped = false;
+	}
+	if (pbo.fence) {
+		glDeleteSync(pbo.fence);
+		pbo.fence = nullptr;
+	}
+	glDeleteBuffers(1, &pbo.buffer);
+	pbo.buffer = 0;
+}
+
+static uint8_t* map_next_pbo()
+{
+	auto& pbo = sdl.opengl.pbo;
+	assert(!pbo.is_mapped);
+
+	// This only blocks if the GPU is still reading the previous frame's
+	// lines, which would otherwise be overwritten
+	if (pbo.fence) {
+		glClientWaitSync(pbo.fence, GL_SYNC_FLUSH_COMMANDS_BIT, PboFenceTimeoutNs);
+		glDeleteSync(pbo.fence);
+		pbo.fence = nullptr;
+	}
+
+	// The buffer isn't invalidated, as the unchanged pixels are reused
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.buffer);
+	const auto pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+	                                     0,
+	                                     check_cast<GLsizeiptr>(pbo.size_bytes),
+	                                     GL_MAP_WRITE_BIT |
+	                                             GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!pixels) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return nullptr;
+	}
+	pbo.is_mapped = true;
+	return static_cast<uint8_t*>(pixels);
+}
+
 static void update_frame_gl(const uint16_t* changedLines)
 {
+	// With pixel buffer objects, the lines are uploaded from the bound
+	// buffer, so the pixel pointers become offsets into it
+	auto& pbo = sdl.opengl.pbo;
+
+	const auto is_streaming = pbo.is_mapped;
+	if (is_streaming) {
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		pbo.is_mapped = false;
+	}
+	const auto framebuf = is_streaming
+	                            ? uintptr_t{0}
+	                            : reinterpret_cast<uintptr_t>(sdl.opengl.framebuf);
+
 	if (changedLines) {
-		const auto framebuf = static_cast<uint8_t *>(sdl.opengl.framebuf);
 		const auto pitch = sdl.opengl.pitch;
 		int y = 0;
 		size_t index = 0;
@@ -2581,7 +2802,8 @@ static void update_frame_gl(const uint16_t* changedLines)
 			if (!(index & 1)) {
 				y += changedLines[index];
 			} else {
-				const uint8_t *pixels = framebuf + y * pitch;
+				const auto pixels = reinterpret_cast<const void*>(
+				        framebuf + static_cast<uintptr_t>(y * pitch));
 				const int height_px = changedLines[index];
 				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y,
 				                sdl.draw.render_width_px, height_px, GL_BGRA_EXT,
@@ -2593,20 +2815,30 @@ static void update_frame_gl(const uint16_t* changedLines)
 	} else {
 		sdl.opengl.actual_frame_count++;
 	}
+
+	if (is_streaming) {
+		pbo.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
+static void draw_frame_gl()
+{
+	glClear(GL_COLOR_BUFFER_BIT);
+	if (sdl.opengl.program_object) {
+		glUniform1i(sdl.opengl.ruby.frame_count,
+		            sdl.opengl.actual_frame_count++);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	} else {
+		glCallList(sdl.opengl.displaylist);
+	}
 }
 
 static bool present_frame_gl()
 {
 	const auto is_presenting = render_pacer->CanRun();
 	if (is_presenting) {
-		glClear(GL_COLOR_BUFFER_BIT);
-		if (sdl.opengl.program_object) {
-			glUniform1i(sdl.opengl.ruby.frame_count,
-			            sdl.opengl.actual_frame_count++);
-			glDrawArrays(GL_TRIANGLES, 0, 3);
-		} else {
-			glCallList(sdl.opengl.displaylist);
-		}
+		draw_frame_gl();
 
 		if (CAPTURE_IsCapturingPostRenderImage()) {
 			// glReadPixels() implicitly blocks until all pipelined rendering
@@ -2624,6 +2856,163 @@ static bool present_frame_gl()
 	render_pacer->Checkpoint();
 	return is_presenting;
 }
+
+// Threaded OpenGL presentation
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The emulation thread copies each changed frame into a triple buffer and
+// carries on, while the presentation thread uploads and presents the newest
+// one. This way only the presentation thread waits on the video driver and
+// vsync. The GL context is owned by the presentation thread while it runs, so
+// it's stopped before the output is reconfigured and then started again.
+
+// Power-of-two buckets in microseconds, from below 512 us up to above 65 ms
+class PresentationHistogram {
+public:
+	void Add(const int64_t us)
+	{
+		size_t bucket = 0;
+		while (bucket < NumBuckets - 1 && us >= (MinBucketUs << bucket)) {
+			++bucket;
+		}
+		++counts[bucket];
+	}
+
+	void Log(const char* name) const
+	{
+		std::string buckets = {};
+		for (size_t bucket = 0; bucket < NumBuckets - 1; ++bucket) {
+			buckets += format_str(" <%" PRId64 ":%u",
+			                      MinBucketUs << bucket,
+			                      counts[bucket]);
+		}
+		// The last bucket has no upper bound
+		buckets += format_str(" more:%u", counts.back());
+		LOG_MSG("SDL: %s histogram (us:count):%s", name, buckets.c_str());
+	}
+
+private:
+	static constexpr size_t NumBuckets  = 9;
+	static constexpr int64_t MinBucketUs = 512;
+
+	std::array<uint32_t, NumBuckets> counts = {};
+};
+
+struct PresentedFrame {
+	std::vector<uint8_t> pixels = {};
+	int width_px                = 0;
+	int height_px               = 0;
+	int64_t published_us        = 0;
+};
+
+static struct {
+	std::thread thread                  = {};
+	std::atomic<bool> should_stop       = false;
+	Semaphore has_frame                 = {};
+	TripleBuffer<PresentedFrame> frames = {};
+
+	// Time between presented frames, and from the emulation thread's
+	// hand-off to the presented frame, only updated by the thread
+	PresentationHistogram frame_time      = {};
+	PresentationHistogram present_latency = {};
+} presenter = {};
+
+static void present_frames_threaded()
+{
+	if (SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context) < 0) {
+		LOG_ERR("OPENGL: Can't make context current in the presentation thread: %s",
+		        SDL_GetError());
+		return;
+	}
+
+	const auto width_px  = sdl.draw.render_width_px;
+	const auto height_px = sdl.draw.render_height_px;
+
+	int64_t last_present_us = 0;
+	while (true) {
+		presenter.has_frame.wait();
+		if (presenter.should_stop) {
+			break;
+		}
+		if (!presenter.frames.Update()) {
+			continue;
+		}
+		const auto& frame = presenter.frames.GetReadBuffer();
+
+		// Skip frames left over from before the last reconfiguration
+		if (frame.width_px != width_px || frame.height_px != height_px) {
+			continue;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_px, height_px,
+		                GL_BGRA_EXT, GL_UNSIGNED_INT_8_8_8_8_REV,
+		                frame.pixels.data());
+		draw_frame_gl();
+		SDL_GL_SwapWindow(sdl.window);
+
+		const auto now_us = GetTicksUs();
+		presenter.present_latency.Add(now_us - frame.published_us);
+		if (last_present_us) {
+			presenter.frame_time.Add(now_us - last_present_us);
+		}
+		last_present_us = now_us;
+	}
+	SDL_GL_MakeCurrent(sdl.window, nullptr);
+}
+
+static bool is_presentation_thread_running()
+{
+	return presenter.thread.joinable();
+}
+
+static void maybe_start_presentation_thread()
+{
+	if (!sdl.opengl.use_presentation_thread || is_presentation_thread_running() ||
+	    sdl.rendering_backend != RenderingBackend::OpenGl ||
+	    !sdl.opengl.framebuf) {
+		return;
+	}
+	SDL_GL_MakeCurrent(sdl.window, nullptr);
+	presenter.thread = std::thread(present_frames_threaded);
+	set_thread_name(presenter.thread, "dosbox:present");
+}
+
+static void stop_presentation_thread()
+{
+	if (!is_presentation_thread_running()) {
+		return;
+	}
+	presenter.should_stop = true;
+	presenter.has_frame.notify();
+	presenter.thread.join();
+	presenter.should_stop = false;
+
+	// Reclaim the context for reconfiguring the output
+	SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+}
+
+static void publish_frame_to_presentation_thread()
+{
+	auto& frame = presenter.frames.GetWriteBuffer();
+
+	const auto frame_bytes = static_cast<size_t>(sdl.draw.render_height_px) *
+	                         sdl.opengl.pitch;
+	const auto framebuf = static_cast<const uint8_t*>(sdl.opengl.framebuf);
+	frame.pixels.assign(framebuf, framebuf + frame_bytes);
+	frame.width_px     = sdl.draw.render_width_px;
+	frame.height_px    = sdl.draw.render_height_px;
+	frame.published_us = GetTicksUs();
+
+	presenter.frames.Publish();
+	presenter.has_frame.notify();
+}
+
+static void log_presentation_thread_stats()
+{
+	if (!sdl.opengl.use_presentation_thread) {
+		return;
+	}
+	presenter.frame_time.Log("Frame time");
+	presenter.present_latency.Log("Present latency");
+}
 #endif
 
 uint32_t GFX_GetRGB(const uint8_t red, const uint8_t green, const uint8_t blue)
@@ -2705,6 +3094,10 @@ static void GUI_ShutDown(Section *)
 		sdl.renderer = nullptr;
 	}
 #if C_OPENGL
+	stop_presentation_thread();
+	log_presentation_thread_stats();
+	release_pbo();
+
 	if (sdl.opengl.context) {
 		SDL_GL_DeleteContext(sdl.opengl.context);
 		sdl.opengl.context = nullptr;
@@ -3139,6 +3532,11 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 #if C_OPENGL
 	} else if (output == "opengl") {
 		sdl.want_rendering_backend = RenderingBackend::OpenGl;
+		sdl.opengl.use_pbos        = false;
+
+	} else if (output == "openglpbo") {
+		sdl.want_rendering_backend = RenderingBackend::OpenGl;
+		sdl.opengl.use_pbos        = true;
 #endif
 
 	} else {
@@ -3238,6 +3636,25 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 			         glUniform2f && glUniform1i && glUseProgram &&
 			         glVertexAttribPointer);
 
+			glGenBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress(
+			        "glGenBuffers");
+			glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress(
+			        "glDeleteBuffers");
+			glBindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress(
+			        "glBindBuffer");
+			glBufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress(
+			        "glBufferData");
+			glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)SDL_GL_GetProcAddress(
+			        "glMapBufferRange");
+			glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress(
+			        "glUnmapBuffer");
+			glFenceSync = (PFNGLFENCESYNCPROC)SDL_GL_GetProcAddress(
+			        "glFenceSync");
+			glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)SDL_GL_GetProcAddress(
+			        "glClientWaitSync");
+			glDeleteSync = (PFNGLDELETESYNCPROC)SDL_GL_GetProcAddress(
+			        "glDeleteSync");
+
 			sdl.opengl.framebuf = nullptr;
 			sdl.opengl.texture = 0;
 			sdl.opengl.displaylist = 0;
@@ -3252,6 +3669,31 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 			        SDL_GL_ExtensionSupported(
 			                "GL_ARB_texture_non_power_of_two");
 
+			// Buffer mapping and fences are core since OpenGL 3.2
+			const int gl_version_minor = gl_version_string[2] - '0';
+			const auto has_gl_3_2 = gl_version_major > 3 ||
+			                        (gl_version_major == 3 &&
+			                         gl_version_minor >= 2);
+
+			sdl.opengl.pbos_supported =
+			        glGenBuffers && glDeleteBuffers && glBindBuffer &&
+			        glBufferData && glMapBufferRange && glUnmapBuffer &&
+			        glFenceSync && glClientWaitSync && glDeleteSync &&
+			        (has_gl_3_2 ||
+			         (SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object") &&
+			          SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range") &&
+			          SDL_GL_ExtensionSupported("GL_ARB_sync")));
+
+			if (sdl.opengl.use_pbos) {
+				if (!sdl.opengl.pbos_supported) {
+					LOG_WARNING("OPENGL: Pixel buffer objects are not supported, "
+					            "using 'opengl' output mode");
+				} else if (sdl.opengl.use_presentation_thread) {
+					LOG_WARNING("OPENGL: Pixel buffer objects can't be used "
+					            "with 'presentation_thread' enabled");
+				}
+			}
+
 			std::string npot_support_msg = sdl.opengl.npot_textures_supported
 			                                     ? "supported"
 			                                     : "not supported";
@@ -3416,6 +3858,10 @@ static void read_gui_config(Section* sec)
 	                                       sdl.vsync.skip_us,
 	                                       Pacer::LogLevel::TIMEOUTS);
 
+#if C_OPENGL
+	sdl.opengl.use_presentation_thread = section->Get_bool("presentation_thread");
+#endif
+
 	const int display = section->Get_int("display");
 	if ((display >= 0) && (display < SDL_GetNumVideoDisplays())) {
 		sdl.display_number = display;
@@ -3558,6 +4004,31 @@ void GFX_RegenerateWindow(Section *sec) {
 #define DB_POLLSKIP 1
 #endif
 
+#if C_OPENGL
+// The presentation thread owns the OpenGL context while it runs, so it's
+// stopped while the viewport is changed on the emulation thread
+static void update_gl_viewport(const bool update_output_size)
+{
+	const auto restart_presentation_thread = is_presentation_thread_running();
+	stop_presentation_thread();
+
+	glViewport(sdl.draw_rect_px.x,
+	           sdl.draw_rect_px.y,
+	           sdl.draw_rect_px.w,
+	           sdl.draw_rect_px.h);
+
+	if (update_output_size) {
+		glUniform2f(sdl.opengl.ruby.output_size,
+		            (GLfloat)sdl.draw_rect_px.w,
+		            (GLfloat)sdl.draw_rect_px.h);
+	}
+
+	if (restart_presentation_thread) {
+		maybe_start_presentation_thread();
+	}
+}
+#endif
+
 static void handle_video_resize(int width, int height)
 {
 	/* Maybe a screen rotation has just occurred, so we simply resize.
@@ -3579,14 +4050,7 @@ static void handle_video_resize(int width, int height)
 	}
 #if C_OPENGL
 	if (sdl.rendering_backend == RenderingBackend::OpenGl) {
-		glViewport(sdl.draw_rect_px.x,
-		           sdl.draw_rect_px.y,
-		           sdl.draw_rect_px.w,
-		           sdl.draw_rect_px.h);
-
-		glUniform2f(sdl.opengl.ruby.output_size,
-		            (GLfloat)sdl.draw_rect_px.w,
-		            (GLfloat)sdl.draw_rect_px.h);
+		update_gl_viewport(true);
 	}
 #endif // C_OPENGL
 
@@ -3751,10 +4215,7 @@ bool GFX_Events()
 				// LOG_DEBUG("SDL: Reset macOS's GL viewport
 				// after window-restore");
 				if (sdl.rendering_backend == RenderingBackend::OpenGl) {
-					glViewport(sdl.draw_rect_px.x,
-					           sdl.draw_rect_px.y,
-					           sdl.draw_rect_px.w,
-					           sdl.draw_rect_px.h);
+					update_gl_viewport(false);
 				}
 #endif
 				focus_input();
@@ -3858,10 +4319,7 @@ bool GFX_Events()
 				//               event.window.data1,
 				//               event.window.data2);
 				if (sdl.rendering_backend == RenderingBackend::OpenGl) {
-					glViewport(sdl.draw_rect_px.x,
-					           sdl.draw_rect_px.y,
-					           sdl.draw_rect_px.w,
-					           sdl.draw_rect_px.h);
+					update_gl_viewport(false);
 				}
 				continue;
 #endif
@@ -3894,10 +4352,7 @@ bool GFX_Events()
 				}
 #	if C_OPENGL
 				if (sdl.rendering_backend == RenderingBackend::OpenGl) {
-					glViewport(sdl.draw_rect_px.x,
-					           sdl.draw_rect_px.y,
-					           sdl.draw_rect_px.w,
-					           sdl.draw_rect_px.h);
+					update_gl_viewport(false);
 				}
 
 				maybe_auto_switch_shader();
@@ -4161,6 +4616,10 @@ static void messages_add_command_line()
 	        "\n"
 	        "  --exit                   Exit after running '-c <command>'s and [autoexec] sections.\n"
 	        "\n"
+	        "  --headless               Run without a visible window and sound output, as fast\n"
+	        "                           as the host allows (for batch jobs). Implies --exit,\n"
+	        "                           and exits with the return code of the last DOS program.\n"
+	        "\n"
 	        "  --startmapper            Run the mapper GUI.\n"
 	        "\n"
 	        "  --erasemapper            Delete the default mapper file.\n"
@@ -4293,6 +4752,16 @@ static void config_add_sdl()
 	        "  vfr:   Always present changed DOS frames at a variable frame rate.");
 	pstring->Set_values({"auto", "cfr", "vfr"});
 
+	pbool = sdl_sec->Add_bool("presentation_thread", on_start, false);
+	pbool->Set_help(
+	        "Present frames from a dedicated thread, so emulation never waits for the\n"
+	        "video driver or vsync (disabled by default). Frames are handed over as they\n"
+	        "are rendered and presented as fast as the display takes them; the\n"
+	        "'presentation_mode' and 'vsync_skip' settings don't apply. Frame time and\n"
+	        "present latency histograms are logged on exit to help tuning the 'host_rate'\n"
+	        "and 'vsync' settings.\n"
+	        "Note: only valid in OpenGL output mode.");
+
 #if C_OPENGL
 	const std::string default_output = "opengl";
 #else
@@ -4311,6 +4780,10 @@ static void config_add_sdl()
 
 	pstring->SetOptionHelp("opengl",
 	                       "  opengl:     OpenGL backend with shader support (default).");
+	pstring->SetOptionHelp("openglpbo",
+	                       "  openglpbo:  OpenGL backend that streams frames to the GPU through pixel\n"
+	                       "              buffer objects; can lower the emulation overhead at high\n"
+	                       "              resolutions (requires OpenGL 3.2 or equivalent extensions).");
 	pstring->SetOptionHelp("texture",
 	                       "  texture:    SDL's texture backend with bilinear interpolation.");
 	pstring->SetOptionHelp("texturenb",
@@ -4331,7 +4804,7 @@ static void config_add_sdl()
 		"texture_default",
 #endif
 #if C_OPENGL
-		        "opengl",
+		        "opengl", "openglpbo",
 #endif
 		        "texture", "texturenb",
 	});
@@ -4790,8 +5263,17 @@ int sdl_main(int argc, char* argv[])
 			return err;
 		}
 
+		// In headless mode, the window goes to SDL's offscreen video
+		// driver and no audio device is opened at all
+		if (arguments->headless) {
+			SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+			arguments->set.insert(arguments->set.begin(),
+			                      {"output=texture", "nosound=true"});
+		}
+		const auto audio_flag = arguments->headless ? 0 : SDL_INIT_AUDIO;
+
 		// Timer is needed for title bar animations
-		if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
+		if (SDL_Init(audio_flag | SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
 			E_Exit("SDL: Can't init SDL %s", SDL_GetError());
 		}
 		sdl.start_event_id = SDL_RegisterEvents(enum_val(SDL_DosBoxEvents::NumEvents));
@@ -4907,6 +5389,11 @@ int sdl_main(int argc, char* argv[])
 		// Run the machine until shutdown
 		control->StartUp();
 
+		// Batch jobs need to know if the DOS program succeeded
+		if (arguments->headless) {
+			return_code = dos.return_code;
+		}
+
 		// Shutdown and release
 		control.reset();
 
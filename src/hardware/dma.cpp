@@ -53,8 +53,28 @@ static void UpdateEMSMapping()
 	}
 }
 
+// Translates a guest page number into the page that backs it in host memory,
+// following the EMS page frame mapping when it applies.
+static uint32_t resolve_dma_page(const uint32_t page)
+{
+	if (page < EMM_PAGEFRAME4K) {
+		return paging.firstmb[page];
+	} else if (page < EMM_PAGEFRAME4K + 0x10) {
+		return ems_board_mapping[page];
+	} else if (page < LINK_START) {
+		return paging.firstmb[page];
+	}
+	return page;
+}
+
 // Generic function to read or write a block of data to or from memory.
 // Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
+//
+// The block is split into spans of guest pages that are contiguous in host
+// memory, each of which is copied in one go. Addresses wrap within the
+// channel's 64 KB (8-bit) or 128 KB (16-bit) block unless wrapping has been
+// disabled, and any part of a span beyond the end of RAM reads as 0xff and
+// ignores writes.
 static void perform_dma_io(const DMA_DIRECTION direction, const PhysPt spage,
                            PhysPt mem_address, void* const data_start,
                            const size_t num_words, const uint8_t is_dma16)
@@ -63,53 +83,64 @@ static void perform_dma_io(const DMA_DIRECTION direction, const PhysPt spage,
 
 	const auto highpart_addr_page = spage >> 12;
 
-	// Maybe move the mem_address into the 16-bit range
+	// Maybe move the mem_address and wrap mask into the 16-bit range
 	mem_address <<= is_dma16;
+	const uint32_t wrap_mask = (dma_wrapping << is_dma16) | is_dma16;
 
-	// The data pointer will be incremented per transfer
-	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
+	const auto mem_base  = GetMemBase();
+	const auto mem_bytes = MEM_TotalPages() * dos_pagesize;
 
-	// Convert from DMA 'words' to actual bytes, no greater than 64 KB
-	auto remaining_bytes = check_cast<uint16_t>(num_words << is_dma16);
-	do {
-		// Find the right EMS page that contains the current address
-		auto page = highpart_addr_page + (mem_address >> 12);
-		if (page < EMM_PAGEFRAME4K) {
-			page = paging.firstmb[page];
-		} else if (page < EMM_PAGEFRAME4K + 0x10) {
-			page = ems_board_mapping[page];
-		} else if (page < LINK_START) {
-			page = paging.firstmb[page];
-		}
+	// The data pointer will be incremented per span
+	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
 
-		// Calculate the offset within the page
-		const auto pos_in_page       = mem_address & (dos_pagesize - 1);
-		const auto bytes_to_page_end = check_cast<uint16_t>(
-		        dos_pagesize - pos_in_page);
-		const auto chunk_start = check_cast<PhysPt>(page * dos_pagesize +
-		                                            pos_in_page);
+	// Convert from DMA 'words' to actual bytes, no greater than 128 KB
+	auto remaining_bytes = check_cast<uint32_t>(num_words << is_dma16);
+	while (remaining_bytes) {
+		mem_address &= wrap_mask;
 
-		// Determine how many bytes to transfer within this page
-		const auto chunk_bytes = std::min(remaining_bytes, bytes_to_page_end);
+		// Find the host page that contains the current address
+		auto page = resolve_dma_page(highpart_addr_page + (mem_address >> 12));
 
-		// Copy the data from the page address into the data pointer
-		if (direction == DMA_DIRECTION::READ) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				data_pt[i] = phys_readb(chunk_start + i);
+		// Calculate the offset within the page
+		const auto pos_in_page = mem_address & (dos_pagesize - 1);
+		const auto span_start  = page * dos_pagesize + pos_in_page;
+
+		// Grow the span across following pages for as long as they're
+		// contiguous in host memory. The wrap boundary is page aligned,
+		// so a span never crosses it.
+		auto span_bytes = std::min<uint32_t>(remaining_bytes,
+		                                     dos_pagesize - pos_in_page);
+		while (span_bytes < remaining_bytes) {
+			const auto next_address = (mem_address + span_bytes) & wrap_mask;
+			if (next_address == 0) {
+				break;
+			}
+			const auto next_page = resolve_dma_page(
+			        highpart_addr_page + (next_address >> 12));
+			if (next_page != page + 1) {
+				break;
 			}
+			page = next_page;
+			span_bytes += std::min<uint32_t>(remaining_bytes - span_bytes,
+			                                 dos_pagesize);
 		}
 
-		// Copy the data from the data pointer into the page address
-		else if (direction == DMA_DIRECTION::WRITE) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				phys_writeb(chunk_start + i, data_pt[i]);
-			}
+		// Only the part of the span that's backed by RAM is copied
+		const uint32_t ram_bytes = span_start < mem_bytes
+		                                 ? std::min(span_bytes, mem_bytes - span_start)
+		                                 : 0;
+
+		if (direction == DMA_DIRECTION::READ) {
+			std::memcpy(data_pt, mem_base + span_start, ram_bytes);
+			std::fill_n(data_pt + ram_bytes, span_bytes - ram_bytes, 0xff);
+		} else if (direction == DMA_DIRECTION::WRITE) {
+			std::memcpy(mem_base + span_start, data_pt, ram_bytes);
 		}
 
-		mem_address += chunk_bytes;
-		data_pt += chunk_bytes;
-		remaining_bytes -= chunk_bytes;
-	} while (remaining_bytes);
+		mem_address += span_bytes;
+		data_pt += span_bytes;
+		remaining_bytes -= span_bytes;
+	}
 }
 
 void TANDYSOUND_ShutDown(Section* = nullptr);
@@ -468,6 +499,15 @@ again:
 			DoCallback(DMA_MASKED);
 		}
 	}
+
+	const auto done_bytes = static_cast<uint64_t>(done) << is_16bit;
+	if (direction == DMA_DIRECTION::READ) {
+		stats.bytes_read += done_bytes;
+	} else {
+		stats.bytes_written += done_bytes;
+	}
+	++stats.num_transfers;
+
 	return done;
 }
 
@@ -476,10 +516,26 @@ bool DmaChannel::HasReservation() const
 	return (reservation_callback && !reservation_owner.empty());
 }
 
+void DmaChannel::LogStatistics() const
+{
+	if (!stats.num_transfers) {
+		return;
+	}
+	LOG_MSG("DMA: %s moved %llu KB to and %llu KB from memory in %llu transfers on %d-bit DMA channel %u",
+	        reservation_owner.c_str(),
+	        static_cast<unsigned long long>(stats.bytes_written / 1024),
+	        static_cast<unsigned long long>(stats.bytes_read / 1024),
+	        static_cast<unsigned long long>(stats.num_transfers),
+	        is_16bit == 1 ? 16 : 8,
+	        chan_num);
+}
+
 void DmaChannel::EvictReserver()
 {
 	assert(HasReservation());
 
+	LogStatistics();
+
 	reservation_callback(nullptr);
 
 	reservation_callback = {};
@@ -526,6 +582,8 @@ void DmaChannel::Reset()
 	callback             = {};
 	reservation_callback = {};
 	reservation_owner    = {};
+
+	stats = {};
 }
 
 DmaChannel::~DmaChannel()
@@ -35,6 +35,10 @@ static void ide_altio_w(io_port_t port, io_val_t val, io_width_t width);
 static uint32_t ide_altio_r(io_port_t port, io_width_t width);
 static void ide_baseio_w(io_port_t port, io_val_t val, io_width_t width);
 static uint32_t ide_baseio_r(io_port_t port, io_width_t width);
+static size_t ide_baseio_block_w(io_port_t port, io_width_t width,
+                                 const uint8_t *buffer, size_t num_units);
+static size_t ide_baseio_block_r(io_port_t port, io_width_t width,
+                                 uint8_t *buffer, size_t num_units);
 bool GetMSCDEXDrive(uint8_t drive_letter, CDROM_Interface **_cdrom);
 
 enum IDEDeviceType { IDE_TYPE_NONE, IDE_TYPE_HDD = 1, IDE_TYPE_CDROM };
@@ -150,6 +154,9 @@ public:
 	virtual void writecommand(uint8_t cmd);
 	virtual uint32_t data_read(io_width_t width);          /* read from 1F0h data port from IDE device */
 	virtual void data_write(uint32_t v, io_width_t width); /* write to 1F0h data port to IDE device */
+	/* REP INSW/OUTSW on the data port, returns the number of units moved */
+	virtual size_t data_read_block(io_width_t width, uint8_t *buffer, size_t num_units);
+	virtual size_t data_write_block(io_width_t width, const uint8_t *buffer, size_t num_units);
 	virtual bool command_interruption_ok(uint8_t cmd);
 	virtual void abort_silent();
 };
@@ -176,6 +183,8 @@ public:
 	uint32_t data_read(io_width_t width) override;
 	/* write to 1F0h data port to IDE device */
 	void data_write(uint32_t v, io_width_t width) override;
+	size_t data_read_block(io_width_t width, uint8_t *buffer, size_t num_units) override;
+	size_t data_write_block(io_width_t width, const uint8_t *buffer, size_t num_units) override;
 	virtual void generate_identify_device();
 	virtual void prepare_read(uint32_t offset, uint32_t size);
 	virtual void prepare_write(uint32_t offset, uint32_t size);
@@ -234,6 +243,8 @@ public:
 	uint32_t data_read(io_width_t width) override;
 	/* write to 1F0h data port to IDE device */
 	void data_write(uint32_t v, io_width_t width) override;
+	size_t data_read_block(io_width_t width, uint8_t *buffer, size_t num_units) override;
+	size_t data_write_block(io_width_t width, const uint8_t *buffer, size_t num_units) override;
 	virtual void generate_identify_device();
 	virtual void generate_mmc_inquiry();
 	virtual void prepare_read(uint32_t offset, uint32_t size);
@@ -306,6 +317,8 @@ public:
 	IO_ReadHandleObject ReadHandlerAlt[2] = {};
 	IO_WriteHandleObject WriteHandler[8] = {};
 	IO_WriteHandleObject WriteHandlerAlt[2] = {};
+	IO_BlockReadHandleObject BlockReadHandler = {};
+	IO_BlockWriteHandleObject BlockWriteHandler = {};
 
 public:
 	IDEDevice *device[2] = {nullptr, nullptr}; /* IDE devices (master, slave) */
@@ -1897,6 +1910,84 @@ void IDEATADevice::data_write(uint32_t v, io_width_t width)
 		io_completion();
 }
 
+/* Block variants of data_read() and data_write(): move whole units between
+   the sector buffer and the caller's buffer, completing each buffer as it
+   fills or drains. Stops as soon as the device leaves the data phase, such
+   as when a multi-sector command goes busy to fetch the next sector. */
+template <typename device_t>
+static size_t read_sector_block(device_t &dev, const io_width_t width,
+                                uint8_t *buffer, const size_t num_units)
+{
+	const auto unit_bytes = static_cast<uint32_t>(width);
+
+	size_t moved = 0;
+	while (moved < num_units && dev.state == IDE_DEV_DATA_READ &&
+	       (dev.status & IDE_STATUS_DRQ) && dev.sector_i < dev.sector_total) {
+		const auto units = std::min<size_t>(num_units - moved,
+		                                    (dev.sector_total - dev.sector_i) / unit_bytes);
+		if (units == 0)
+			break;
+
+		const auto num_bytes = units * unit_bytes;
+		memcpy(buffer, dev.sector + dev.sector_i, num_bytes);
+		buffer += num_bytes;
+		dev.sector_i += check_cast<uint32_t>(num_bytes);
+		moved += units;
+
+		if (dev.sector_i >= dev.sector_total)
+			dev.io_completion();
+	}
+	return moved;
+}
+
+template <typename device_t>
+static size_t write_sector_block(device_t &dev, const io_width_t width,
+                                 const uint8_t *buffer, const size_t num_units)
+{
+	const auto unit_bytes = static_cast<uint32_t>(width);
+
+	size_t moved = 0;
+	while (moved < num_units && dev.state == IDE_DEV_DATA_WRITE &&
+	       (dev.status & IDE_STATUS_DRQ) && dev.sector_i < dev.sector_total) {
+		const auto units = std::min<size_t>(num_units - moved,
+		                                    (dev.sector_total - dev.sector_i) / unit_bytes);
+		if (units == 0)
+			break;
+
+		const auto num_bytes = units * unit_bytes;
+		memcpy(dev.sector + dev.sector_i, buffer, num_bytes);
+		buffer += num_bytes;
+		dev.sector_i += check_cast<uint32_t>(num_bytes);
+		moved += units;
+
+		if (dev.sector_i >= dev.sector_total)
+			dev.io_completion();
+	}
+	return moved;
+}
+
+size_t IDEATADevice::data_read_block(io_width_t width, uint8_t *buffer, size_t num_units)
+{
+	return read_sector_block(*this, width, buffer, num_units);
+}
+
+size_t IDEATADevice::data_write_block(io_width_t width, const uint8_t *buffer, size_t num_units)
+{
+	return write_sector_block(*this, width, buffer, num_units);
+}
+
+size_t IDEATAPICDROMDevice::data_read_block(io_width_t width, uint8_t *buffer, size_t num_units)
+{
+	return read_sector_block(*this, width, buffer, num_units);
+}
+
+/* PACKET command bytes are still taken one write at a time, as the device
+   isn't in the data write state while receiving them */
+size_t IDEATAPICDROMDevice::data_write_block(io_width_t width, const uint8_t *buffer, size_t num_units)
+{
+	return write_sector_block(*this, width, buffer, num_units);
+}
+
 void IDEATAPICDROMDevice::prepare_read(uint32_t offset, uint32_t size)
 {
 	/* I/O must be WORD ALIGNED */
@@ -3406,6 +3497,16 @@ uint32_t IDEDevice::data_read(io_width_t)
 void IDEDevice::data_write(io_val_t, io_width_t)
 {}
 
+size_t IDEDevice::data_read_block(io_width_t, uint8_t *, size_t)
+{
+	return 0;
+}
+
+size_t IDEDevice::data_write_block(io_width_t, const uint8_t *, size_t)
+{
+	return 0;
+}
+
 /* IDE controller -> upon writing bit 2 of alt (0x3F6) */
 void IDEDevice::host_reset_complete()
 {
@@ -3835,6 +3936,8 @@ void IDEController::install_io_ports()
 			WriteHandler[i].Install(base_io + i, ide_baseio_w, io_width_t::dword);
 			ReadHandler[i].Install(base_io + i, ide_baseio_r, io_width_t::dword);
 		}
+		BlockWriteHandler.Install(base_io, ide_baseio_block_w);
+		BlockReadHandler.Install(base_io, ide_baseio_block_r);
 	}
 
 	if (alt_io != 0) {
@@ -3854,6 +3957,8 @@ void IDEController::uninstall_io_ports()
 		h.Uninstall();
 	for (auto & h : ReadHandler)
 		h.Uninstall();
+	BlockWriteHandler.Uninstall();
+	BlockReadHandler.Uninstall();
 
 	// Uninstall the two sets of alternate I/O ports
 	assert(alt_io != 0);
@@ -3991,6 +4096,40 @@ static uint32_t ide_baseio_r(io_port_t port, io_width_t width)
 	return ret;
 }
 
+/* Data port (1F0) block transfers. 32-bit PIO that has to be split or
+   ignored is left to the regular handlers. */
+static size_t ide_baseio_block_r(io_port_t port, io_width_t width,
+                                 uint8_t *buffer, size_t num_units)
+{
+	IDEController *ide = match_ide_controller(port);
+	if (ide == nullptr)
+		return 0;
+
+	if (width == io_width_t::dword && (!ide->enable_pio32 || ide->ignore_pio32))
+		return 0;
+
+	IDEDevice *dev = ide->device[ide->select];
+	return (dev != nullptr) ? dev->data_read_block(width, buffer, num_units) : 0;
+}
+
+static size_t ide_baseio_block_w(io_port_t port, io_width_t width,
+                                 const uint8_t *buffer, size_t num_units)
+{
+	IDEController *ide = match_ide_controller(port);
+	if (ide == nullptr)
+		return 0;
+
+	if (width == io_width_t::dword && (!ide->enable_pio32 || ide->ignore_pio32))
+		return 0;
+
+	/* busy writes are dropped (and logged) by the regular handler */
+	IDEDevice *dev = ide->device[ide->select];
+	if (dev == nullptr || (dev->status & IDE_STATUS_BUSY))
+		return 0;
+
+	return dev->data_write_block(width, buffer, num_units);
+}
+
 static void ide_baseio_w(io_port_t port, io_val_t val, io_width_t width)
 {
 	IDEController *ide = match_ide_controller(port);
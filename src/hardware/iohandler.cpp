@@ -24,18 +24,17 @@
 #include <cassert>
 #include <limits>
 #include <cstring>
-#include <unordered_map>
 
 #include "setup.h"
 #include "cpu.h"
 #include "../src/cpu/lazyflags.h"
 #include "callback.h"
+#include "support.h"
 
 //#define ENABLE_PORTLOG
 
 // type-sized IO handler containers
-extern std::unordered_map<io_port_t, io_read_f> io_read_handlers[io_widths];
-extern std::unordered_map<io_port_t, io_write_f> io_write_handlers[io_widths];
+void release_io_handlers();
 
 // type-sized IO handler API
 uint8_t read_byte_from_port(const io_port_t port);
@@ -44,6 +43,10 @@ uint32_t read_dword_from_port(const io_port_t port);
 void write_byte_to_port(const io_port_t port, const uint8_t val);
 void write_word_to_port(const io_port_t port, const uint16_t val);
 void write_dword_to_port(const io_port_t port, const uint32_t val);
+size_t read_block_from_port(const io_port_t port, const io_width_t width,
+                            uint8_t* const buffer, const size_t num_units);
+size_t write_block_to_port(const io_port_t port, const io_width_t width,
+                           const uint8_t* const buffer, const size_t num_units);
 
 
 struct IOF_Entry {
@@ -85,21 +88,24 @@ constexpr int32_t IODELAY_READ_MICROSk = static_cast<int32_t>(
 constexpr int32_t IODELAY_WRITE_MICROSk = static_cast<int32_t>(
         1024 / IODELAY_WRITE_MICROS);
 
-inline void IO_USEC_read_delay() {
-	auto delaycyc = CPU_CycleMax / IODELAY_READ_MICROSk;
+inline void IO_USEC_read_delay(const int32_t num_accesses = 1) {
+	// Wide enough for the delay of a long block transfer
+	auto delaycyc = static_cast<int64_t>(CPU_CycleMax / IODELAY_READ_MICROSk) *
+	                num_accesses;
 	if (delaycyc > CPU_Cycles) {
 		delaycyc = CPU_Cycles;
 	}
-	CPU_Cycles -= delaycyc;
+	CPU_Cycles -= static_cast<int32_t>(delaycyc);
 	CPU_IODelayRemoved += delaycyc;
 }
 
-inline void IO_USEC_write_delay() {
-	auto delaycyc = CPU_CycleMax / IODELAY_WRITE_MICROSk;
+inline void IO_USEC_write_delay(const int32_t num_accesses = 1) {
+	auto delaycyc = static_cast<int64_t>(CPU_CycleMax / IODELAY_WRITE_MICROSk) *
+	                num_accesses;
 	if (delaycyc > CPU_Cycles) {
 		delaycyc = CPU_Cycles;
 	}
-	CPU_Cycles -= delaycyc;
+	CPU_Cycles -= static_cast<int32_t>(delaycyc);
 	CPU_IODelayRemoved += delaycyc;
 }
 
@@ -375,6 +381,34 @@ uint32_t IO_ReadD(io_port_t port)
 	return retval;
 }
 
+// Block transfers skip the per-unit IO fault handling, so they're only used
+// when the port access doesn't need to be trapped. Dword accesses carry no
+// IO delay, matching IO_ReadD and IO_WriteD.
+size_t IO_ReadBlock(const io_port_t port, const io_width_t width,
+                    uint8_t* const buffer, const size_t num_units)
+{
+	if (GETFLAG(VM) && CPU_IO_Exception(port, static_cast<Bitu>(width))) {
+		return 0;
+	}
+	const auto moved = read_block_from_port(port, width, buffer, num_units);
+	if (moved && width != io_width_t::dword) {
+		IO_USEC_read_delay(check_cast<int32_t>(moved));
+	}
+	return moved;
+}
+
+size_t IO_WriteBlock(const io_port_t port, const io_width_t width,
+                     const uint8_t* const buffer, const size_t num_units)
+{
+	if (GETFLAG(VM) && CPU_IO_Exception(port, static_cast<Bitu>(width))) {
+		return 0;
+	}
+	const auto moved = write_block_to_port(port, width, buffer, num_units);
+	if (moved && width != io_width_t::dword) {
+		IO_USEC_write_delay(check_cast<int32_t>(moved));
+	}
+	return moved;
+}
 
 class IO final : public Module_base {
 public:
@@ -383,22 +417,7 @@ public:
 	}
 	~IO()
 	{
-		[[maybe_unused]] size_t total_bytes = 0u;
-		for (uint8_t i = 0; i < io_widths; ++i) {
-			const auto readers = io_read_handlers[i].size();
-			const auto writers = io_write_handlers[i].size();
-			LOG_DEBUG("IOBUS: Releasing %d read and %d write %d-bit port handlers",
-			          static_cast<int>(readers),
-			          static_cast<int>(writers),
-			          8 << i);
-
-			total_bytes += readers * sizeof(io_read_f) + sizeof(io_read_handlers[i]);
-			total_bytes += writers * sizeof(io_write_f) + sizeof(io_write_handlers[i]);
-			io_read_handlers[i].clear();
-			io_write_handlers[i].clear();
-		}
-		LOG_DEBUG("IOBUS: Handlers consumed %d total bytes",
-		          static_cast<int>(total_bytes));
+		release_io_handlers();
 	}
 };
 
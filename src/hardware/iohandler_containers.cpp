@@ -21,11 +21,15 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <unordered_map>
+#include <vector>
 
 #include "inout.h"
 #include "support.h"
@@ -54,74 +58,282 @@ IO_WriteHandleObject::~IO_WriteHandleObject(){
 	// static_cast<uint32_t>(m_port));
 }
 
-// type-sized IO handlers
-std::unordered_map<io_port_t, io_read_f> io_read_handlers[io_widths] = {};
-constexpr auto &io_read_byte_handler = io_read_handlers[0];
-constexpr auto &io_read_word_handler = io_read_handlers[1];
-constexpr auto &io_read_dword_handler = io_read_handlers[2];
+// Uncomment to count the accesses made to each port and width, which are
+// logged from the most to the least accessed when the handlers are released
+// #define ENABLE_PORT_COUNTERS
 
-std::unordered_map<io_port_t, io_write_f> io_write_handlers[io_widths] = {};
-constexpr auto &io_write_byte_handler = io_write_handlers[0];
-constexpr auto &io_write_word_handler = io_write_handlers[1];
-constexpr auto &io_write_dword_handler = io_write_handlers[2];
+constexpr size_t num_io_ports = std::numeric_limits<io_port_t>::max() + 1;
 
-constexpr io_val_t blocked_read(const io_port_t, const io_width_t)
+constexpr uint8_t to_width_index(const io_width_t width)
+{
+	return width == io_width_t::byte ? 0 : (width == io_width_t::word ? 1 : 2);
+}
+
+// Flat, direct-indexed IO handler tables
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Each port of each width holds a 16-bit index into a pool of handler slots,
+// so dispatching is two array lookups without hashing, and the tables are
+// small enough (128 KB per width) to stay cache-resident. All the ports
+// registered by a single call share one slot.
+//
+// Handlers that wrap a plain function with the exact handler signature are
+// called through the function pointer directly, bypassing std::function.
+//
+// A port's optional block handler is kept in the slot of its byte handler,
+// so it's dropped along with it when the port is freed or taken over by
+// another handler. Each slot holds at most one block handler.
+//
+template <typename handler_t, typename function_t, typename block_handler_t>
+class IoHandlerTable {
+public:
+	using slot_index_t = uint16_t;
+
+	// Index 0 marks a port without a handler for the given width, and
+	// index 1 holds the permanent fallback handler for blocked ports
+	static constexpr slot_index_t unhandled = 0;
+	static constexpr slot_index_t fallback  = 1;
+
+	struct Slot {
+		function_t* function          = nullptr;
+		handler_t handler             = {};
+		uint32_t num_ports            = 0;
+		block_handler_t block_handler = {};
+		io_port_t block_port          = 0;
+	};
+
+	IoHandlerTable(function_t* fallback_function)
+	{
+		slots.emplace_back();
+		slots.push_back({fallback_function, fallback_function, 0, {}, 0});
+	}
+
+	slot_index_t Add(const handler_t& handler)
+	{
+		slot_index_t index = unhandled;
+		if (free_slots.empty()) {
+			if (slots.size() == num_io_ports) {
+				E_Exit("IOBUS: Ran out of IO handler slots");
+			}
+			index = check_cast<slot_index_t>(slots.size());
+			slots.emplace_back();
+		} else {
+			index = free_slots.back();
+			free_slots.pop_back();
+		}
+		auto& slot   = slots[index];
+		slot.handler = handler;
+		slot.function = nullptr;
+		if (const auto function = handler.template target<function_t*>()) {
+			slot.function = *function;
+		}
+		return index;
+	}
+
+	// Releases the slot if no port refers to it
+	void ReleaseIfUnused(const slot_index_t index)
+	{
+		if (index > fallback && slots[index].num_ports == 0) {
+			slots[index] = {};
+			free_slots.push_back(index);
+		}
+	}
+
+	void Assign(const io_width_t width, const io_port_t port,
+	            const slot_index_t index)
+	{
+		auto& entry = ports[to_width_index(width)][port];
+		if (entry == index) {
+			return;
+		}
+		Unassign(width, port);
+		entry = index;
+		++slots[index].num_ports;
+	}
+
+	void Unassign(const io_width_t width, const io_port_t port)
+	{
+		auto& entry = ports[to_width_index(width)][port];
+		if (entry == unhandled) {
+			return;
+		}
+		auto& slot = slots[entry];
+		assert(slot.num_ports > 0);
+		--slot.num_ports;
+		if (width == io_width_t::byte && slot.block_port == port) {
+			slot.block_handler = {};
+		}
+		ReleaseIfUnused(entry);
+		entry = unhandled;
+	}
+
+	const Slot* Find(const io_width_t width, const io_port_t port) const
+	{
+		const auto index = ports[to_width_index(width)][port];
+		return index == unhandled ? nullptr : &slots[index];
+	}
+
+	// Returns false if the port has no byte handler to attach it to
+	bool SetBlockHandler(const io_port_t port, const block_handler_t& handler)
+	{
+		const auto index = ports[to_width_index(io_width_t::byte)][port];
+		if (index == unhandled || index == fallback) {
+			return false;
+		}
+		slots[index].block_handler = handler;
+		slots[index].block_port    = port;
+		return true;
+	}
+
+	void ClearBlockHandler(const io_port_t port)
+	{
+		const auto index = ports[to_width_index(io_width_t::byte)][port];
+		if (index > fallback && slots[index].block_port == port) {
+			slots[index].block_handler = {};
+		}
+	}
+
+	const block_handler_t* FindBlockHandler(const io_port_t port) const
+	{
+		const auto& slot = slots[ports[to_width_index(io_width_t::byte)][port]];
+		return (slot.block_handler && slot.block_port == port)
+		             ? &slot.block_handler
+		             : nullptr;
+	}
+
+	size_t CountPorts(const io_width_t width) const
+	{
+		const auto& table = ports[to_width_index(width)];
+		return num_io_ports - static_cast<size_t>(std::count(table.begin(),
+		                                                     table.end(),
+		                                                     unhandled));
+	}
+
+	size_t Clear()
+	{
+		const auto bytes = sizeof(ports) + slots.size() * sizeof(Slot);
+		for (auto& table : ports) {
+			table.fill(unhandled);
+		}
+		slots.resize(fallback + 1);
+		slots[fallback].num_ports = 0;
+		free_slots.clear();
+		return bytes;
+	}
+
+private:
+	std::array<std::array<slot_index_t, num_io_ports>, io_widths> ports = {};
+
+	// A deque keeps the slots in place while a running handler registers
+	// other handlers
+	std::deque<Slot> slots              = {};
+	std::vector<slot_index_t> free_slots = {};
+};
+
+using io_read_fn  = io_val_t(io_port_t port, io_width_t width);
+using io_write_fn = void(io_port_t port, io_val_t val, io_width_t width);
+
+static io_val_t blocked_read(const io_port_t, const io_width_t)
 {
 	return 0xff;
 }
 
+static void blocked_write(const io_port_t, const io_val_t, const io_width_t)
+{
+	// nothing to write to
+}
+
+static IoHandlerTable<io_read_f, io_read_fn, io_block_read_f> io_read_handlers(blocked_read);
+static IoHandlerTable<io_write_f, io_write_fn, io_block_write_f> io_write_handlers(blocked_write);
+
+#if defined(ENABLE_PORT_COUNTERS)
+static std::array<std::array<uint64_t, num_io_ports>, io_widths> io_read_counters = {};
+static std::array<std::array<uint64_t, num_io_ports>, io_widths> io_write_counters = {};
+
+static void count_port_access(std::array<std::array<uint64_t, num_io_ports>, io_widths>& counters,
+                              const io_width_t width, const io_port_t port)
+{
+	++counters[to_width_index(width)][port];
+}
+#else
+#define count_port_access(C, W, P)
+#endif
+
+template <typename slot_t>
+static io_val_t call_reader(const slot_t& slot, const io_port_t port,
+                            const io_width_t width)
+{
+	return slot.function ? slot.function(port, width) : slot.handler(port, width);
+}
+
+template <typename slot_t>
+static void call_writer(const slot_t& slot, const io_port_t port,
+                        const io_val_t val, const io_width_t width)
+{
+	slot.function ? slot.function(port, val, width)
+	              : slot.handler(port, val, width);
+}
+
 // type-sized IO handler API
 uint8_t read_byte_from_port(const io_port_t port)
 {
-	const auto [it, was_blocked] = io_read_byte_handler.emplace(port, blocked_read);
-	if (was_blocked)
+	count_port_access(io_read_counters, io_width_t::byte, port);
+
+	auto reader = io_read_handlers.Find(io_width_t::byte, port);
+	if (!reader) {
 		LOG(LOG_IO, LOG_WARN)("Unhandled read from port %04Xh; blocking", port);
-	return it->second(port, io_width_t::byte) & 0xff;
+		io_read_handlers.Assign(io_width_t::byte, port, io_read_handlers.fallback);
+		reader = io_read_handlers.Find(io_width_t::byte, port);
+	}
+	return call_reader(*reader, port, io_width_t::byte) & 0xff;
 }
 
 uint16_t read_word_from_port(const io_port_t port)
 {
-	const auto reader = io_read_word_handler.find(port);
-	const auto value = reader != io_read_word_handler.end()
-	                           ? (reader->second(port, io_width_t::word) & 0xffff)
-	                           : static_cast<io_val_t>(
-	                                     read_byte_from_port(port) |
-	                                     (read_byte_from_port(port + 1) << 8));
+	count_port_access(io_read_counters, io_width_t::word, port);
+
+	const auto reader = io_read_handlers.Find(io_width_t::word, port);
+	const auto value = reader ? (call_reader(*reader, port, io_width_t::word) & 0xffff)
+	                          : static_cast<io_val_t>(
+	                                    read_byte_from_port(port) |
+	                                    (read_byte_from_port(port + 1) << 8));
 	return check_cast<uint16_t>(value);
 }
 
 uint32_t read_dword_from_port(const io_port_t port)
 {
-	const auto reader = io_read_dword_handler.find(port);
-	const auto value = reader != io_read_dword_handler.end()
-	                           ? reader->second(port, io_width_t::dword)
-	                           : static_cast<io_val_t>(
-	                                     read_word_from_port(port) |
-	                                     (read_word_from_port(port + 2) << 16));
+	count_port_access(io_read_counters, io_width_t::dword, port);
+
+	const auto reader = io_read_handlers.Find(io_width_t::dword, port);
+	const auto value = reader ? call_reader(*reader, port, io_width_t::dword)
+	                          : static_cast<io_val_t>(
+	                                    read_word_from_port(port) |
+	                                    (read_word_from_port(port + 2) << 16));
 	assert(value <= UINT32_MAX);
 	return static_cast<uint32_t>(value);
 }
 
-constexpr void blocked_write(const io_port_t, const io_val_t, const io_width_t)
-{
-	// nothing to write to
-}
-
 void write_byte_to_port(const io_port_t port, const uint8_t val)
 {
-	const auto [it, was_blocked] = io_write_byte_handler.emplace(port, blocked_write);
-	if (was_blocked)
+	count_port_access(io_write_counters, io_width_t::byte, port);
+
+	auto writer = io_write_handlers.Find(io_width_t::byte, port);
+	if (!writer) {
 		LOG(LOG_IO, LOG_WARN)("Unhandled write of value 0x%02x"
 		                      " (%u) to port %04Xh; blocking",
 		                      val, val, port);
-	it->second(port, val, io_width_t::byte);
+		io_write_handlers.Assign(io_width_t::byte, port, io_write_handlers.fallback);
+		writer = io_write_handlers.Find(io_width_t::byte, port);
+	}
+	call_writer(*writer, port, val, io_width_t::byte);
 }
 
 void write_word_to_port(const io_port_t port, const uint16_t val)
 {
-	const auto writer = io_write_word_handler.find(port);
-	if (writer != io_write_word_handler.end()) {
-		writer->second(port, val, io_width_t::word);
+	count_port_access(io_write_counters, io_width_t::word, port);
+
+	const auto writer = io_write_handlers.Find(io_width_t::word, port);
+	if (writer) {
+		call_writer(*writer, port, val, io_width_t::word);
 	} else {
 		write_byte_to_port(port, static_cast<uint8_t>(val & 0xff));
 		write_byte_to_port(port + 1, static_cast<uint8_t>(val >> 8));
@@ -130,71 +342,188 @@ void write_word_to_port(const io_port_t port, const uint16_t val)
 
 void write_dword_to_port(const io_port_t port, const uint32_t val)
 {
-	const auto writer = io_write_dword_handler.find(port);
-	if (writer != io_write_dword_handler.end()) {
-		writer->second(port, val, io_width_t::dword);
+	count_port_access(io_write_counters, io_width_t::dword, port);
+
+	const auto writer = io_write_handlers.Find(io_width_t::dword, port);
+	if (writer) {
+		call_writer(*writer, port, val, io_width_t::dword);
 	} else {
 		write_word_to_port(port, static_cast<uint16_t>(val & 0xffff));
 		write_word_to_port(port + 2, static_cast<uint16_t>(val >> 16));
 	}
 }
 
-void IO_RegisterReadHandler(io_port_t port,
-                            const io_read_f handler,
-                            const io_width_t max_width,
-                            io_port_t range)
+// Assigns the handler to each port in the range for every width up to and
+// including the maximum width
+template <typename table_t, typename handler_t>
+static void register_handler(table_t& table, io_port_t port,
+                             const handler_t& handler,
+                             const io_width_t max_width, io_port_t range)
 {
+	const auto slot = table.Add(handler);
 	while (range--) {
-		io_read_byte_handler[port] = handler;
+		table.Assign(io_width_t::byte, port, slot);
 		if (max_width == io_width_t::word || max_width == io_width_t::dword)
-			io_read_word_handler[port] = handler;
+			table.Assign(io_width_t::word, port, slot);
 		if (max_width == io_width_t::dword)
-			io_read_dword_handler[port] = handler;
+			table.Assign(io_width_t::dword, port, slot);
 		++port;
 	}
+	// The range might have been empty
+	table.ReleaseIfUnused(slot);
 }
 
-void IO_RegisterWriteHandler(io_port_t port,
-                             const io_write_f handler,
-                             const io_width_t max_width,
-                             io_port_t range)
+template <typename table_t>
+static void free_handler(table_t& table, io_port_t port,
+                         const io_width_t max_width, io_port_t range)
 {
 	while (range--) {
-		io_write_byte_handler[port] = handler;
+		table.Unassign(io_width_t::byte, port);
 		if (max_width == io_width_t::word || max_width == io_width_t::dword)
-			io_write_word_handler[port] = handler;
+			table.Unassign(io_width_t::word, port);
 		if (max_width == io_width_t::dword)
-			io_write_dword_handler[port] = handler;
+			table.Unassign(io_width_t::dword, port);
 		++port;
 	}
 }
 
+void IO_RegisterReadHandler(io_port_t port,
+                            const io_read_f handler,
+                            const io_width_t max_width,
+                            io_port_t range)
+{
+	register_handler(io_read_handlers, port, handler, max_width, range);
+}
+
+void IO_RegisterWriteHandler(io_port_t port,
+                             const io_write_f handler,
+                             const io_width_t max_width,
+                             io_port_t range)
+{
+	register_handler(io_write_handlers, port, handler, max_width, range);
+}
+
 void IO_FreeReadHandler(io_port_t port,
                         const io_width_t max_width,
                         io_port_t range)
 {
-	while (range--) {
-		io_read_byte_handler.erase(port);
-		if (max_width == io_width_t::word || max_width == io_width_t::dword)
-			io_read_word_handler.erase(port);
-		if (max_width == io_width_t::dword)
-			io_read_dword_handler.erase(port);
-		++port;
-	}
+	free_handler(io_read_handlers, port, max_width, range);
 }
 
 void IO_FreeWriteHandler(io_port_t port,
                          const io_width_t width,
                          io_port_t range)
 {
-	while (range--) {
-		io_write_byte_handler.erase(port);
-		if (width == io_width_t::word || width == io_width_t::dword)
-			io_write_word_handler.erase(port);
-		if (width == io_width_t::dword)
-			io_write_dword_handler.erase(port);
-		++port;
+	free_handler(io_write_handlers, port, width, range);
+}
+
+size_t read_block_from_port(const io_port_t port, const io_width_t width,
+                            uint8_t* const buffer, const size_t num_units)
+{
+	const auto reader = io_read_handlers.FindBlockHandler(port);
+	if (!reader) {
+		return 0;
+	}
+	const auto moved = (*reader)(port, width, buffer, num_units);
+	assert(moved <= num_units);
+	return moved;
+}
+
+size_t write_block_to_port(const io_port_t port, const io_width_t width,
+                           const uint8_t* const buffer, const size_t num_units)
+{
+	const auto writer = io_write_handlers.FindBlockHandler(port);
+	if (!writer) {
+		return 0;
 	}
+	const auto moved = (*writer)(port, width, buffer, num_units);
+	assert(moved <= num_units);
+	return moved;
+}
+
+void IO_RegisterBlockReadHandler(const io_port_t port, const io_block_read_f handler)
+{
+	if (!io_read_handlers.SetBlockHandler(port, handler)) {
+		LOG_WARNING("IOBUS: Port %04Xh has no read handler for its block read handler",
+		            port);
+	}
+}
+
+void IO_RegisterBlockWriteHandler(const io_port_t port, const io_block_write_f handler)
+{
+	if (!io_write_handlers.SetBlockHandler(port, handler)) {
+		LOG_WARNING("IOBUS: Port %04Xh has no write handler for its block write handler",
+		            port);
+	}
+}
+
+void IO_FreeBlockReadHandler(const io_port_t port)
+{
+	io_read_handlers.ClearBlockHandler(port);
+}
+
+void IO_FreeBlockWriteHandler(const io_port_t port)
+{
+	io_write_handlers.ClearBlockHandler(port);
+}
+
+#if defined(ENABLE_PORT_COUNTERS)
+static void log_port_counters()
+{
+	struct PortCount {
+		uint64_t count   = 0;
+		io_port_t port   = 0;
+		io_width_t width = io_width_t::byte;
+		bool is_write    = false;
+	};
+	std::vector<PortCount> port_counts = {};
+
+	auto gather = [&](auto& counters, const bool is_write) {
+		for (const auto width :
+		     {io_width_t::byte, io_width_t::word, io_width_t::dword}) {
+			auto& counts = counters[to_width_index(width)];
+			for (size_t port = 0; port < num_io_ports; ++port) {
+				if (counts[port]) {
+					port_counts.push_back({counts[port],
+					                       static_cast<io_port_t>(port),
+					                       width,
+					                       is_write});
+				}
+			}
+			counts.fill(0);
+		}
+	};
+	gather(io_read_counters, false);
+	gather(io_write_counters, true);
+
+	std::sort(port_counts.begin(), port_counts.end(), [](const auto& a, const auto& b) {
+		return a.count > b.count;
+	});
+	for (const auto& pc : port_counts) {
+		LOG_MSG("IOBUS: %10llu %d-bit %s port %04Xh",
+		        static_cast<unsigned long long>(pc.count),
+		        static_cast<int>(pc.width) * 8,
+		        pc.is_write ? "writes to" : "reads from",
+		        pc.port);
+	}
+}
+#endif
+
+void release_io_handlers()
+{
+	for (const auto width : {io_width_t::byte, io_width_t::word, io_width_t::dword}) {
+		LOG_DEBUG("IOBUS: Releasing %d read and %d write %d-bit port handlers",
+		          static_cast<int>(io_read_handlers.CountPorts(width)),
+		          static_cast<int>(io_write_handlers.CountPorts(width)),
+		          static_cast<int>(width) * 8);
+	}
+#if defined(ENABLE_PORT_COUNTERS)
+	log_port_counters();
+#endif
+	[[maybe_unused]] const auto total_bytes = io_read_handlers.Clear() +
+	                                          io_write_handlers.Clear();
+	LOG_DEBUG("IOBUS: Handlers consumed %d total bytes",
+	          static_cast<int>(total_bytes));
 }
 
 void IO_ReadHandleObject::Install(const io_port_t port,
@@ -226,3 +555,53 @@ void IO_WriteHandleObject::Install(const io_port_t port,
 	} else
 		E_Exit("io_write_f already installed port %u", port);
 }
+
+void IO_BlockReadHandleObject::Install(const io_port_t port,
+                                       const io_block_read_f handler)
+{
+	if (!installed) {
+		installed = true;
+		m_port = port;
+		m_range = 1;
+		IO_RegisterBlockReadHandler(port, handler);
+	} else
+		E_Exit("io_block_read_f already installed port %u", port);
+}
+
+void IO_BlockReadHandleObject::Uninstall()
+{
+	if (!installed) return;
+
+	IO_FreeBlockReadHandler(m_port);
+	installed = false;
+}
+
+IO_BlockReadHandleObject::~IO_BlockReadHandleObject()
+{
+	Uninstall();
+}
+
+void IO_BlockWriteHandleObject::Install(const io_port_t port,
+                                        const io_block_write_f handler)
+{
+	if (!installed) {
+		installed = true;
+		m_port = port;
+		m_range = 1;
+		IO_RegisterBlockWriteHandler(port, handler);
+	} else
+		E_Exit("io_block_write_f already installed port %u", port);
+}
+
+void IO_BlockWriteHandleObject::Uninstall()
+{
+	if (!installed) return;
+
+	IO_FreeBlockWriteHandler(m_port);
+	installed = false;
+}
+
+IO_BlockWriteHandleObject::~IO_BlockWriteHandleObject()
+{
+	Uninstall();
+}
@@ -23,10 +23,14 @@
 
 #include <SDL_net.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <thread>
 
 #include "cross.h"
 #include "string_utils.h"
@@ -43,6 +47,7 @@
 #include "timer.h"
 #include "programs.h"
 #include "pic.h"
+#include "spsc_queue.h"
 
 #define SOCKTABLESIZE	150 // DOS IPX driver was limited to 150 open sockets
 
@@ -57,14 +62,50 @@ bool isIpxConnected;
 IPaddress ipxServConnIp;			// IPAddress for client connection to server
 UDPsocket ipxClientSocket;
 int UDPChannel;						// Channel used by UDP connection
-uint8_t recvBuffer[IPXBUFFERSIZE];	// Incoming packet buffer
 
 static RealPt ipx_callback;
 
-SDLNet_SocketSet clientSocketSet;
-
 packetBuffer incomingPacket;
 
+// Packets from the server are received on a dedicated I/O thread that sleeps
+// until the socket is readable, then drains it. The emulation thread hands
+// the queued packets to the listening ECBs on every tick and whenever the
+// guest calls the IPX driver (games poll it with "relinquish control"), so
+// it never waits for or polls the socket itself.
+struct ReceivedIpxPacket {
+	int64_t arrival_us = 0;
+	int16_t size       = 0;
+
+	std::array<uint8_t, IPXBUFFERSIZE> data = {};
+};
+
+static struct {
+	std::thread thread                = {};
+	std::atomic<bool> is_running      = false;
+	SDLNet_SocketSet socket_set       = nullptr;
+
+	SpscQueue<ReceivedIpxPacket, 256> received = {};
+
+	// Set on the I/O thread
+	std::atomic<uint64_t> num_dropped = 0;
+	std::atomic<bool> has_failed      = false;
+} client_io = {};
+
+// Only touched on the emulation thread
+static struct {
+	uint64_t packets_sent     = 0;
+	uint64_t bytes_sent       = 0;
+	uint64_t packets_received = 0;
+	uint64_t bytes_received   = 0;
+
+	// Time between the packet's arrival and its delivery to the guest
+	int64_t total_latency_us = 0;
+	int64_t max_latency_us   = 0;
+} client_stats = {};
+
+void DisconnectFromServer(bool unexpected);
+static void deliver_received_packets();
+
 static uint16_t socketCount;
 static uint16_t opensockets[SOCKTABLESIZE];
 
@@ -373,6 +414,8 @@ static void sendPacket(ECBClass* sendecb);
 static void handleIpxRequest(void) {
 	ECBClass *tmpECB;
 
+	deliver_received_packets();
+
 	switch (reg_bx) {
 	case 0x0000: // Open socket
 		OpenSocket();
@@ -607,24 +650,146 @@ static void receivePacket(uint8_t *buffer, int16_t bufSize) {
 	LOG_IPX("IPX: RX Packet loss!");
 }
 
-static void IPX_ClientLoop(void) {
-	int numrecv;
-	UDPpacket inPacket;
-	inPacket.data = (Uint8 *)recvBuffer;
-	inPacket.maxlen = IPXBUFFERSIZE;
-	inPacket.channel = UDPChannel;
-
-	// Its amazing how much simpler UDP is than TCP
-	numrecv = SDLNet_UDP_Recv(ipxClientSocket, &inPacket);
-	if(numrecv) receivePacket(inPacket.data, inPacket.len);
+static void receive_packets_threaded()
+{
+	// Packets that don't fit into a full queue are still read (and
+	// dropped), otherwise the socket would stay readable and we'd spin
+	ReceivedIpxPacket overflow = {};
+
+	constexpr auto PollTimeoutMs = 100;
+
+	while (client_io.is_running) {
+		const auto num_ready = SDLNet_CheckSockets(client_io.socket_set,
+		                                           PollTimeoutMs);
+		if (num_ready < 0) {
+			client_io.has_failed = true;
+			return;
+		}
+		if (num_ready == 0) {
+			continue;
+		}
+		while (true) {
+			auto packet = client_io.received.GetWriteSlot();
+			if (!packet) {
+				packet = &overflow;
+			}
+
+			UDPpacket in_packet = {};
+			in_packet.data      = packet->data.data();
+			in_packet.maxlen    = IPXBUFFERSIZE;
+			in_packet.channel   = UDPChannel;
+
+			const auto result = SDLNet_UDP_Recv(ipxClientSocket, &in_packet);
+			if (result == 0) {
+				break;
+			}
+			if (result < 0) {
+				client_io.has_failed = true;
+				return;
+			}
+			if (packet == &overflow) {
+				++client_io.num_dropped;
+				continue;
+			}
+			packet->arrival_us = GetTicksUs();
+			packet->size       = static_cast<int16_t>(in_packet.len);
+			client_io.received.Push();
+		}
+	}
+}
+
+static bool start_client_io_thread()
+{
+	assert(!client_io.is_running);
+
+	client_io.socket_set = SDLNet_AllocSocketSet(1);
+	if (!client_io.socket_set ||
+	    SDLNet_UDP_AddSocket(client_io.socket_set, ipxClientSocket) == -1) {
+		LOG_ERR("IPX: %s", SDLNet_GetError());
+		return false;
+	}
+	client_io.num_dropped = 0;
+	client_io.has_failed  = false;
+	client_stats          = {};
+
+	client_io.is_running = true;
+	client_io.thread     = std::thread(receive_packets_threaded);
+	return true;
+}
+
+static void stop_client_io_thread()
+{
+	client_io.is_running = false;
+	if (client_io.thread.joinable()) {
+		client_io.thread.join();
+	}
+	if (client_io.socket_set) {
+		SDLNet_FreeSocketSet(client_io.socket_set);
+		client_io.socket_set = nullptr;
+	}
+	while (client_io.received.Front()) {
+		client_io.received.Pop();
+	}
+}
+
+static void log_client_stats()
+{
+	const auto& stats = client_stats;
+
+	const auto avg_latency_us = stats.packets_received
+	                                  ? stats.total_latency_us /
+	                                            static_cast<int64_t>(
+	                                                    stats.packets_received)
+	                                  : 0;
+
+	LOG_MSG("IPX: Sent %" PRIu64 " packets (%" PRIu64 " bytes), received %" PRIu64
+	        " packets (%" PRIu64 " bytes), dropped %" PRIu64,
+	        stats.packets_sent,
+	        stats.bytes_sent,
+	        stats.packets_received,
+	        stats.bytes_received,
+	        client_io.num_dropped.load());
+
+	LOG_MSG("IPX: Received packets waited %" PRId64 " us on average, %" PRId64
+	        " us at most",
+	        avg_latency_us,
+	        stats.max_latency_us);
+}
+
+static void deliver_received_packets()
+{
+	if (!incomingPacket.connected) {
+		return;
+	}
+	if (client_io.has_failed) {
+		DisconnectFromServer(true);
+		return;
+	}
+	while (const auto packet = client_io.received.Front()) {
+		const auto latency_us = GetTicksUsSince(packet->arrival_us);
+
+		auto& stats = client_stats;
+		++stats.packets_received;
+		stats.bytes_received += static_cast<uint64_t>(packet->size);
+		stats.total_latency_us += latency_us;
+		stats.max_latency_us = std::max(stats.max_latency_us, latency_us);
+
+		receivePacket(packet->data.data(), packet->size);
+		client_io.received.Pop();
+	}
 }
 
+static void IPX_ClientLoop(void) {
+	deliver_received_packets();
+}
 
 void DisconnectFromServer(bool unexpected) {
 	if(unexpected) LOG_MSG("IPX: Server disconnected unexpectedly");
 	if(incomingPacket.connected) {
 		incomingPacket.connected = false;
 		TIMER_DelTickHandler(&IPX_ClientLoop);
+		stop_client_io_thread();
+		log_client_stats();
 		SDLNet_UDP_Close(ipxClientSocket);
 	}
 }
@@ -726,6 +891,9 @@ static void sendPacket(ECBClass* sendecb) {
 		} else {
 			sendecb->setCompletionFlag(COMP_SUCCESS);
 			LOG_IPX("Packet sent: size: %d",packetsize);
+
+			++client_stats.packets_sent;
+			client_stats.bytes_sent += static_cast<uint64_t>(packetsize);
 		}
 	}
 	else sendecb->setCompletionFlag(COMP_SUCCESS);
@@ -739,20 +907,15 @@ static void sendPacket(ECBClass* sendecb) {
 }
 
 static bool pingCheck(IPXHeader * outHeader) {
-	char buffer[1024];
-	UDPpacket regPacket;
-	IPXHeader *regHeader;
-	regPacket.data = (Uint8 *)buffer;
-	regPacket.maxlen = sizeof(buffer);
-	regPacket.channel = UDPChannel;
-	regHeader = (IPXHeader *)buffer;
-
-	const int result = SDLNet_UDP_Recv(ipxClientSocket, &regPacket);
-	if (result != 0) {
-		memcpy(outHeader, regHeader, sizeof(IPXHeader));
-		return true;
+	// The I/O thread owns the socket, so we take the responses from its
+	// queue
+	const auto packet = client_io.received.Front();
+	if (!packet) {
+		return false;
 	}
-	return false;
+	memcpy(outHeader, packet->data.data(), sizeof(IPXHeader));
+	client_io.received.Pop();
+	return true;
 }
 
 bool ConnectToServer(const char* strAddr)
@@ -825,6 +988,11 @@ bool ConnectToServer(const char* strAddr)
 
 				LOG_MSG("IPX: Connected to server.  IPX address is %d:%d:%d:%d:%d:%d", CONVIPX(localIpxAddr.netnode));
 
+				if (!start_client_io_thread()) {
+					stop_client_io_thread();
+					SDLNet_UDP_Close(ipxClientSocket);
+					return false;
+				}
 				incomingPacket.connected = true;
 				TIMER_AddTickHandler(&IPX_ClientLoop);
 				return true;
@@ -1021,6 +1189,10 @@ public:
 				WriteOut("Client status: ");
 				if(incomingPacket.connected) {
 					WriteOut("CONNECTED -- Server at %d.%d.%d.%d port %d\n", CONVIP(ipxServConnIp.host), udpPort);
+					WriteOut("Packets sent: %" PRIu64 ", received: %" PRIu64 ", dropped: %" PRIu64 "\n",
+					         client_stats.packets_sent,
+					         client_stats.packets_received,
+					         client_io.num_dropped.load());
 				} else {
 					WriteOut("DISCONNECTED\n");
 				}
@@ -21,6 +21,7 @@
 #if C_IPX
 
 #include <atomic>
+#include <cinttypes>
 #include <thread>
 
 #include "ipx.h"
@@ -35,9 +36,29 @@ static SDLNet_SocketSet socket_set = nullptr;
 
 static packetBuffer connBuffer[SOCKETTABLESIZE];
 
-static uint8_t inBuffer[IPXBUFFERSIZE];
 static IPaddress ipconn[SOCKETTABLESIZE]; // Active TCP/IP connection
 
+// Everything readable is received in batches per wakeup, and a broadcast is
+// handed to SDL_net as a single vector of per-client packets, so a busy
+// session doesn't cost a full round through the server loop per packet and
+// client.
+static constexpr int RecvBatchSize = 32;
+
+static UDPpacket** in_packets = nullptr;
+
+static UDPpacket out_packets[SOCKETTABLESIZE];
+static UDPpacket* out_vector[SOCKETTABLESIZE];
+
+// Only touched on the server thread, and read after it has stopped
+struct ConnectionStats {
+	uint64_t packets_in  = 0;
+	uint64_t bytes_in    = 0;
+	uint64_t packets_out = 0;
+	uint64_t bytes_out   = 0;
+};
+
+static ConnectionStats conn_stats[SOCKETTABLESIZE];
+
 static std::thread ipx_server_thread;
 static std::atomic_bool ipx_server_running = false;
 
@@ -66,14 +87,14 @@ static void closeSocket(uint16_t sockidx) {
 }
 */
 
+static bool is_same_address(const IPaddress& a, const IPaddress& b)
+{
+	return a.host == b.host && a.port == b.port;
+}
+
 static void sendIPXPacket(uint8_t *buffer, int16_t bufSize) {
 	uint16_t srcport, destport;
 	uint32_t srchost, desthost;
-	UDPpacket outPacket;
-	outPacket.channel = -1;
-	outPacket.data = buffer;
-	outPacket.len = bufSize;
-	outPacket.maxlen = bufSize;
 	IPXHeader *tmpHeader;
 	tmpHeader = (IPXHeader *)buffer;
 
@@ -83,36 +104,51 @@ static void sendIPXPacket(uint8_t *buffer, int16_t bufSize) {
 	srcport = tmpHeader->src.addr.byIP.port;
 	destport = tmpHeader->dest.addr.byIP.port;
 
-	if(desthost == 0xffffffff) {
-		// Broadcast
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if(connBuffer[i].connected && ((ipconn[i].host != srchost)||(ipconn[i].port!=srcport))) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
-					continue;
-				}
-				//LOG_MSG("IPXSERVER: Packet of %d bytes sent from %d.%d.%d.%d to %d.%d.%d.%d (BROADCAST) (%x CRC)", bufSize, CONVIP(srchost), CONVIP(ipconn[i].host), packetCRC(&buffer[30], bufSize-30));
-			}
+	const bool is_broadcast = (desthost == 0xffffffff);
+
+	uint16_t recipients[SOCKETTABLESIZE];
+	int num_recipients = 0;
+
+	for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
+		if (!connBuffer[i].connected) {
+			continue;
 		}
-	} else {
-		// Specific address
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if((connBuffer[i].connected) && (ipconn[i].host == desthost) && (ipconn[i].port == destport)) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
-					continue;
-				}
-				//LOG_MSG("IPXSERVER: Packet sent from %d.%d.%d.%d to %d.%d.%d.%d", CONVIP(srchost), CONVIP(desthost));
-			}
+		const bool is_recipient =
+		        is_broadcast ? ((ipconn[i].host != srchost) ||
+		                        (ipconn[i].port != srcport))
+		                     : ((ipconn[i].host == desthost) &&
+		                        (ipconn[i].port == destport));
+		if (!is_recipient) {
+			continue;
 		}
+		auto& out_packet   = out_packets[num_recipients];
+		out_packet.channel = UDP_UNICAST;
+		out_packet.data    = buffer;
+		out_packet.len     = bufSize;
+		out_packet.maxlen  = bufSize;
+		out_packet.address = ipconn[i];
+
+		out_vector[num_recipients] = &out_packet;
+		recipients[num_recipients] = i;
+		++num_recipients;
+	}
+	if (num_recipients == 0) {
+		return;
+	}
+
+	// SendV sets the status of every packet to the number of bytes sent,
+	// or -1 on failure
+	SDLNet_UDP_SendV(ipxServerSocket, out_vector, num_recipients);
+
+	for (int n = 0; n < num_recipients; ++n) {
+		if (out_packets[n].status < 0) {
+			LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
+			continue;
+		}
+		auto& stats = conn_stats[recipients[n]];
+		++stats.packets_out;
+		stats.bytes_out += static_cast<uint64_t>(bufSize);
+		//LOG_MSG("IPXSERVER: Packet of %d bytes sent from %d.%d.%d.%d to %d.%d.%d.%d (%x CRC)", bufSize, CONVIP(srchost), CONVIP(ipconn[recipients[n]].host), packetCRC(&buffer[30], bufSize-30));
 	}
 }
 
@@ -149,24 +185,18 @@ static void ackClient(IPaddress clientAddr) {
 		        SDLNet_GetError());
 }
 
-static void IPX_ServerLoop() {
-	UDPpacket inPacket;
+static void handleIncomingPacket(UDPpacket& inPacket) {
 	IPaddress tmpAddr;
 
 	//char regString[] = "IPX Register\0";
 
 	uint32_t host;
 
-	inPacket.channel = -1;
-	inPacket.data = &inBuffer[0];
-	inPacket.maxlen = IPXBUFFERSIZE;
-
-	const int result = SDLNet_UDP_Recv(ipxServerSocket, &inPacket);
-	if (result != 0) {
+	{
 		// Check to see if incoming packet is a registration packet
 		// For this, I just spoofed the echo protocol packet designation 0x02
 		IPXHeader *tmpHeader;
-		tmpHeader = (IPXHeader *)&inBuffer[0];
+		tmpHeader = (IPXHeader *)inPacket.data;
 
 		// Check to see if echo packet
 		if(SDLNet_Read16(tmpHeader->dest.socket) == 0x2) {
@@ -180,6 +210,7 @@ static void IPX_ServerLoop() {
 						ipconn[i] = inPacket.address;
 
 						connBuffer[i].connected = true;
+						conn_stats[i] = {};
 						host = ipconn[i].host;
 						LOG_MSG("IPXSERVER: Connect from %d.%d.%d.%d", CONVIP(host));
 						ackClient(inPacket.address);
@@ -198,12 +229,55 @@ static void IPX_ServerLoop() {
 			}
 		}
 
+		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
+			if (connBuffer[i].connected &&
+			    is_same_address(ipconn[i], inPacket.address)) {
+				++conn_stats[i].packets_in;
+				conn_stats[i].bytes_in += static_cast<uint64_t>(
+				        inPacket.len);
+				break;
+			}
+		}
+
 		// IPX packet is complete.  Now interpret IPX header and send to respective IP address
 		sendIPXPacket((uint8_t*)inPacket.data,
 		              static_cast<int16_t>(inPacket.len));
 	}
 }
 
+static void IPX_ServerLoop() {
+	// Drain everything that has arrived; a full batch means there may be
+	// more waiting
+	int num_received = 0;
+	do {
+		num_received = SDLNet_UDP_RecvV(ipxServerSocket, in_packets);
+		if (num_received < 0) {
+			LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+			return;
+		}
+		for (int i = 0; i < num_received; ++i) {
+			handleIncomingPacket(*in_packets[i]);
+		}
+	} while (num_received == RecvBatchSize);
+}
+
+static void log_connection_stats()
+{
+	for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
+		if (!connBuffer[i].connected) {
+			continue;
+		}
+		const auto& stats = conn_stats[i];
+		LOG_MSG("IPXSERVER: %d.%d.%d.%d: %" PRIu64 " packets (%" PRIu64
+		        " bytes) in, %" PRIu64 " packets (%" PRIu64 " bytes) out",
+		        CONVIP(ipconn[i].host),
+		        stats.packets_in,
+		        stats.bytes_in,
+		        stats.packets_out,
+		        stats.bytes_out);
+	}
+}
+
 void IPX_StopServer() {
 	ipx_server_running = false;
 
@@ -211,9 +285,14 @@ void IPX_StopServer() {
 		ipx_server_thread.join();
 	}
 
+	log_connection_stats();
+
 	SDLNet_FreeSocketSet(socket_set);
 	SDLNet_UDP_Close(ipxServerSocket);
 	socket_set = nullptr;
+
+	SDLNet_FreePacketV(in_packets);
+	in_packets = nullptr;
 }
 
 bool IPX_StartServer(uint16_t portnum)
@@ -226,6 +305,18 @@ bool IPX_StartServer(uint16_t portnum)
 		for (auto& i : connBuffer) {
 			i.connected = false;
 		}
+		for (auto& stats : conn_stats) {
+			stats = {};
+		}
+
+		if (!in_packets) {
+			in_packets = SDLNet_AllocPacketV(RecvBatchSize,
+			                                 IPXBUFFERSIZE);
+			if (!in_packets) {
+				LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+				return false;
+			}
+		}
 
 		if (!socket_set) {
 			socket_set = SDLNet_AllocSocketSet(1);
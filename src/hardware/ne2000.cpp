@@ -1219,7 +1219,9 @@ bx_ne2k_c::rx_handler(void *arg, const void *buf, unsigned len)
  * ethernet frame has been received. The destination address
  * is tested to see if it should be accepted, and if the
  * rx ring has enough room, it is copied into it and
- * the receive process is updated
+ * the receive process is updated. Returns the length taken,
+ * 0 if the frame isn't meant for us, or -1 if it was lost
+ * because the card is stopped or the rx ring is full
  */
 int bx_ne2k_c::rx_frame(const void *buf, unsigned io_len)
 {
@@ -1273,7 +1275,7 @@ int bx_ne2k_c::rx_frame(const void *buf, unsigned io_len)
 
   if ((io_len < 40/*60*/) && !BX_NE2K_THIS s.RCR.runts_ok) {
     BX_DEBUG("rejected small packet, length %d", io_len);
-    return -1;
+    return 0;
   }
   // some computers don't care...
   if (io_len < 60) io_len=60;
@@ -1282,18 +1284,18 @@ int bx_ne2k_c::rx_frame(const void *buf, unsigned io_len)
   if (! BX_NE2K_THIS s.RCR.promisc) {
     if (!memcmp(buf, bcast_addr, 6)) {
       if (!BX_NE2K_THIS s.RCR.broadcast) {
-	      return -1;
+	      return 0;
       }
     } else if (pktbuf[0] & 0x01) {
 	if (! BX_NE2K_THIS s.RCR.multicast) {
-		return -1;
+		return 0;
 	}
       idx = mcast_index(buf);
       if (!(BX_NE2K_THIS s.mchash[idx >> 3] & (1 << (idx & 0x7)))) {
-	      return -1;
+	      return 0;
       }
     } else if (0 != memcmp(buf, BX_NE2K_THIS s.physaddr, 6)) {
-	    return -1;
+	    return 0;
     }
   } else {
       BX_DEBUG(("rx_frame promiscuous receive"));
@@ -1435,7 +1437,7 @@ static void NE2000_Poller(void) {
 
 		// don't receive in loopback modes
 		if((theNE2kDevice->s.DCR.loop == 0) || (theNE2kDevice->s.TCR.loop_cntl != 0))
-			return -1;
+			return 0;
 		return theNE2kDevice->rx_frame(packet, check_cast<uint16_t>(len));
 	});
 }
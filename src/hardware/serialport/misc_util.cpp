@@ -24,13 +24,38 @@
 
 #include "misc_util.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cinttypes>
+#include <cstring>
 
 #include "timer.h"
 
 // Constants
 constexpr int connection_timeout_ms = 5000;
 
+// The port wakes the I/O thread as soon as it has written data or made
+// room for more, so this is only a backstop
+constexpr int io_thread_wait_ms = 250;
+
+// Without a wakeup, the I/O thread has to poll for outgoing data; this
+// bounds the added latency of outgoing data
+constexpr int io_thread_poll_ms = 1;
+
+// ENet resends lost packets and keeps the connection alive only while
+// its host is being serviced
+constexpr int enet_service_interval_ms = 50;
+
+// Hands a connected socket over to its own I/O thread
+static NETClientSocket* run_on_io_thread(NETClientSocket* socket)
+{
+	if (!socket || !socket->isopen) {
+		return socket;
+	}
+	return new ThreadedClientSocket(socket);
+}
+
 const char* to_string(const SocketType socket_type)
 {
 	switch (socket_type) {
@@ -57,13 +82,47 @@ NETClientSocket* NETClientSocket::NETClientFactory(const SocketType socketType,
                                                    const uint16_t port)
 {
 	switch (socketType) {
-	case SocketType::Tcp: return new TCPClientSocket(destination, port);
-	case SocketType::Enet: return new ENETClientSocket(destination, port);
+	case SocketType::Tcp:
+		return run_on_io_thread(new TCPClientSocket(destination, port));
+	case SocketType::Enet:
+		return run_on_io_thread(new ENETClientSocket(destination, port));
 	default: return nullptr;
 	}
 	return nullptr;
 }
 
+void NETClientSocket::WaitForData(const int timeout_ms)
+{
+	Delay(timeout_ms);
+}
+
+void NETClientSocket::LogStats(const uint8_t port_number) const
+{
+	const auto stats = GetStats();
+	if (stats.connected_ms <= 0) {
+		return;
+	}
+	const auto seconds = static_cast<double>(stats.connected_ms) / 1000.0;
+
+	LOG_MSG("SERIAL: Port %" PRIu8 " received %" PRIu64 " bytes in %" PRIu64
+	        " reads (%.1f KB/s), sent %" PRIu64 " bytes in %" PRIu64
+	        " writes (%.1f KB/s) over %.1f seconds",
+	        port_number,
+	        stats.bytes_received,
+	        stats.num_reads,
+	        static_cast<double>(stats.bytes_received) / 1024.0 / seconds,
+	        stats.bytes_sent,
+	        stats.num_writes,
+	        static_cast<double>(stats.bytes_sent) / 1024.0 / seconds,
+	        seconds);
+
+	LOG_MSG("SERIAL: Port %" PRIu8 " received data waited %" PRId64
+	        " us on average, %" PRId64 " us at most",
+	        port_number,
+	        stats.avg_latency_us,
+	        stats.max_latency_us);
+}
+
 void NETClientSocket::FlushBuffer()
 {
 	if (sendbufferindex) {
@@ -223,7 +282,7 @@ NETClientSocket *ENETServerSocket::Accept()
 			         enet_address_to_string(event.peer->address),
 			         event.peer->address.port);
 			nowClient = true;
-			return new ENETClientSocket(host);
+			return run_on_io_thread(new ENETClientSocket(host));
 			break;
 
 		case ENET_EVENT_TYPE_RECEIVE:
@@ -323,6 +382,9 @@ ENETClientSocket::~ENETClientSocket()
 		client = nullptr;
 		isopen = false;
 	}
+	if (wakeup_socket != ENET_SOCKET_NULL) {
+		enet_socket_destroy(wakeup_socket);
+	}
 }
 
 SocketState ENETClientSocket::GetcharNonBlock(uint8_t &val)
@@ -427,7 +489,6 @@ bool ENETClientSocket::ReceiveArray(uint8_t *data, size_t &n)
 	while (isopen && x < n && !receiveBuffer.empty()) {
 		data[x++] = receiveBuffer.front();
 		receiveBuffer.pop();
-		updateState();
 	}
 
 	n = x;
@@ -444,36 +505,123 @@ bool ENETClientSocket::GetRemoteAddressString(char *buffer)
 	return true;
 }
 
-void ENETClientSocket::updateState()
+void ENETClientSocket::WaitForData(const int timeout_ms)
 {
-	if (!isopen || !client)
+	if (!isopen || !client || !receiveBuffer.empty())
 		return;
 
-	ENetEvent event;
-	while (enet_host_service(client, &event, 0) > 0) {
-		switch (event.type) {
+	if (wakeup_socket == ENET_SOCKET_NULL) {
+		ENetEvent event;
+		if (enet_host_service(client, &event, static_cast<uint32_t>(timeout_ms)) > 0)
+			handleEvent(event);
+		return;
+	}
+
+	ENetSocketSet read_set;
+	ENET_SOCKETSET_EMPTY(read_set);
+	ENET_SOCKETSET_ADD(read_set, client->socket);
+	ENET_SOCKETSET_ADD(read_set, wakeup_socket);
+
+	const auto max_socket = std::max(client->socket, wakeup_socket);
+	const auto wait_ms = std::min(timeout_ms, enet_service_interval_ms);
+	enet_socketset_select(max_socket, &read_set, nullptr,
+	                      static_cast<uint32_t>(wait_ms));
+
+	// Only clear the pending flag once the wakeups are drained, or a
+	// wakeup sent in between would be lost for good
+	uint8_t byte = 0;
+	ENetBuffer buffer = {};
+	buffer.data       = &byte;
+	buffer.dataLength = sizeof(byte);
+	while (enet_socket_receive(wakeup_socket, nullptr, &buffer, 1) > 0) {
+		// drain
+	}
+	is_wakeup_pending = false;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	updateState();
+}
+
+bool ENETClientSocket::EnableWakeup()
+{
+	assert(wakeup_socket == ENET_SOCKET_NULL);
+
+	wakeup_socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+	if (wakeup_socket == ENET_SOCKET_NULL) {
+		return false;
+	}
+
+	// Fall back to IPv4 for systems without IPv6 loopback
+	auto bind_to = [&](const in6_addr &host) {
+		wakeup_address      = {};
+		wakeup_address.host = host;
+		return enet_socket_bind(wakeup_socket, &wakeup_address) == 0;
+	};
+	const auto is_bound = bind_to(enet_v6_localhost) ||
+	                      (enet_socket_set_option(wakeup_socket,
+	                                              ENET_SOCKOPT_IPV6_V6ONLY,
+	                                              0) == 0 &&
+	                       bind_to(enet_v4_localhost));
+
+	if (!is_bound ||
+	    enet_socket_get_address(wakeup_socket, &wakeup_address) < 0 ||
+	    enet_socket_set_option(wakeup_socket, ENET_SOCKOPT_NONBLOCK, 1) < 0) {
+		LOG_WARNING("ENET: Unable to create wakeup socket, polling instead");
+		enet_socket_destroy(wakeup_socket);
+		wakeup_socket = ENET_SOCKET_NULL;
+		return false;
+	}
+	return true;
+}
+
+void ENETClientSocket::Wakeup()
+{
+	// One datagram in flight is enough to cut the wait short
+	if (wakeup_socket == ENET_SOCKET_NULL || is_wakeup_pending.exchange(true)) {
+		return;
+	}
+	uint8_t byte = 0;
+	ENetBuffer buffer = {};
+	buffer.data       = &byte;
+	buffer.dataLength = sizeof(byte);
+	enet_socket_send(wakeup_socket, &wakeup_address, &buffer, 1);
+}
+
+void ENETClientSocket::handleEvent(ENetEvent &event)
+{
+	switch (event.type) {
 #ifndef ENET_BLOCKING_CONNECT
-		case ENET_EVENT_TYPE_CONNECT:
-			connecting = false;
-			assert(event.peer);
-			LOG_INFO("ENET: Established connection to server %s:%u",
-			         enet_address_to_string(event.peer->address),
-			         event.peer->address.port);
-			break;
+	case ENET_EVENT_TYPE_CONNECT:
+		connecting = false;
+		assert(event.peer);
+		LOG_INFO("ENET: Established connection to server %s:%u",
+		         enet_address_to_string(event.peer->address),
+		         event.peer->address.port);
+		break;
 #endif
-		case ENET_EVENT_TYPE_RECEIVE:
-			assert(event.packet);
-			for (size_t x = 0; x < event.packet->dataLength; x++) {
-				receiveBuffer.push(event.packet->data[x]);
-			}
-			enet_packet_destroy(event.packet);
-			break;
+	case ENET_EVENT_TYPE_RECEIVE:
+		assert(event.packet);
+		for (size_t x = 0; x < event.packet->dataLength; x++) {
+			receiveBuffer.push(event.packet->data[x]);
+		}
+		enet_packet_destroy(event.packet);
+		break;
 
-		case ENET_EVENT_TYPE_DISCONNECT:
-		case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT: isopen = false; break;
+	case ENET_EVENT_TYPE_DISCONNECT:
+	case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT: isopen = false; break;
 
-		default: break;
-		}
+	default: break;
+	}
+}
+
+void ENETClientSocket::updateState()
+{
+	if (!isopen || !client)
+		return;
+
+	ENetEvent event;
+	while (enet_host_service(client, &event, 0) > 0) {
+		handleEvent(event);
 	}
 
 #ifndef ENET_BLOCKING_CONNECT
@@ -495,6 +643,242 @@ void ENETClientSocket::updateState()
 #endif
 }
 
+// --- THREADED NET INTERFACE ------------------------------------------------
+
+ThreadedClientSocket::ThreadedClientSocket(NETClientSocket *source)
+        : socket(source)
+{
+	assert(socket && socket->isopen);
+
+	// The address is only read once, as the socket belongs to the I/O
+	// thread from now on
+	char address_buf[INET_ADDRSTRLEN] = {};
+	has_remote_address = socket->GetRemoteAddressString(address_buf);
+	remote_address     = address_buf;
+
+	connect_ms = GetTicks();
+
+	has_wakeup = socket->EnableWakeup();
+
+	isopen         = true;
+	is_socket_open = true;
+	is_running     = true;
+	io_thread = std::thread(&ThreadedClientSocket::RunIoThread, this);
+}
+
+ThreadedClientSocket::~ThreadedClientSocket()
+{
+	is_running = false;
+	WakeIoThread();
+	if (io_thread.joinable()) {
+		io_thread.join();
+	}
+}
+
+void ThreadedClientSocket::RunIoThread()
+{
+	std::array<uint8_t, 4096> buffer = {};
+
+	// Whatever the port has written before closing the connection is
+	// still sent
+	while ((is_running || !tx_ring.IsEmpty()) && socket->isopen) {
+		bool is_busy = false;
+
+		// Send everything the port has written so far in one go
+		const auto num_to_send = tx_ring.Read(buffer.data(), buffer.size());
+		if (num_to_send > 0) {
+			// The port may be waiting for room
+			{
+				const std::lock_guard lock(wait_mutex);
+			}
+			tx_space_freed.notify_one();
+
+			if (!socket->SendArray(buffer.data(), num_to_send)) {
+				break;
+			}
+			bytes_sent += num_to_send;
+			++num_writes;
+			is_busy = true;
+		}
+
+		// Receive as much as the port has room for
+		const auto num_free = rx_ring.GetFreeSpace();
+		if (num_free > 0) {
+			auto num_received = std::min(num_free, buffer.size());
+			if (!socket->ReceiveArray(buffer.data(), num_received)) {
+				break;
+			}
+			if (num_received > 0) {
+				const auto end_pos = bytes_received + num_received;
+
+				rx_ring.Write(buffer.data(), num_received);
+
+				// Without a free mark, the batch is timed with
+				// the next one
+				if (const auto mark = rx_marks.GetWriteSlot(); mark) {
+					mark->end_pos    = end_pos;
+					mark->arrival_us = GetTicksUs();
+					rx_marks.Push();
+				}
+				bytes_received += num_received;
+				++num_reads;
+				is_busy = true;
+			}
+		}
+		if (is_busy) {
+			continue;
+		}
+		if (num_free > 0) {
+			socket->WaitForData(has_wakeup ? io_thread_wait_ms
+			                               : io_thread_poll_ms);
+		} else {
+			// The port isn't keeping up; leave the data in the
+			// socket until it has made room or written more
+			std::unique_lock lock(wait_mutex);
+			is_io_thread_stalled = true;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			io_thread_wakeup.wait_for(
+			        lock, std::chrono::milliseconds(io_thread_wait_ms), [this] {
+				        return rx_ring.GetFreeSpace() > 0 ||
+				               !tx_ring.IsEmpty() || !is_running;
+			        });
+			is_io_thread_stalled = false;
+		}
+	}
+	{
+		const std::lock_guard lock(wait_mutex);
+		is_socket_open = false;
+	}
+	tx_space_freed.notify_one();
+}
+
+void ThreadedClientSocket::WakeIoThread()
+{
+	socket->Wakeup();
+	ResumeIoThread();
+}
+
+void ThreadedClientSocket::ResumeIoThread()
+{
+	// Pairs with the fence in RunIoThread, so either the I/O thread sees
+	// what we did before it waits, or we see that it's waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (is_io_thread_stalled) {
+		{
+			const std::lock_guard lock(wait_mutex);
+		}
+		io_thread_wakeup.notify_one();
+	}
+}
+
+bool ThreadedClientSocket::UpdateOpenState()
+{
+	// Data that has arrived before the connection was closed is still
+	// handed out
+	if (!is_socket_open && rx_ring.IsEmpty()) {
+		isopen = false;
+	}
+	return isopen;
+}
+
+void ThreadedClientSocket::CountReceived(const size_t num_bytes)
+{
+	bytes_taken += num_bytes;
+
+	while (const auto mark = rx_marks.Front()) {
+		if (mark->end_pos > bytes_taken) {
+			break;
+		}
+		const auto latency_us = GetTicksUsSince(mark->arrival_us);
+
+		total_latency_us += latency_us;
+		max_latency_us = std::max(max_latency_us, latency_us);
+		++num_marks_taken;
+
+		rx_marks.Pop();
+	}
+}
+
+SocketState ThreadedClientSocket::GetcharNonBlock(uint8_t &val)
+{
+	if (rx_ring.Read(&val, 1) == 1) {
+		CountReceived(1);
+		ResumeIoThread();
+		return SocketState::Good;
+	}
+	return UpdateOpenState() ? SocketState::Empty : SocketState::Closed;
+}
+
+bool ThreadedClientSocket::Putchar(uint8_t val)
+{
+	return SendArray(&val, 1);
+}
+
+bool ThreadedClientSocket::SendArray(const uint8_t *data, size_t n)
+{
+	assert(data);
+
+	size_t num_written = 0;
+	while (is_socket_open) {
+		num_written += tx_ring.Write(data + num_written, n - num_written);
+		WakeIoThread();
+		if (num_written == n) {
+			return true;
+		}
+		// Only waits if the network can't keep up with the port, like
+		// a blocking send would
+		std::unique_lock lock(wait_mutex);
+		tx_space_freed.wait_for(lock,
+		                        std::chrono::milliseconds(io_thread_wait_ms),
+		                        [this] {
+			                        return tx_ring.GetFreeSpace() > 0 ||
+			                               !is_socket_open;
+		                        });
+	}
+	isopen = false;
+	return false;
+}
+
+bool ThreadedClientSocket::ReceiveArray(uint8_t *data, size_t &n)
+{
+	assert(data);
+
+	n = rx_ring.Read(data, n);
+	if (n > 0) {
+		CountReceived(n);
+		ResumeIoThread();
+		return true;
+	}
+	return UpdateOpenState();
+}
+
+bool ThreadedClientSocket::GetRemoteAddressString(char *buffer)
+{
+	assert(buffer);
+	if (has_remote_address) {
+		strcpy(buffer, remote_address.c_str());
+	}
+	return has_remote_address;
+}
+
+SocketStats ThreadedClientSocket::GetStats() const
+{
+	SocketStats stats = {};
+
+	stats.connected_ms   = GetTicksSince(connect_ms);
+	stats.bytes_received = bytes_received;
+	stats.num_reads      = num_reads;
+	stats.bytes_sent     = bytes_sent;
+	stats.num_writes     = num_writes;
+
+	stats.avg_latency_us = num_marks_taken
+	                             ? total_latency_us /
+	                                       static_cast<int64_t>(num_marks_taken)
+	                             : 0;
+	stats.max_latency_us = max_latency_us;
+	return stats;
+}
+
 // --- TCP NET INTERFACE -----------------------------------------------------
 
 class sdl_net_manager_t {
@@ -626,6 +1010,13 @@ TCPClientSocket::~TCPClientSocket()
 	}
 
 	if(listensocketset) SDLNet_FreeSocketSet(listensocketset);
+
+	if (wait_socket_set)
+		SDLNet_FreeSocketSet(wait_socket_set);
+	SDLNet_FreePacket(wakeup_send_packet);
+	SDLNet_FreePacket(wakeup_recv_packet);
+	if (wakeup_socket)
+		SDLNet_UDP_Close(wakeup_socket);
 }
 
 bool TCPClientSocket::GetRemoteAddressString(char *buffer)
@@ -642,6 +1033,66 @@ bool TCPClientSocket::GetRemoteAddressString(char *buffer)
 	return true;
 }
 
+void TCPClientSocket::WaitForData(const int timeout_ms)
+{
+	if (!wakeup_socket) {
+		SDLNet_CheckSockets(listensocketset, static_cast<uint32_t>(timeout_ms));
+		return;
+	}
+	SDLNet_CheckSockets(wait_socket_set, static_cast<uint32_t>(timeout_ms));
+
+	// Only clear the pending flag once the wakeups are drained, or a
+	// wakeup sent in between would be lost for good
+	while (SDLNet_UDP_Recv(wakeup_socket, wakeup_recv_packet) > 0) {
+		// drain
+	}
+	is_wakeup_pending = false;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+bool TCPClientSocket::EnableWakeup()
+{
+	assert(!wakeup_socket);
+
+	// Port 0 picks a free port; the wakeup goes to that port on loopback
+	wakeup_socket = SDLNet_UDP_Open(0);
+	const auto bound_address = wakeup_socket
+	                                 ? SDLNet_UDP_GetPeerAddress(wakeup_socket, -1)
+	                                 : nullptr;
+
+	wakeup_send_packet = SDLNet_AllocPacket(1);
+	wakeup_recv_packet = SDLNet_AllocPacket(1);
+	wait_socket_set    = SDLNet_AllocSocketSet(2);
+
+	if (!bound_address || !wakeup_send_packet || !wakeup_recv_packet ||
+	    !wait_socket_set ||
+	    SDLNet_ResolveHost(&wakeup_send_packet->address, "127.0.0.1", 0) != 0) {
+		LOG_WARNING("SDLNET: Unable to create wakeup socket, polling instead: %s",
+		            SDLNet_GetError());
+		if (wakeup_socket) {
+			SDLNet_UDP_Close(wakeup_socket);
+			wakeup_socket = nullptr;
+		}
+		return false;
+	}
+	// Both ports are in network byte order
+	wakeup_send_packet->address.port = bound_address->port;
+	wakeup_send_packet->len          = 1;
+
+	SDLNet_TCP_AddSocket(wait_socket_set, mysock);
+	SDLNet_UDP_AddSocket(wait_socket_set, wakeup_socket);
+	return true;
+}
+
+void TCPClientSocket::Wakeup()
+{
+	// One datagram in flight is enough to cut the wait short
+	if (!wakeup_socket || is_wakeup_pending.exchange(true)) {
+		return;
+	}
+	SDLNet_UDP_Send(wakeup_socket, -1, wakeup_send_packet);
+}
+
 bool TCPClientSocket::ReceiveArray(uint8_t *data, size_t &n)
 {
 	assertm(n <= static_cast<size_t>(std::numeric_limits<int>::max()),
@@ -734,7 +1185,7 @@ NETClientSocket *TCPServerSocket::Accept()
 		return nullptr;
 	}
 	
-	return new TCPClientSocket(new_tcpsock);
+	return run_on_io_thread(new TCPClientSocket(new_tcpsock));
 }
 
 #endif // C_MODEM
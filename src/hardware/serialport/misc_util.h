@@ -23,8 +23,15 @@
 
 #if C_MODEM
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "spsc_queue.h"
 #include "support.h"
 
 #if defined WIN32
@@ -77,6 +84,19 @@ enum class SocketState {
 	Closed // didn't have data and socket is closed
 };
 
+struct SocketStats {
+	int64_t connected_ms = 0;
+
+	uint64_t bytes_received = 0;
+	uint64_t num_reads      = 0;
+	uint64_t bytes_sent     = 0;
+	uint64_t num_writes     = 0;
+
+	// Time between data arriving from the network and the port taking it
+	int64_t avg_latency_us = 0;
+	int64_t max_latency_us = 0;
+};
+
 // --- GENERIC NET INTERFACE -------------------------------------------------
 
 class NETClientSocket {
@@ -97,6 +117,27 @@ public:
 	virtual bool ReceiveArray(uint8_t *data, size_t &n) = 0;
 	virtual bool GetRemoteAddressString(char *buffer) = 0;
 
+	// Waits up to the given time for incoming data, or until another
+	// thread calls Wakeup()
+	virtual void WaitForData(const int timeout_ms);
+
+	// Sets up the wakeup; returns false if WaitForData() can't be cut
+	// short, in which case the caller has to poll
+	virtual bool EnableWakeup()
+	{
+		return false;
+	}
+
+	// The only call that is safe to make from another thread while
+	// WaitForData() runs
+	virtual void Wakeup() {}
+
+	virtual SocketStats GetStats() const
+	{
+		return {};
+	}
+	void LogStats(const uint8_t port_number) const;
+
 	void FlushBuffer();
 	void SetSendBufferSize(size_t n);
 	bool SendByteBuffered(uint8_t val);
@@ -156,9 +197,13 @@ public:
 	bool SendArray(const uint8_t *data, size_t n) override;
 	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
+	void WaitForData(const int timeout_ms) override;
+	bool EnableWakeup() override;
+	void Wakeup() override;
 
 private:
 	void updateState();
+	void handleEvent(ENetEvent& event);
 
 #ifndef ENET_BLOCKING_CONNECT
 	int64_t              connectStart  = 0;
@@ -168,6 +213,86 @@ private:
 	ENetPeer            *peer          = nullptr;
 	ENetAddress          address       = {};
 	std::queue<uint8_t>  receiveBuffer = {};
+
+	// Loopback datagram socket that Wakeup() sends to, so WaitForData()
+	// can wait on it together with the host's socket
+	ENetSocket        wakeup_socket     = ENET_SOCKET_NULL;
+	ENetAddress       wakeup_address    = {};
+	std::atomic<bool> is_wakeup_pending = false;
+};
+
+// --- THREADED NET INTERFACE ------------------------------------------------
+
+// Runs a connected TCP or ENet client socket on its own I/O thread. The
+// thread moves data between the network and a pair of lock-free byte rings
+// in batches, so the serial port emulation only ever copies from and to
+// memory instead of polling the socket for every byte.
+class ThreadedClientSocket final : public NETClientSocket {
+public:
+	// Takes ownership of the socket
+	ThreadedClientSocket(NETClientSocket *socket);
+	ThreadedClientSocket(const ThreadedClientSocket &) = delete; // prevent copying
+	ThreadedClientSocket &operator=(const ThreadedClientSocket &) = delete; // prevent assignment
+
+	~ThreadedClientSocket() override;
+
+	SocketState GetcharNonBlock(uint8_t &val) override;
+	bool Putchar(uint8_t val) override;
+	bool SendArray(const uint8_t *data, size_t n) override;
+	bool ReceiveArray(uint8_t *data, size_t &n) override;
+	bool GetRemoteAddressString(char *buffer) override;
+	SocketStats GetStats() const override;
+
+private:
+	void RunIoThread();
+	void WakeIoThread();
+	void ResumeIoThread();
+	bool UpdateOpenState();
+	void CountReceived(const size_t num_bytes);
+
+	std::unique_ptr<NETClientSocket> socket = {};
+
+	std::thread io_thread                = {};
+	std::atomic<bool> is_running         = false;
+	std::atomic<bool> is_socket_open     = false;
+
+	// Without a wakeup, the I/O thread has to poll for outgoing data
+	bool has_wakeup = false;
+
+	// Lets the port and the I/O thread wait for each other when a ring
+	// is full, instead of spinning
+	std::mutex wait_mutex                    = {};
+	std::condition_variable tx_space_freed   = {};
+	std::condition_variable io_thread_wakeup = {};
+	std::atomic<bool> is_io_thread_stalled   = false;
+
+	SpscRingBuffer<uint8_t, 64 * 1024> rx_ring = {};
+	SpscRingBuffer<uint8_t, 16 * 1024> tx_ring = {};
+
+	// Marks the end of each batch in the receive ring with its arrival
+	// time, so we know how long the data waited for the port
+	struct ReceiveMark {
+		uint64_t end_pos   = 0;
+		int64_t arrival_us = 0;
+	};
+	SpscQueue<ReceiveMark, 256> rx_marks = {};
+
+	// Set on the I/O thread
+	std::atomic<uint64_t> bytes_received = 0;
+	std::atomic<uint64_t> num_reads      = 0;
+	std::atomic<uint64_t> bytes_sent     = 0;
+	std::atomic<uint64_t> num_writes     = 0;
+
+	// Only touched on the emulation thread
+	uint64_t bytes_taken     = 0;
+	uint64_t num_marks_taken = 0;
+	int64_t total_latency_us = 0;
+	int64_t max_latency_us   = 0;
+
+	int64_t connect_ms = 0;
+
+	std::string remote_address = {};
+	bool has_remote_address    = false;
 };
 
 // --- TCP NET INTERFACE -----------------------------------------------------
@@ -199,6 +324,9 @@ public:
 	bool SendArray(const uint8_t *data, size_t n) override;
 	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
+	void WaitForData(const int timeout_ms) override;
+	bool EnableWakeup() override;
+	void Wakeup() override;
 
 private:
 
@@ -208,6 +336,14 @@ private:
 
 	TCPsocket mysock = nullptr;
 	SDLNet_SocketSet listensocketset = nullptr;
+
+	// Loopback datagram socket that Wakeup() sends to, so WaitForData()
+	// can wait on it together with the connection
+	UDPsocket wakeup_socket = nullptr;
+	SDLNet_SocketSet wait_socket_set = nullptr;
+	UDPpacket *wakeup_send_packet = nullptr;
+	UDPpacket *wakeup_recv_packet = nullptr;
+	std::atomic<bool> is_wakeup_pending = false;
 };
 
 class TCPServerSocket : public NETServerSocket {
@@ -155,6 +155,8 @@ CNullModem::CNullModem(const uint8_t port_idx, CommandLine *cmd)
 
 CNullModem::~CNullModem() {
 	delete serversocket;
+	if (clientsocket)
+		clientsocket->LogStats(GetPortNumber());
 	delete clientsocket;
 	// remove events
 	for (uint16_t i = SERIAL_BASE_EVENT_COUNT + 1;
@@ -174,9 +176,25 @@ void CNullModem::WriteChar(uint8_t data)
 	}
 }
 
+SocketState CNullModem::readBufferedChar(uint8_t &val)
+{
+	if (rx_buffer_pos == rx_buffer_used) {
+		size_t num_received = rx_buffer.size();
+		if (!clientsocket->ReceiveArray(rx_buffer.data(), num_received))
+			return SocketState::Closed;
+
+		rx_buffer_pos  = 0;
+		rx_buffer_used = num_received;
+		if (!num_received)
+			return SocketState::Empty;
+	}
+	val = rx_buffer[rx_buffer_pos++];
+	return SocketState::Good;
+}
+
 SocketState CNullModem::readChar(uint8_t &val)
 {
-	SocketState state = clientsocket->GetcharNonBlock(val);
+	SocketState state = readBufferedChar(val);
 	if (state != SocketState::Good)
 		return state;
 
@@ -185,7 +203,7 @@ SocketState CNullModem::readChar(uint8_t &val)
 
 	if (val == 0xff && !transparent) { // escape char
 		// get the next character
-		state = clientsocket->GetcharNonBlock(val);
+		state = readBufferedChar(val);
 		if (state != SocketState::Good || val == 0xff) // 0xff 0xff -> 0xff was meant
 			return state;
 
@@ -267,8 +285,10 @@ void CNullModem::Disconnect() {
 	removeEvent(SERIAL_RX_EVENT);
 	// it was disconnected; free the socket and restart the server socket
 	LOG_MSG("SERIAL: Port %" PRIu8 " disconnected.", GetPortNumber());
+	clientsocket->LogStats(GetPortNumber());
 	delete clientsocket;
 	clientsocket=nullptr;
+	rx_buffer_pos = rx_buffer_used = 0;
 	setDSR(false);
 	setCTS(false);
 	setCD(false);
@@ -25,6 +25,8 @@
 
 #if C_MODEM
 
+#include <array>
+
 #include "misc_util.h"
 #include "serialport.h"
 
@@ -75,6 +77,7 @@ private:
 	bool ServerConnect();
     void Disconnect();
     SocketState readChar(uint8_t &val);
+	SocketState readBufferedChar(uint8_t &val);
     void WriteChar(uint8_t data);
 
 	bool DTR_delta = false; // with dtrrespect, we try to establish a
@@ -100,6 +103,12 @@ private:
 
 	bool telnet = false; // Do Telnet parsing.
 
+	// Received data is fetched from the socket in batches and handed to
+	// the port byte by byte from here
+	std::array<uint8_t, 256> rx_buffer = {};
+	size_t rx_buffer_pos  = 0;
+	size_t rx_buffer_used = 0;
+
     // Telnet's brain
 #define TEL_CLIENT 0
 #define TEL_SERVER 1
@@ -448,6 +448,41 @@ void CSerial::receiveByte(uint8_t data)
 	receiveByteEx(data, 0);
 }
 
+size_t CSerial::receiveBytes(const uint8_t *data, const size_t n)
+{
+	assert(data && n > 0);
+
+	const auto usage = rxfifo->getUsage();
+	const size_t batch_size = (FCR & FCR_ACTIVATE) && usage < rx_interrupt_threshold
+	                                ? rx_interrupt_threshold - usage
+	                                : 1;
+	const auto num_bytes = std::min({n, batch_size, rxfifo->getFree()});
+
+	// Single bytes and overruns take the regular path
+	if (num_bytes <= 1) {
+		receiveByteEx(data[0], 0);
+		return 1;
+	}
+#if SERIAL_DEBUG
+	log_ser(dbg_serialtraffic, "\t\t\t\trx %u bytes",
+	        static_cast<unsigned>(num_bytes));
+#endif
+	for (size_t i = 0; i < num_bytes; ++i) {
+		rxfifo->addb(data[i]);
+		errorfifo->addb(0);
+	}
+
+	// The batch never passes the threshold, so this ends up the same as
+	// receiving the bytes one by one
+	removeEvent(SERIAL_RX_TIMEOUT_EVENT);
+	if (rxfifo->getUsage() == rx_interrupt_threshold)
+		rise(RX_PRIORITY);
+	else
+		setEvent(SERIAL_RX_TIMEOUT_EVENT, bytetime * 4.0f);
+
+	return num_bytes;
+}
+
 /*****************************************************************************/
 /* ByteTransmitting: Byte has made it from THR to TX.                       **/
 /*****************************************************************************/
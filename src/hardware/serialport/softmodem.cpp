@@ -20,6 +20,8 @@
 
 #if C_MODEM
 
+#include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
@@ -178,14 +180,17 @@ void CSerialModem::handleUpperEvent(uint16_t type)
 	switch (type) {
 	case SERIAL_RX_EVENT: {
 		// check for bytes to be sent to port
+		size_t num_sent = 1;
 		if (CSerial::CanReceiveByte())
 			if (rqueue->inuse() && (CSerial::getRTS() || (flowcontrol != 3))) {
-				uint8_t rbyte = rqueue->getb();
-				// LOG_MSG("SERIAL: Port %" PRIu8 " modem sending byte %2x"
-				//         " back to UART3", GetPortNumber(), rbyte);
-				CSerial::receiveByte(rbyte);
+				std::array<uint8_t, SERIAL_MAX_FIFO_SIZE> rbytes;
+				const auto num_bytes = rqueue->peeks(rbytes.data(),
+				                                     rbytes.size());
+				num_sent = CSerial::receiveBytes(rbytes.data(), num_bytes);
+				rqueue->skip(num_sent);
 			}
-		if(CSerial::CanReceiveByte()) setEvent(SERIAL_RX_EVENT, bytetime*0.98f);
+		// A batch of bytes takes as long as sending them one by one
+		if(CSerial::CanReceiveByte()) setEvent(SERIAL_RX_EVENT, bytetime*0.98f*num_sent);
 		break;
 	}
 	case MODEM_TX_EVENT: {
@@ -401,6 +406,8 @@ void CSerialModem::EnterIdleState(){
 	ringing = false;
 	dtrofftimer = -1;
 	warmup_remain_ticks = 0;
+	if (clientsocket)
+		clientsocket->LogStats(GetPortNumber());
 	clientsocket.reset(nullptr);
 	waitingclientsocket.reset(nullptr);
 
@@ -884,11 +891,17 @@ void CSerialModem::TelnetEmulation(uint8_t *data, uint32_t size)
 			}
 		}
 		} else {
-			if (c == 0xff) {
+			// Pass everything up to the next command on in one go
+			const auto run_start = data + i;
+			const auto run_end = static_cast<uint8_t *>(
+			        memchr(run_start, 0xff, size - i));
+			const auto run_size = run_end ? static_cast<uint32_t>(
+			                                        run_end - run_start)
+			                              : size - i;
+			rqueue->adds(run_start, run_size);
+			i += run_size;
+			if (run_end)
 				telClient.inIAC = true;
-				continue;
-			}
-			rqueue->addb(c);
 		}
 	}
 }
@@ -989,7 +1002,9 @@ void CSerialModem::Timer2()
 	}
 	// Handle incoming to the serial port
 	if (!commandmode && clientsocket && rqueue->left()) {
-		size_t usesize = rqueue->left() >= 16 ? 16 : rqueue->left();
+		// The socket hands out whatever it has buffered in one go
+		size_t usesize = std::min(static_cast<size_t>(rqueue->left()),
+		                          sizeof(tmpbuf));
 		// size_t usesize = 1;
 		if (!clientsocket->ReceiveArray(tmpbuf, usesize)) {
 			SendRes(ResNOCARRIER);
@@ -23,6 +23,7 @@
 
 #if C_MODEM
 
+#include <algorithm>
 #include <vector>
 #include <memory>
 
@@ -158,6 +159,28 @@ public:
 		}
 	}
 
+	// Copies up to len bytes from the front without removing them
+	size_t peeks(uint8_t *str, size_t len) const
+	{
+		len = std::min(len, used);
+		size_t where = pos;
+		for (size_t i = 0; i < len; ++i) {
+			str[i] = data[where];
+			if (++where >= size)
+				where -= size;
+		}
+		return len;
+	}
+
+	void skip(size_t len)
+	{
+		assert(len <= used);
+		used -= len;
+		pos += len;
+		if (pos >= size)
+			pos -= size;
+	}
+
 private:
 	std::vector<uint8_t> data;
 	size_t size = 0;
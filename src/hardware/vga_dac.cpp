@@ -312,6 +312,20 @@ static void write_p3c9(io_port_t, io_val_t value, io_width_t)
 	};
 }
 
+// Palettes are commonly uploaded with a single REP OUTSB of all the colour
+// components, so the whole block is fed to the DAC in one go
+static size_t write_block_p3c9(io_port_t port, io_width_t width,
+                               const uint8_t* values, size_t num_values)
+{
+	if (width != io_width_t::byte) {
+		return 0;
+	}
+	for (size_t i = 0; i < num_values; ++i) {
+		write_p3c9(port, values[i], width);
+	}
+	return num_values;
+}
+
 static uint8_t read_p3c9(io_port_t, io_width_t)
 {
 	switch (vga.dac.pel_index) {
@@ -341,6 +355,18 @@ static uint8_t read_p3c9(io_port_t, io_width_t)
 	}
 }
 
+static size_t read_block_p3c9(io_port_t port, io_width_t width, uint8_t* values,
+                              size_t num_values)
+{
+	if (width != io_width_t::byte) {
+		return 0;
+	}
+	for (size_t i = 0; i < num_values; ++i) {
+		values[i] = read_p3c9(port, width);
+	}
+	return num_values;
+}
+
 void VGA_DAC_CombineColor(const uint8_t palette_idx, const uint8_t color_idx)
 {
 	vga.dac.combine[palette_idx] = color_idx;
@@ -398,5 +424,7 @@ void VGA_SetupDAC(void)
 
 		IO_RegisterWriteHandler(0x3c9, write_p3c9, io_width_t::byte);
 		IO_RegisterReadHandler(0x3c9, read_p3c9, io_width_t::byte);
+		IO_RegisterBlockWriteHandler(0x3c9, write_block_p3c9);
+		IO_RegisterBlockReadHandler(0x3c9, read_block_p3c9);
 	}
 }
@@ -83,7 +83,9 @@
 #include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <mutex>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
@@ -107,6 +109,7 @@
 #include "setup.h"
 #include "support.h"
 #include "vga.h"
+#include "voodoo_texel.h"
 
 #ifndef DOSBOX_VOODOO_TYPES_H
 #define DOSBOX_VOODOO_TYPES_H
@@ -199,36 +202,6 @@ inline int32_t mul_32x32_shift(int32_t a, int32_t b, int8_t shift)
 	return (int32_t)(((int64_t)a * (int64_t)b) >> shift);
 }
 
-#if defined(__SSE2__)
-static int16_t sse2_scale_table[256][8];
-#endif
-
-inline rgb_t rgba_bilinear_filter(rgb_t rgb00, rgb_t rgb01, rgb_t rgb10,
-                                  rgb_t rgb11, uint8_t u, uint8_t v)
-{
-#if defined(__SSE2__)
-	const __m128i scale_u = *(__m128i*)sse2_scale_table[u];
-	const __m128i scale_v = *(__m128i*)sse2_scale_table[v];
-	return _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(_mm_srli_epi32(_mm_madd_epi16(_mm_max_epi16(
-		_mm_slli_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(rgb01), _mm_cvtsi32_si128(rgb00)), _mm_setzero_si128()), scale_u), 15),
-		_mm_srli_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(rgb11), _mm_cvtsi32_si128(rgb10)), _mm_setzero_si128()), scale_u), 1)),
-		scale_v), 15), _mm_setzero_si128()), _mm_setzero_si128()));
-#else
-	uint32_t ag0, ag1, rb0, rb1;
-	rb0 = (rgb00 & 0x00ff00ff) + ((((rgb01 & 0x00ff00ff) - (rgb00 & 0x00ff00ff)) * u) >> 8);
-	rb1 = (rgb10 & 0x00ff00ff) + ((((rgb11 & 0x00ff00ff) - (rgb10 & 0x00ff00ff)) * u) >> 8);
-	rgb00 >>= 8;
-	rgb01 >>= 8;
-	rgb10 >>= 8;
-	rgb11 >>= 8;
-	ag0 = (rgb00 & 0x00ff00ff) + ((((rgb01 & 0x00ff00ff) - (rgb00 & 0x00ff00ff)) * u) >> 8);
-	ag1 = (rgb10 & 0x00ff00ff) + ((((rgb11 & 0x00ff00ff) - (rgb10 & 0x00ff00ff)) * u) >> 8);
-	rb0 = (rb0 & 0x00ff00ff) + ((((rb1 & 0x00ff00ff) - (rb0 & 0x00ff00ff)) * v) >> 8);
-	ag0 = (ag0 & 0x00ff00ff) + ((((ag1 & 0x00ff00ff) - (ag0 & 0x00ff00ff)) * v) >> 8);
-	return ((ag0 << 8) & 0xff00ff00) | (rb0 & 0x00ff00ff);
-#endif
-}
-
 struct poly_vertex
 {
 	float		x;							/* X coordinate */
@@ -889,10 +862,46 @@ struct draw_state {
 	bool screen_update_pending   = false;
 };
 
+struct voodoo_state;
+
+typedef void (*rasterizer_func)(const voodoo_state* vs, uint32_t texmode0,
+                                uint32_t texmode1, void* destbase, int32_t y,
+                                const poly_extent* extent, stats_block& stats);
+
+/* normalized pipeline state used to pick a rasterizer */
+struct raster_key {
+	uint32_t tmus       = 0;
+	uint32_t color_path = 0; /* effective fbzColorPath value */
+	uint32_t alpha_mode = 0; /* effective alphaMode value */
+	uint32_t fog_mode   = 0; /* effective fogMode value */
+	uint32_t fbz_mode   = 0; /* effective fbzMode value */
+	uint32_t tex_mode_0 = 0; /* effective textureMode value for TMU #0 */
+	uint32_t tex_mode_1 = 0; /* effective textureMode value for TMU #1 */
+
+	constexpr bool operator==(const raster_key&) const = default;
+	constexpr auto operator<=>(const raster_key&) const = default;
+};
+
+struct raster_profile {
+	uint64_t triangles = 0;
+	bool specialized   = false;
+};
+
+struct raster_selection {
+	raster_key key            = {};
+	rasterizer_func callback  = nullptr;
+	raster_profile* profile   = nullptr;
+
+	/* triangle counts per pipeline state, collected when LOG_RASTERIZERS is set */
+	std::map<raster_key, raster_profile> profiles = {};
+};
+
 struct triangle_worker
 {
 	std::atomic_bool threads_active;
 	bool use_threads, disable_bilinear_filter;
+	rasterizer_func rasterizer;
+	uint32_t texmode0, texmode1;
 	uint16_t *drawbuf;
 	poly_vertex v1, v2, v3;
 	int32_t v1y, v3y, totalpix;
@@ -943,6 +952,8 @@ struct voodoo_state
 
 	draw_state draw         = {};
 	triangle_worker tworker = {};
+
+	raster_selection raster = {};
 };
 
 #ifdef C_ENABLE_VOODOO_OPENGL
@@ -1172,14 +1183,13 @@ inline int64_t float_to_int64(uint32_t data, int fixedbits)
 
 
 
-#ifdef C_ENABLE_VOODOO_OPENGL
 /*************************************
  *
  *  Rasterizer inlines
  *
  *************************************/
 
-inline uint32_t normalize_color_path(uint32_t eff_color_path)
+constexpr uint32_t normalize_color_path(uint32_t eff_color_path)
 {
 	/* ignore the subpixel adjust and texture enable flags */
 	eff_color_path &= ~((1 << 26) | (1 << 27));
@@ -1187,7 +1197,7 @@ inline uint32_t normalize_color_path(uint32_t eff_color_path)
 	return eff_color_path;
 }
 
-inline uint32_t normalize_alpha_mode(uint32_t eff_alpha_mode)
+constexpr uint32_t normalize_alpha_mode(uint32_t eff_alpha_mode)
 {
 	/* always ignore alpha ref value */
 	eff_alpha_mode &= ~(0xff << 24);
@@ -1203,7 +1213,7 @@ inline uint32_t normalize_alpha_mode(uint32_t eff_alpha_mode)
 	return eff_alpha_mode;
 }
 
-inline uint32_t normalize_fog_mode(uint32_t eff_fog_mode)
+constexpr uint32_t normalize_fog_mode(uint32_t eff_fog_mode)
 {
 	/* if not doing fogging, ignore all the other fog bits */
 	if (!FOGMODE_ENABLE_FOG(eff_fog_mode))
@@ -1212,7 +1222,7 @@ inline uint32_t normalize_fog_mode(uint32_t eff_fog_mode)
 	return eff_fog_mode;
 }
 
-inline uint32_t normalize_fbz_mode(uint32_t eff_fbz_mode)
+constexpr uint32_t normalize_fbz_mode(uint32_t eff_fbz_mode)
 {
 	/* ignore the draw buffer */
 	eff_fbz_mode &= ~(3 << 14);
@@ -1220,7 +1230,7 @@ inline uint32_t normalize_fbz_mode(uint32_t eff_fbz_mode)
 	return eff_fbz_mode;
 }
 
-inline uint32_t normalize_tex_mode(uint32_t eff_tex_mode)
+constexpr uint32_t normalize_tex_mode(uint32_t eff_tex_mode)
 {
 	/* ignore the NCC table and seq_8_downld flags */
 	eff_tex_mode &= ~((1 << 5) | (1 << 31));
@@ -1236,6 +1246,7 @@ inline uint32_t normalize_tex_mode(uint32_t eff_tex_mode)
 	return eff_tex_mode;
 }
 
+#ifdef C_ENABLE_VOODOO_OPENGL
 inline uint32_t compute_raster_hash(const raster_info* info)
 {
 	uint32_t hash;
@@ -1901,6 +1912,66 @@ while (0)
 
 
 
+/*************************************
+ *
+ *  Bilinear texel fetch
+ *
+ *************************************/
+
+/* fetches the four texels at (s,t), (s1,t), (s,t1) and (s1,t1) and filters
+   them; the 16-bit RGB/ARGB formats are decoded with SIMD when available
+   instead of going through the 64K-entry lookup tables. The format must come
+   from the TMU's textureMode register, as the rasterizer's texture mode only
+   records the format's category (see normalize_tex_mode) */
+GCC_ATTRIBUTE(always_inline)
+static inline rgb_t fetch_bilinear_texels(const tmu_state* tt, const uint8_t format,
+                                          const rgb_t* lookup, const uint32_t texbase,
+                                          const int32_t s, const int32_t s1,
+                                          const int32_t t, const int32_t t1,
+                                          const uint8_t sfrac, const uint8_t tfrac)
+{
+	uint32_t texel0, texel1, texel2, texel3;
+
+	if (format < 8)
+	{
+		texel0 = lookup[tt->ram[(texbase + t + s) & tt->mask]];
+		texel1 = lookup[tt->ram[(texbase + t + s1) & tt->mask]];
+		texel2 = lookup[tt->ram[(texbase + t1 + s) & tt->mask]];
+		texel3 = lookup[tt->ram[(texbase + t1 + s1) & tt->mask]];
+		return rgba_bilinear_filter(texel0, texel1, texel2, texel3, sfrac, tfrac);
+	}
+
+	texel0 = *(uint16_t *)&tt->ram[(texbase + 2*(t + s)) & tt->mask];
+	texel1 = *(uint16_t *)&tt->ram[(texbase + 2*(t + s1)) & tt->mask];
+	texel2 = *(uint16_t *)&tt->ram[(texbase + 2*(t1 + s)) & tt->mask];
+	texel3 = *(uint16_t *)&tt->ram[(texbase + 2*(t1 + s1)) & tt->mask];
+
+	if (format >= TexelRgb565 && format <= TexelArgb4444)
+	{
+#if defined(__SSE2__)
+		const auto texels = _mm_setr_epi32(static_cast<int>(texel0),
+		                                   static_cast<int>(texel1),
+		                                   static_cast<int>(texel2),
+		                                   static_cast<int>(texel3));
+		return rgba_bilinear_filter_x4(decode_texel16_x4(format, texels),
+		                               sfrac, tfrac);
+#else
+		texel0 = lookup[texel0];
+		texel1 = lookup[texel1];
+		texel2 = lookup[texel2];
+		texel3 = lookup[texel3];
+#endif
+	}
+	else
+	{
+		texel0 = (lookup[texel0 & 0xff] & 0xffffff) | ((texel0 & 0xff00) << 16);
+		texel1 = (lookup[texel1 & 0xff] & 0xffffff) | ((texel1 & 0xff00) << 16);
+		texel2 = (lookup[texel2 & 0xff] & 0xffffff) | ((texel2 & 0xff00) << 16);
+		texel3 = (lookup[texel3 & 0xff] & 0xffffff) | ((texel3 & 0xff00) << 16);
+	}
+	return rgba_bilinear_filter(texel0, texel1, texel2, texel3, sfrac, tfrac);
+}
+
 /*************************************
  *
  *  Texture pipeline macro
@@ -2000,7 +2071,6 @@ do																				\
 	{																			\
 		/* bilinear filtered */													\
 																				\
-		uint32_t texel0, texel1, texel2, texel3;									\
 		uint8_t sfrac, tfrac;														\
 		int32_t s1, t1;															\
 																				\
@@ -2041,46 +2111,11 @@ do																				\
 		t *= smax + 1;															\
 		t1 *= smax + 1;															\
 																				\
-		/* fetch texel data */													\
-		if (TEXMODE_FORMAT(TEXMODE) < 8)										\
-		{																		\
-			texel0 = (TT)->ram[(texbase + t + s) & (TT)->mask];					\
-			texel1 = (TT)->ram[(texbase + t + s1) & (TT)->mask];				\
-			texel2 = (TT)->ram[(texbase + t1 + s) & (TT)->mask];				\
-			texel3 = (TT)->ram[(texbase + t1 + s1) & (TT)->mask];				\
-			texel0 = (LOOKUP)[texel0];											\
-			texel1 = (LOOKUP)[texel1];											\
-			texel2 = (LOOKUP)[texel2];											\
-			texel3 = (LOOKUP)[texel3];											\
-		}																		\
-		else																	\
-		{																		\
-			texel0 = *(uint16_t *)&(TT)->ram[(texbase + 2*(t + s)) & (TT)->mask];	\
-			texel1 = *(uint16_t *)&(TT)->ram[(texbase + 2*(t + s1)) & (TT)->mask];\
-			texel2 = *(uint16_t *)&(TT)->ram[(texbase + 2*(t1 + s)) & (TT)->mask];\
-			texel3 = *(uint16_t *)&(TT)->ram[(texbase + 2*(t1 + s1)) & (TT)->mask];\
-			if (TEXMODE_FORMAT(TEXMODE) >= 10 && TEXMODE_FORMAT(TEXMODE) <= 12)	\
-			{																	\
-				texel0 = (LOOKUP)[texel0];										\
-				texel1 = (LOOKUP)[texel1];										\
-				texel2 = (LOOKUP)[texel2];										\
-				texel3 = (LOOKUP)[texel3];										\
-			}																	\
-			else																\
-			{																	\
-				texel0 = ((LOOKUP)[texel0 & 0xff] & 0xffffff) | 				\
-							((texel0 & 0xff00) << 16);							\
-				texel1 = ((LOOKUP)[texel1 & 0xff] & 0xffffff) | 				\
-							((texel1 & 0xff00) << 16);							\
-				texel2 = ((LOOKUP)[texel2 & 0xff] & 0xffffff) | 				\
-							((texel2 & 0xff00) << 16);							\
-				texel3 = ((LOOKUP)[texel3 & 0xff] & 0xffffff) | 				\
-							((texel3 & 0xff00) << 16);							\
-			}																	\
-		}																		\
-																				\
-		/* weigh in each texel */												\
-		c_local.u = rgba_bilinear_filter(texel0, texel1, texel2, texel3, sfrac, tfrac);\
+		/* fetch texel data and weigh in each texel */							\
+		const auto format = static_cast<uint8_t>(								\
+		        TEXMODE_FORMAT((TT)->reg[textureMode].u));						\
+		c_local.u = fetch_bilinear_texels((TT), format, (LOOKUP), texbase,		\
+		                                  s, s1, t, t1, sfrac, tfrac);			\
 	}																			\
 																				\
 	/* select zero/other for RGB */												\
@@ -3035,8 +3070,16 @@ static double Voodoo_GetHRetracePosition();
 static dither_lut_t dither2_lookup = {};
 static dither_lut_t dither4_lookup = {};
 
-static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_t TEXMODE0,
-                                  uint32_t TEXMODE1, void* destbase, int32_t y,
+// The shared rasterizer body. The mode arguments are either the live
+// register values (generic rasterizers) or compile-time constants
+// (specialized rasterizers), in which case the forced inlining lets the
+// compiler fold away every mode decision in the per-pixel loop.
+GCC_ATTRIBUTE(always_inline)
+static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS,
+                                  uint32_t r_fbzColorPath, uint32_t r_alphaMode,
+                                  uint32_t r_fogMode, uint32_t r_fbzMode,
+                                  uint32_t TEXMODE0, uint32_t TEXMODE1,
+                                  void* destbase, int32_t y,
                                   const poly_extent* extent, stats_block& stats)
 {
 	const uint8_t* dither_lookup = nullptr;
@@ -3053,11 +3096,7 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	const auto& tmu0 = vs->tmu[0];
 	const auto& tmu1 = vs->tmu[1];
 
-	const uint32_t r_fbzColorPath = regs[fbzColorPath].u;
-	const uint32_t r_fbzMode      = regs[fbzMode].u;
-	const uint32_t r_alphaMode    = regs[alphaMode].u;
-	const uint32_t r_fogMode      = regs[fogMode].u;
-	const uint32_t r_zaColor      = regs[zaColor].u;
+	const uint32_t r_zaColor = regs[zaColor].u;
 
 	uint32_t r_stipple = regs[stipple].u;
 
@@ -3445,6 +3484,194 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	}
 }
 
+/*-------------------------------------------------
+    generic and specialized rasterizers
+-------------------------------------------------*/
+
+/* generic rasterizers decode the pipeline registers on every scanline */
+template <uint32_t TMUS>
+static void raster_generic_tmus(const voodoo_state* vs, uint32_t texmode0,
+                                uint32_t texmode1, void* destbase, int32_t y,
+                                const poly_extent* extent, stats_block& stats)
+{
+	const auto regs = vs->reg;
+	raster_generic(vs, TMUS, regs[fbzColorPath].u, regs[alphaMode].u,
+	               regs[fogMode].u, regs[fbzMode].u, texmode0, texmode1,
+	               destbase, y, extent, stats);
+}
+
+/* specialized rasterizers bake a normalized pipeline state into the code */
+template <uint32_t TMUS, uint32_t FBZCP, uint32_t ALPHAMODE, uint32_t FOGMODE,
+          uint32_t FBZMODE, uint32_t TEXMODE0, uint32_t TEXMODE1>
+static void raster_specialized(const voodoo_state* vs, uint32_t /*texmode0*/,
+                               uint32_t /*texmode1*/, void* destbase, int32_t y,
+                               const poly_extent* extent, stats_block& stats)
+{
+	raster_generic(vs, TMUS, FBZCP, ALPHAMODE, FOGMODE, FBZMODE, TEXMODE0,
+	               TEXMODE1, destbase, y, extent, stats);
+}
+
+struct specialized_rasterizer {
+	raster_key key           = {};
+	rasterizer_func callback = nullptr;
+};
+
+#define RASTERIZER_ENTRY(TMUS, FBZCP, ALPHAMODE, FOGMODE, FBZMODE, TEXMODE0, TEXMODE1) \
+	specialized_rasterizer{{TMUS, FBZCP, ALPHAMODE, FOGMODE, FBZMODE, TEXMODE0, TEXMODE1}, \
+	                       raster_specialized<TMUS, FBZCP, ALPHAMODE, FOGMODE, FBZMODE, TEXMODE0, TEXMODE1>}
+
+/* Frequently used Glide pipeline states, in normalized form. Build with
+ * LOG_RASTERIZERS enabled to get the states a game actually uses printed
+ * as entries for this table on shutdown.
+ *
+ * Color paths: 0x00824100 = iterated (Gouraud) color and alpha,
+ *              0x00000005 = texture color and alpha (decal),
+ *              0x00482405 = texture modulated by iterated color and alpha.
+ * Alpha modes: 0x00005110 = blend src_alpha / one_minus_src_alpha,
+ *              0x00000009 = alpha test greater-than (cutout textures).
+ * FBZ modes:   0x00000739 = clipped, dithered, W-buffered with less-than,
+ *              0x00000731 = as above but Z-buffered,
+ *              0x00000301 = clipped and dithered without depth buffering.
+ * Tex modes:   0x0C261ACF = perspective, bilinear, clamped 16-bit texture
+ *              passed through unchanged; 0x0C261AC9 is its point-sampled
+ *              variant used when 'voodoo_bilinear_filtering' is off.
+ */
+static constexpr std::array specialized_rasterizers = {
+        // Untextured
+        RASTERIZER_ENTRY(0, 0x00824100, 0x00000000, 0, 0x00000739, 0xffffffff, 0xffffffff),
+        RASTERIZER_ENTRY(0, 0x00824100, 0x00000000, 0, 0x00000731, 0xffffffff, 0xffffffff),
+        RASTERIZER_ENTRY(0, 0x00824100, 0x00005110, 0, 0x00000301, 0xffffffff, 0xffffffff),
+
+        // Single TMU, point-sampled
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000000, 0, 0x00000739, 0x0C261AC9, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000000, 0, 0x00000731, 0x0C261AC9, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00005110, 0, 0x00000739, 0x0C261AC9, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000009, 0, 0x00000739, 0x0C261AC9, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00000005, 0x00000000, 0, 0x00000301, 0x0C261AC9, 0xffffffff),
+
+        // Single TMU, bilinear
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000000, 0, 0x00000739, 0x0C261ACF, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000000, 0, 0x00000731, 0x0C261ACF, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00005110, 0, 0x00000739, 0x0C261ACF, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00482405, 0x00000009, 0, 0x00000739, 0x0C261ACF, 0xffffffff),
+        RASTERIZER_ENTRY(1, 0x00000005, 0x00000000, 0, 0x00000301, 0x0C261ACF, 0xffffffff),
+
+        // Dual TMU, point-sampled
+        RASTERIZER_ENTRY(2, 0x00482405, 0x00000000, 0, 0x00000739, 0x0C261AC9, 0x0C261AC9),
+        RASTERIZER_ENTRY(2, 0x00482405, 0x00005110, 0, 0x00000739, 0x0C261AC9, 0x0C261AC9),
+
+        // Dual TMU, bilinear
+        RASTERIZER_ENTRY(2, 0x00482405, 0x00000000, 0, 0x00000739, 0x0C261ACF, 0x0C261ACF),
+        RASTERIZER_ENTRY(2, 0x00482405, 0x00005110, 0, 0x00000739, 0x0C261ACF, 0x0C261ACF),
+};
+
+#undef RASTERIZER_ENTRY
+
+// The table is only ever matched against normalized keys, so a
+// non-normalized entry would silently never be selected.
+static constexpr bool is_normalized(const raster_key& key)
+{
+	return key.color_path == normalize_color_path(key.color_path) &&
+	       key.alpha_mode == normalize_alpha_mode(key.alpha_mode) &&
+	       key.fog_mode == normalize_fog_mode(key.fog_mode) &&
+	       key.fbz_mode == normalize_fbz_mode(key.fbz_mode) &&
+	       (key.tmus < 1 || key.tex_mode_0 == normalize_tex_mode(key.tex_mode_0)) &&
+	       (key.tmus < 2 || key.tex_mode_1 == normalize_tex_mode(key.tex_mode_1));
+}
+
+static_assert(std::all_of(specialized_rasterizers.begin(),
+                          specialized_rasterizers.end(),
+                          [](const auto& entry) { return is_normalized(entry.key); }));
+
+static rasterizer_func lookup_rasterizer(const raster_key& key)
+{
+	for (const auto& entry : specialized_rasterizers) {
+		if (entry.key == key) {
+			return entry.callback;
+		}
+	}
+	switch (key.tmus) {
+	case 0: return raster_generic_tmus<0>;
+	case 1: return raster_generic_tmus<1>;
+	default: return raster_generic_tmus<2>;
+	}
+}
+
+/*-------------------------------------------------
+    select_rasterizer - pick the rasterizer for
+    the current pipeline state, re-using the last
+    choice while the state stays the same
+-------------------------------------------------*/
+static rasterizer_func select_rasterizer(voodoo_state* vs, uint32_t tmus,
+                                         uint32_t texmode0, uint32_t texmode1)
+{
+	const auto regs = vs->reg;
+
+	raster_key key = {};
+	key.tmus       = tmus;
+	key.color_path = normalize_color_path(regs[fbzColorPath].u);
+	key.alpha_mode = normalize_alpha_mode(regs[alphaMode].u);
+	key.fog_mode   = normalize_fog_mode(regs[fogMode].u);
+	key.fbz_mode   = normalize_fbz_mode(regs[fbzMode].u);
+	key.tex_mode_0 = (tmus >= 1) ? normalize_tex_mode(texmode0) : 0xffffffff;
+	key.tex_mode_1 = (tmus >= 2) ? normalize_tex_mode(texmode1) : 0xffffffff;
+
+	auto& raster = vs->raster;
+	if (!raster.callback || key != raster.key) {
+		raster.key      = key;
+		raster.callback = lookup_rasterizer(key);
+
+		if (LOG_RASTERIZERS) {
+			const auto [it, inserted] = raster.profiles.try_emplace(key);
+			raster.profile = &it->second;
+			raster.profile->specialized =
+			        (raster.callback != raster_generic_tmus<0> &&
+			         raster.callback != raster_generic_tmus<1> &&
+			         raster.callback != raster_generic_tmus<2>);
+			if (inserted) {
+				LOG_MSG("VOODOO: New %s rasterizer state: %u TMU(s) %08X %08X %08X %08X %08X %08X",
+				        raster.profile->specialized ? "specialized" : "generic",
+				        key.tmus, key.color_path, key.alpha_mode,
+				        key.fog_mode, key.fbz_mode, key.tex_mode_0,
+				        key.tex_mode_1);
+			}
+		}
+	}
+	if (LOG_RASTERIZERS) {
+		++raster.profile->triangles;
+	}
+	return raster.callback;
+}
+
+/*-------------------------------------------------
+    log_rasterizer_profile - print the most used
+    pipeline states as rasterizer table entries
+-------------------------------------------------*/
+static void log_rasterizer_profile(const raster_selection& raster)
+{
+	if (!LOG_RASTERIZERS || raster.profiles.empty()) {
+		return;
+	}
+
+	std::vector<std::pair<raster_key, raster_profile>> sorted(
+	        raster.profiles.begin(), raster.profiles.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second.triangles > b.second.triangles;
+	});
+
+	constexpr size_t MaxLoggedStates = 32;
+	LOG_MSG("VOODOO: Most used rasterizer states (%zu in total):",
+	        sorted.size());
+	for (size_t i = 0; i < sorted.size() && i < MaxLoggedStates; ++i) {
+		const auto& [key, profile] = sorted[i];
+		LOG_MSG("VOODOO:   RASTERIZER_ENTRY(%u, 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X), // %s, %llu triangles",
+		        key.tmus, key.color_path, key.alpha_mode, key.fog_mode,
+		        key.fbz_mode, key.tex_mode_0, key.tex_mode_1,
+		        profile.specialized ? "specialized" : "generic",
+		        static_cast<unsigned long long>(profile.triangles));
+	}
+}
+
 #ifdef C_ENABLE_VOODOO_OPENGL
 /*-------------------------------------------------
     add_rasterizer - add a rasterizer to our
@@ -3710,22 +3937,16 @@ static void init_tmu_shared(tmu_shared_state *s)
 	/* build static 16-bit texel tables */
 	for (val = 0; val < 65536; val++)
 	{
-		int r;
-		int g;
-		int b;
-		int a;
+		const auto texel = static_cast<uint16_t>(val);
 
 		/* table 10 = 16-bit RGB (5-6-5) */
-		EXTRACT_565_TO_888(val, r, g, b);
-		s->rgb565[val] = MAKE_ARGB(0xff, r, g, b);
+		s->rgb565[val] = decode_rgb565(texel);
 
 		/* table 11 = 16 ARGB (1-5-5-5) */
-		EXTRACT_1555_TO_8888(val, a, r, g, b);
-		s->argb1555[val] = MAKE_ARGB(a, r, g, b);
+		s->argb1555[val] = decode_argb1555(texel);
 
 		/* table 12 = 16-bit ARGB (4-4-4-4) */
-		EXTRACT_4444_TO_8888(val, a, r, g, b);
-		s->argb4444[val] = MAKE_ARGB(a, r, g, b);
+		s->argb4444[val] = decode_argb4444(texel);
 	}
 }
 
@@ -4304,25 +4525,9 @@ static void update_statistics(voodoo_state *vs, bool accumulate)
 
 static void triangle_worker_work(triangle_worker& tworker, int32_t worktstart, int32_t worktend)
 {
-	/* determine the number of TMUs involved */
-	uint32_t tmus     = 0;
-	uint32_t texmode0 = 0;
-	uint32_t texmode1 = 0;
-	if (!FBIINIT3_DISABLE_TMUS(v->reg[fbiInit3].u) && FBZCP_TEXTURE_ENABLE(v->reg[fbzColorPath].u))
-	{
-		tmus = 1;
-		texmode0 = v->tmu[0].reg[textureMode].u;
-		if ((v->chipmask & 0x04) != 0)
-		{
-			tmus = 2;
-			texmode1 = v->tmu[1].reg[textureMode].u;
-		}
-		if (tworker.disable_bilinear_filter) //force disable bilinear filter
-		{
-			texmode0 &= ~6;
-			texmode1 &= ~6;
-		}
-	}
+	const auto rasterizer = tworker.rasterizer;
+	const auto texmode0   = tworker.texmode0;
+	const auto texmode1   = tworker.texmode1;
 
 	/* compute the slopes for each portion of the triangle */
 	const poly_vertex v1 = tworker.v1;
@@ -4380,7 +4585,7 @@ static void triangle_worker_work(triangle_worker& tworker, int32_t worktstart, i
 			extent.stopx -= (sumpix - to);
 		}
 
-		raster_generic(v, tmus, texmode0, texmode1, tworker.drawbuf, curscan, &extent, my_stats);
+		rasterizer(v, texmode0, texmode1, tworker.drawbuf, curscan, &extent, my_stats);
 	}
 	sum_statistics(&v->thread_stats[worktstart], &my_stats);
 }
@@ -4692,6 +4897,18 @@ static void triangle(voodoo_state *vs)
 	}
 
 	triangle_worker& tworker = vs->tworker;
+
+	/* determine the texture modes and pick a rasterizer for them */
+	tworker.texmode0 = (texcount >= 1) ? tmu0.reg[textureMode].u : 0;
+	tworker.texmode1 = (texcount >= 2) ? tmu1.reg[textureMode].u : 0;
+	if (tworker.disable_bilinear_filter) //force disable bilinear filter
+	{
+		tworker.texmode0 &= ~6;
+		tworker.texmode1 &= ~6;
+	}
+	tworker.rasterizer = select_rasterizer(vs, texcount, tworker.texmode0,
+	                                       tworker.texmode1);
+
 	tworker.v1 = *v1, tworker.v2 = *v2, tworker.v3 = *v3;
 	tworker.drawbuf = drawbuf;
 	tworker.v1y = v1y;
@@ -7042,13 +7259,6 @@ static void voodoo_init() {
 		dither2_lookup = generate_dither_lut(dither_matrix_2x2);
 		dither4_lookup = generate_dither_lut(dither_matrix_4x4);
 
-#if defined(__SSE2__)
-		/* create sse2 scale table for rgba_bilinear_filter */
-		for (int16_t i = 0; i != 256; i++) {
-			sse2_scale_table[i][0] = sse2_scale_table[i][2] = sse2_scale_table[i][4] = sse2_scale_table[i][6] = i;
-			sse2_scale_table[i][1] = sse2_scale_table[i][3] = sse2_scale_table[i][5] = sse2_scale_table[i][7] = 256-i;
-		}
-#endif
 	}
 
 	v->tmu_config = 0x11;	// revision 1
@@ -7714,6 +7924,8 @@ static void voodoo_shutdown()
 	v->active = false;
 	triangle_worker_shutdown(v->tworker);
 
+	log_rasterizer_profile(v->raster);
+
 	delete v;
 	v = nullptr;
 
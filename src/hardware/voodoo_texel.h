@@ -0,0 +1,230 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VOODOO_TEXEL_H
+#define DOSBOX_VOODOO_TEXEL_H
+
+// Texel decoding and bilinear filtering kernels used by the Voodoo texture
+// pipeline. The scalar functions are the reference implementation; the SSE2
+// functions operate on all four texels of a bilinear footprint at once and
+// are used by the pipeline when available.
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Packed 0xAARRGGBB colour value
+using voodoo_argb_t = uint32_t;
+
+// 16-bit texel formats that are decoded arithmetically rather than through
+// a palette (the textureMode format field values).
+enum VoodooTexelFormat : uint8_t {
+	TexelRgb565   = 10,
+	TexelArgb1555 = 11,
+	TexelArgb4444 = 12,
+};
+
+constexpr voodoo_argb_t decode_rgb565(const uint16_t val)
+{
+	const uint32_t r = ((val >> 8) & 0xf8) | ((val >> 13) & 0x07);
+	const uint32_t g = ((val >> 3) & 0xfc) | ((val >> 9) & 0x03);
+	const uint32_t b = ((val << 3) & 0xf8) | ((val >> 2) & 0x07);
+	return (0xffu << 24) | (r << 16) | (g << 8) | b;
+}
+
+constexpr voodoo_argb_t decode_argb1555(const uint16_t val)
+{
+	const uint32_t a = (val & 0x8000) ? 0xff : 0x00;
+	const uint32_t r = ((val >> 7) & 0xf8) | ((val >> 12) & 0x07);
+	const uint32_t g = ((val >> 2) & 0xf8) | ((val >> 7) & 0x07);
+	const uint32_t b = ((val << 3) & 0xf8) | ((val >> 2) & 0x07);
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+constexpr voodoo_argb_t decode_argb4444(const uint16_t val)
+{
+	const uint32_t a = ((val >> 8) & 0xf0) | ((val >> 12) & 0x0f);
+	const uint32_t r = ((val >> 4) & 0xf0) | ((val >> 8) & 0x0f);
+	const uint32_t g = ((val >> 0) & 0xf0) | ((val >> 4) & 0x0f);
+	const uint32_t b = ((val << 4) & 0xf0) | ((val >> 0) & 0x0f);
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+constexpr voodoo_argb_t decode_texel16(const uint8_t format, const uint16_t val)
+{
+	switch (format) {
+	case TexelRgb565: return decode_rgb565(val);
+	case TexelArgb1555: return decode_argb1555(val);
+	default: return decode_argb4444(val);
+	}
+}
+
+// Blends the four texels of a bilinear footprint; u and v are the 8-bit
+// fractions between the left/right and top/bottom texels.
+inline voodoo_argb_t rgba_bilinear_filter_scalar(voodoo_argb_t rgb00,
+                                                 voodoo_argb_t rgb01,
+                                                 voodoo_argb_t rgb10,
+                                                 voodoo_argb_t rgb11,
+                                                 const uint8_t u,
+                                                 const uint8_t v)
+{
+	uint32_t ag0, ag1, rb0, rb1;
+	rb0 = (rgb00 & 0x00ff00ff) + ((((rgb01 & 0x00ff00ff) - (rgb00 & 0x00ff00ff)) * u) >> 8);
+	rb1 = (rgb10 & 0x00ff00ff) + ((((rgb11 & 0x00ff00ff) - (rgb10 & 0x00ff00ff)) * u) >> 8);
+	rgb00 >>= 8;
+	rgb01 >>= 8;
+	rgb10 >>= 8;
+	rgb11 >>= 8;
+	ag0 = (rgb00 & 0x00ff00ff) + ((((rgb01 & 0x00ff00ff) - (rgb00 & 0x00ff00ff)) * u) >> 8);
+	ag1 = (rgb10 & 0x00ff00ff) + ((((rgb11 & 0x00ff00ff) - (rgb10 & 0x00ff00ff)) * u) >> 8);
+	rb0 = (rb0 & 0x00ff00ff) + ((((rb1 & 0x00ff00ff) - (rb0 & 0x00ff00ff)) * v) >> 8);
+	ag0 = (ag0 & 0x00ff00ff) + ((((ag1 & 0x00ff00ff) - (ag0 & 0x00ff00ff)) * v) >> 8);
+	return ((ag0 << 8) & 0xff00ff00) | (rb0 & 0x00ff00ff);
+}
+
+#if defined(__SSE2__)
+
+// Pairs of {fraction, 256 - fraction} weights for _mm_madd_epi16
+using bilinear_weights_t = std::array<std::array<int16_t, 8>, 256>;
+
+constexpr bilinear_weights_t generate_bilinear_weights()
+{
+	bilinear_weights_t weights = {};
+	for (int16_t i = 0; i < 256; ++i) {
+		for (size_t lane = 0; lane < 8; lane += 2) {
+			weights[i][lane]     = i;
+			weights[i][lane + 1] = static_cast<int16_t>(256 - i);
+		}
+	}
+	return weights;
+}
+
+alignas(16) inline constexpr bilinear_weights_t bilinear_weights = generate_bilinear_weights();
+
+// Decodes four 16-bit texels, one per 32-bit lane, into ARGB values
+inline __m128i decode_rgb565_x4(const __m128i val)
+{
+	const auto r = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 8), _mm_set1_epi32(0x00f80000)),
+	        _mm_and_si128(_mm_slli_epi32(val, 3), _mm_set1_epi32(0x00070000)));
+	const auto g = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 5), _mm_set1_epi32(0x0000fc00)),
+	        _mm_and_si128(_mm_srli_epi32(val, 1), _mm_set1_epi32(0x00000300)));
+	const auto b = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 3), _mm_set1_epi32(0x000000f8)),
+	        _mm_and_si128(_mm_srli_epi32(val, 2), _mm_set1_epi32(0x00000007)));
+	return _mm_or_si128(_mm_or_si128(r, g),
+	                    _mm_or_si128(b, _mm_set1_epi32(0xff000000)));
+}
+
+inline __m128i decode_argb1555_x4(const __m128i val)
+{
+	// Replicate bit 15 across the alpha byte
+	const auto a = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(val, 16), 31),
+	                             _mm_set1_epi32(0xff000000));
+	const auto r = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 9), _mm_set1_epi32(0x00f80000)),
+	        _mm_and_si128(_mm_slli_epi32(val, 4), _mm_set1_epi32(0x00070000)));
+	const auto g = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 6), _mm_set1_epi32(0x0000f800)),
+	        _mm_and_si128(_mm_slli_epi32(val, 1), _mm_set1_epi32(0x00000700)));
+	const auto b = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 3), _mm_set1_epi32(0x000000f8)),
+	        _mm_and_si128(_mm_srli_epi32(val, 2), _mm_set1_epi32(0x00000007)));
+	return _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b));
+}
+
+inline __m128i decode_argb4444_x4(const __m128i val)
+{
+	// Each nibble is widened to a byte by repeating it: 0xN -> 0xNN
+	const auto spread = _mm_or_si128(
+	        _mm_and_si128(_mm_slli_epi32(val, 16), _mm_set1_epi32(0xf0000000)),
+	        _mm_or_si128(
+	                _mm_and_si128(_mm_slli_epi32(val, 12), _mm_set1_epi32(0x00f00000)),
+	                _mm_or_si128(_mm_and_si128(_mm_slli_epi32(val, 8),
+	                                           _mm_set1_epi32(0x0000f000)),
+	                             _mm_and_si128(_mm_slli_epi32(val, 4),
+	                                           _mm_set1_epi32(0x000000f0)))));
+	return _mm_or_si128(spread, _mm_srli_epi32(spread, 4));
+}
+
+inline __m128i decode_texel16_x4(const uint8_t format, const __m128i val)
+{
+	switch (format) {
+	case TexelRgb565: return decode_rgb565_x4(val);
+	case TexelArgb1555: return decode_argb1555_x4(val);
+	default: return decode_argb4444_x4(val);
+	}
+}
+
+// Blends a bilinear footprint held as {rgb00, rgb01, rgb10, rgb11} in the
+// four 32-bit lanes of 'texels'.
+inline voodoo_argb_t rgba_bilinear_filter_x4(const __m128i texels,
+                                             const uint8_t u, const uint8_t v)
+{
+	const auto scale_u = _mm_load_si128(
+	        reinterpret_cast<const __m128i*>(bilinear_weights[u].data()));
+	const auto scale_v = _mm_load_si128(
+	        reinterpret_cast<const __m128i*>(bilinear_weights[v].data()));
+	const auto zero = _mm_setzero_si128();
+
+	// Interleave the bytes of the right and left texel of each row, then
+	// widen them so madd produces right * u + left * (256 - u) per channel.
+	const auto right = _mm_shuffle_epi32(texels, _MM_SHUFFLE(3, 1, 3, 1));
+	const auto left  = _mm_shuffle_epi32(texels, _MM_SHUFFLE(2, 0, 2, 0));
+	const auto rows  = _mm_unpacklo_epi8(right, left);
+
+	const auto top    = _mm_madd_epi16(_mm_unpacklo_epi8(rows, zero), scale_u);
+	const auto bottom = _mm_madd_epi16(_mm_unpackhi_epi8(rows, zero), scale_u);
+
+	// Pack both 8.8 rows into 16-bit pairs (dropping one fractional bit)
+	// and weigh them the same way vertically.
+	const auto pairs = _mm_max_epi16(_mm_slli_epi32(top, 15),
+	                                 _mm_srli_epi32(bottom, 1));
+	const auto blended = _mm_srli_epi32(_mm_madd_epi16(pairs, scale_v), 15);
+
+	return static_cast<voodoo_argb_t>(_mm_cvtsi128_si32(
+	        _mm_packus_epi16(_mm_packs_epi32(blended, zero), zero)));
+}
+
+#endif // __SSE2__
+
+inline voodoo_argb_t rgba_bilinear_filter(const voodoo_argb_t rgb00,
+                                          const voodoo_argb_t rgb01,
+                                          const voodoo_argb_t rgb10,
+                                          const voodoo_argb_t rgb11,
+                                          const uint8_t u, const uint8_t v)
+{
+#if defined(__SSE2__)
+	return rgba_bilinear_filter_x4(_mm_setr_epi32(static_cast<int>(rgb00),
+	                                              static_cast<int>(rgb01),
+	                                              static_cast<int>(rgb10),
+	                                              static_cast<int>(rgb11)),
+	                               u,
+	                               v);
+#else
+	return rgba_bilinear_filter_scalar(rgb00, rgb01, rgb10, rgb11, u, v);
+#endif
+}
+
+#endif // DOSBOX_VOODOO_TEXEL_H
@@ -22,6 +22,7 @@
 
 #if C_FLUIDSYNTH
 
+#include <algorithm>
 #include <bitset>
 #include <cassert>
 #include <deque>
@@ -41,11 +42,15 @@
 #include "programs.h"
 #include "string_utils.h"
 #include "support.h"
+#include "timer.h"
 
 MidiHandlerFluidsynth instance;
 
 constexpr auto SoundFontExtension = ".sf2";
 
+// Upper bound on FluidSynth's voice rendering worker threads
+constexpr int MaxRenderCpuCores = 8;
+
 static void init_fluid_dosbox_settings(Section_prop& secprop)
 {
 	constexpr auto when_idle = Property::Changeable::WhenIdle;
@@ -95,6 +100,15 @@ static void init_fluid_dosbox_settings(Section_prop& secprop)
 	        "      same time. Whether this sounds good depends on the SoundFont and the\n"
 	        "      reverb settings being used.");
 
+	constexpr auto default_cpu_cores = 1;
+	auto* int_prop = secprop.Add_int("fsynth_cpu_cores", when_idle, default_cpu_cores);
+	int_prop->SetMinMax(1, MaxRenderCpuCores);
+	int_prop->Set_help(
+	        "Number of CPU cores FluidSynth renders voices on, from 1 to 8 (1 by default).\n"
+	        "Values above 1 spread the voices of dense MIDI passages over additional\n"
+	        "worker threads, which can prevent audio underruns with complex SoundFonts.\n"
+	        "The value is capped to the number of CPU cores in the system.");
+
 	str_prop = secprop.Add_string("fsynth_filter", when_idle, "off");
 	assert(str_prop);
 	str_prop->Set_help(
@@ -214,7 +228,7 @@ static std_fs::path find_sf_file(const std::string& name)
 	return {};
 }
 
-static void log_unknown_midi_message(const std::vector<uint8_t>& msg)
+static void log_unknown_midi_message(const MidiMessage& msg)
 {
 	auto append_as_hex = [](const std::string& str, const uint8_t val) {
 		constexpr char hex_chars[] = "0123456789ABCDEF";
@@ -227,8 +241,8 @@ static void log_unknown_midi_message(const std::vector<uint8_t>& msg)
 		return str + (str.empty() ? "" : ", ") + hex_str;
 	};
 
-	const auto hex_values = std::accumulate(msg.begin(),
-	                                        msg.end(),
+	const auto hex_values = std::accumulate(msg.data.begin(),
+	                                        msg.data.end(),
 	                                        std::string(),
 	                                        append_as_hex);
 
@@ -263,6 +277,15 @@ bool MidiHandlerFluidsynth::Open([[maybe_unused]] const char* conf)
 	                      "synth.sample-rate",
 	                      sample_rate_hz);
 
+	// Render voices in parallel on the requested number of cores, but
+	// never on more than the system has.
+	const auto available_cores = std::max(
+	        1, static_cast<int>(std::thread::hardware_concurrency()));
+	const auto cpu_cores = std::clamp(section->Get_int("fsynth_cpu_cores"),
+	                                  1,
+	                                  std::min(available_cores, MaxRenderCpuCores));
+	fluid_settings_setint(fluid_settings.get(), "synth.cpu-cores", cpu_cores);
+
 	FluidSynthPtr fluid_synth(new_fluid_synth(fluid_settings.get()),
 	                         delete_fluid_synth);
 	if (!fluid_synth) {
@@ -304,6 +327,10 @@ bool MidiHandlerFluidsynth::Open([[maybe_unused]] const char* conf)
 		        scale_by_percent);
 	}
 
+	if (cpu_cores > 1) {
+		LOG_MSG("FSYNTH: Rendering voices on %d CPU cores", cpu_cores);
+	}
+
 	constexpr int fx_group = -1; // applies setting to all groups
 
 	// Use a 7th-order (highest) polynomial to generate MIDI channel waveforms
@@ -545,8 +572,9 @@ bool MidiHandlerFluidsynth::Open([[maybe_unused]] const char* conf)
 
 	// We have measured DOS games sending hundreds of MIDI messages within a
 	// short handful of millseconds, so a safe but very generous upper bound
-	// is used (Note: the actual memory used by the FIFO is incremental
-	// based on actual usage).
+	// is used (Note: the FIFO allocates all of its slots up front, rounded
+	// up to a power of two, so this costs 16384 slots of a few bytes each,
+	// or about 160 KB).
 	static constexpr uint16_t midi_spec_max_msg_rate_hz = 1042;
 	work_fifo.Resize(midi_spec_max_msg_rate_hz * 10);
 
@@ -600,6 +628,8 @@ void MidiHandlerFluidsynth::Close()
 		renderer.join();
 	}
 
+	PrintStats();
+
 	// Reset the members
 	synth.reset();
 	settings.reset();
@@ -613,9 +643,40 @@ void MidiHandlerFluidsynth::Close()
 	last_rendered_ms   = 0.0;
 	ms_per_audio_frame = 0.0;
 
+	render_stats = {};
+
 	is_open = false;
 }
 
+void MidiHandlerFluidsynth::PrintStats()
+{
+	const auto& stats = render_stats;
+
+	// Is there enough information to be meaningful?
+	constexpr auto min_rendered_ms = 10000.0;
+
+	const auto rendered_ms = static_cast<double>(stats.num_audio_frames) *
+	                         ms_per_audio_frame;
+	if (rendered_ms < min_rendered_ms || stats.render_us <= 0) {
+		return;
+	}
+
+	// How much faster than real-time the audio was rendered, and how far
+	// ahead of the mixer the render queue ran on average.
+	const auto render_ms      = static_cast<double>(stats.render_us) / 1000.0;
+	const auto realtime_ratio = rendered_ms / render_ms;
+
+	const auto avg_queued_ms = static_cast<double>(stats.queued_audio_frames) /
+	                           static_cast<double>(stats.num_renders) *
+	                           ms_per_audio_frame;
+
+	LOG_MSG("FSYNTH: Rendered %.1f seconds of audio at %.1fx real-time, "
+	        "with %.1f ms queued ahead of the mixer on average",
+	        rendered_ms / MillisInSecond,
+	        realtime_ratio,
+	        avg_queued_ms);
+}
+
 uint16_t MidiHandlerFluidsynth::GetNumPendingAudioFrames()
 {
 	const auto now_ms = PIC_FullIndex();
@@ -643,24 +704,16 @@ uint16_t MidiHandlerFluidsynth::GetNumPendingAudioFrames()
 // The request to play the channel message is placed in the MIDI work FIFO
 void MidiHandlerFluidsynth::PlayMsg(const MidiMessage& msg)
 {
-	std::vector<uint8_t> message(msg.data.begin(), msg.data.end());
-
-	MidiWork work{std::move(message),
-	              GetNumPendingAudioFrames(),
-	              MessageType::Channel};
-
-	work_fifo.Enqueue(std::move(work));
+	work_fifo.EnqueueMessage(msg, GetNumPendingAudioFrames());
 }
 
 // The request to play the sysex message is placed in the MIDI work FIFO
 void MidiHandlerFluidsynth::PlaySysex(uint8_t* sysex, size_t len)
 {
-	std::vector<uint8_t> message(sysex, sysex + len);
-	MidiWork work{std::move(message), GetNumPendingAudioFrames(), MessageType::SysEx};
-	work_fifo.Enqueue(std::move(work));
+	work_fifo.EnqueueSysex(sysex, len, GetNumPendingAudioFrames());
 }
 
-void MidiHandlerFluidsynth::ApplyChannelMessage(const std::vector<uint8_t>& msg)
+void MidiHandlerFluidsynth::ApplyChannelMessage(const MidiMessage& msg)
 {
 	const auto status_byte = msg[0];
 	const auto status      = get_midi_status(status_byte);
@@ -728,7 +781,7 @@ void MidiHandlerFluidsynth::ApplyChannelMessage(const std::vector<uint8_t>& msg)
 }
 
 // Apply the sysex message to the service
-void MidiHandlerFluidsynth::ApplySysexMessage(const std::vector<uint8_t>& msg)
+void MidiHandlerFluidsynth::ApplySysexMessage(const std::span<const uint8_t> msg)
 {
 	const char* data = reinterpret_cast<const char*>(msg.data());
 	const auto n     = static_cast<int>(msg.size());
@@ -756,11 +809,16 @@ void MidiHandlerFluidsynth::MixerCallBack(const uint16_t requested_audio_frames)
 
 	static std::vector<AudioFrame> audio_frames = {};
 
-	const auto has_dequeued = audio_frame_fifo.BulkDequeue(audio_frames,
-	                                                       requested_audio_frames);
+	// Maybe expand the vector
+	if (audio_frames.size() < requested_audio_frames) {
+		audio_frames.resize(requested_audio_frames);
+	}
+
+	const auto num_dequeued = audio_frame_fifo.BulkDequeue(
+	        {audio_frames.data(), requested_audio_frames});
 
-	if (has_dequeued) {
-		assert(audio_frames.size() == requested_audio_frames);
+	// Only comes up short once the FIFO has been stopped
+	if (num_dequeued == requested_audio_frames) {
 		mixer_channel->AddSamples_sfloat(requested_audio_frames,
 		                                 &audio_frames[0][0]);
 		last_rendered_ms = PIC_FullIndex();
@@ -779,6 +837,8 @@ void MidiHandlerFluidsynth::RenderAudioFramesToFifo(const uint16_t num_audio_fra
 		audio_frames.resize(num_audio_frames);
 	}
 
+	const auto start_us = GetTicksUs();
+
 	fluid_synth_write_float(synth.get(),
 	                        num_audio_frames,
 	                        &audio_frames[0][0],
@@ -788,7 +848,12 @@ void MidiHandlerFluidsynth::RenderAudioFramesToFifo(const uint16_t num_audio_fra
 	                        1,
 	                        2);
 
-	audio_frame_fifo.BulkEnqueue(audio_frames, num_audio_frames);
+	render_stats.render_us += GetTicksUsSince(start_us);
+	render_stats.num_audio_frames += num_audio_frames;
+	render_stats.queued_audio_frames += audio_frame_fifo.Size();
+	++render_stats.num_renders;
+
+	audio_frame_fifo.BulkEnqueue({audio_frames.data(), num_audio_frames});
 }
 
 void MidiHandlerFluidsynth::ProcessWorkFromFifo()
@@ -818,7 +883,7 @@ void MidiHandlerFluidsynth::ProcessWorkFromFifo()
 		ApplyChannelMessage(work->message);
 	} else {
 		assert(work->message_type == MessageType::SysEx);
-		ApplySysexMessage(work->message);
+		ApplySysexMessage(work_fifo.GetSysex());
 	}
 }
 
@@ -22,11 +22,13 @@
 #define DOSBOX_MIDI_FLUIDSYNTH_H
 
 #include "midi_handler.h"
+#include "midi_work_fifo.h"
 
 #if C_FLUIDSYNTH
 
 #include <atomic>
 #include <memory>
+#include <span>
 #include <vector>
 #include <fluidsynth.h>
 #include <thread>
@@ -57,8 +59,8 @@ public:
 	MIDI_RC ListAll(Program *caller) override;
 
 private:
-	void ApplyChannelMessage(const std::vector<uint8_t>& msg);
-	void ApplySysexMessage(const std::vector<uint8_t>& msg);
+	void ApplyChannelMessage(const MidiMessage& msg);
+	void ApplySysexMessage(std::span<const uint8_t> msg);
 	void MixerCallBack(uint16_t requested_audio_frames);
 	void ProcessWorkFromFifo();
 
@@ -74,8 +76,8 @@ private:
 	FluidSynthPtr synth{nullptr, &delete_fluid_synth};
 
 	MixerChannelPtr mixer_channel = nullptr;
-	RWQueue<AudioFrame> audio_frame_fifo{1};
-	RWQueue<MidiWork> work_fifo{1};
+	SpscRWQueue<AudioFrame> audio_frame_fifo{1};
+	MidiWorkFifo work_fifo = {};
 	std::thread renderer = {};
 
 	std::string selected_font = "";
@@ -85,6 +87,16 @@ private:
 	double last_rendered_ms = 0.0;
 	double ms_per_audio_frame = 0.0;
 
+	// Rendering statistics, gathered by the renderer thread and reported
+	// by PrintStats() after it has stopped.
+	struct RenderStats {
+		int64_t render_us            = 0;
+		uint64_t num_renders         = 0;
+		uint64_t num_audio_frames    = 0;
+		uint64_t queued_audio_frames = 0;
+	};
+	RenderStats render_stats = {};
+
 	bool had_underruns = false;
 	bool is_open       = false;
 };
@@ -846,8 +846,9 @@ bool MidiHandler_mt32::Open([[maybe_unused]] const char* conf)
 
 	// We have measured DOS games sending hundreds of MIDI messages within a
 	// short handful of millseconds, so a safe but very generous upper bound
-	// is used (Note: the actual memory used by the FIFO is incremental
-	// based on actual usage).
+	// is used (Note: the FIFO allocates all of its slots up front, rounded
+	// up to a power of two, so this costs 16384 slots of a few bytes each,
+	// or about 160 KB).
 	static constexpr uint16_t midi_spec_max_msg_rate_hz = 1042;
 	work_fifo.Resize(midi_spec_max_msg_rate_hz * 10);
 
@@ -945,19 +946,13 @@ uint16_t MidiHandler_mt32::GetNumPendingAudioFrames()
 // The request to play the channel message is placed in the MIDI work FIFO
 void MidiHandler_mt32::PlayMsg(const MidiMessage& msg)
 {
-	std::vector<uint8_t> message(msg.data.begin(), msg.data.end());
-	MidiWork work{std::move(message),
-	              GetNumPendingAudioFrames(),
-	              MessageType::Channel};
-	work_fifo.Enqueue(std::move(work));
+	work_fifo.EnqueueMessage(msg, GetNumPendingAudioFrames());
 }
 
 // The request to play the sysex message is placed in the MIDI work FIFO
 void MidiHandler_mt32::PlaySysex(uint8_t* sysex, size_t len)
 {
-	std::vector<uint8_t> message(sysex, sysex + len);
-	MidiWork work{std::move(message), GetNumPendingAudioFrames(), MessageType::SysEx};
-	work_fifo.Enqueue(std::move(work));
+	work_fifo.EnqueueSysex(sysex, len, GetNumPendingAudioFrames());
 }
 
 // The callback operates at the audio frame-level, steadily adding samples to
@@ -980,11 +975,16 @@ void MidiHandler_mt32::MixerCallBack(const uint16_t requested_audio_frames)
 
 	static std::vector<AudioFrame> audio_frames = {};
 
-	const auto has_dequeued = audio_frame_fifo.BulkDequeue(audio_frames,
-	                                                       requested_audio_frames);
+	// Maybe expand the vector
+	if (audio_frames.size() < requested_audio_frames) {
+		audio_frames.resize(requested_audio_frames);
+	}
 
-	if (has_dequeued) {
-		assert(audio_frames.size() == requested_audio_frames);
+	const auto num_dequeued = audio_frame_fifo.BulkDequeue(
+	        {audio_frames.data(), requested_audio_frames});
+
+	// Only comes up short once the FIFO has been stopped
+	if (num_dequeued == requested_audio_frames) {
 		channel->AddSamples_sfloat(requested_audio_frames,
 		                           &audio_frames[0][0]);
 
@@ -1008,7 +1008,7 @@ void MidiHandler_mt32::RenderAudioFramesToFifo(const uint16_t num_frames)
 	service->renderFloat(&audio_frames[0][0], num_frames);
 	lock.unlock();
 
-	audio_frame_fifo.BulkEnqueue(audio_frames, num_frames);
+	audio_frame_fifo.BulkEnqueue({audio_frames.data(), num_frames});
 }
 
 // The next MIDI work task is processed, which includes rendering audio frames
@@ -1037,17 +1037,15 @@ void MidiHandler_mt32::ProcessWorkFromFifo()
 	const std::lock_guard<std::mutex> lock(service_mutex);
 
 	if (work->message_type == MessageType::Channel) {
-		assert(work->message.size() >= MaxMidiMessageLen);
-
-		const auto& data   = work->message.data();
+		const auto& data   = work->message.data;
 		const uint32_t msg = data[0] + (data[1] << 8) + (data[2] << 16);
 
 		service->playMsg(msg);
 	} else {
 		assert(work->message_type == MessageType::SysEx);
 
-		service->playSysex(work->message.data(),
-		                   static_cast<uint32_t>(work->message.size()));
+		const auto sysex = work_fifo.GetSysex();
+		service->playSysex(sysex.data(), static_cast<uint32_t>(sysex.size()));
 	}
 }
 
@@ -23,6 +23,7 @@
 
 #include "midi.h"
 #include "midi_handler.h"
+#include "midi_work_fifo.h"
 
 #if C_MT32EMU
 
@@ -85,8 +86,8 @@ private:
 
 	// Managed objects
 	MixerChannelPtr channel = nullptr;
-	RWQueue<AudioFrame> audio_frame_fifo{1};
-	RWQueue<MidiWork> work_fifo{1};
+	SpscRWQueue<AudioFrame> audio_frame_fifo{1};
+	MidiWorkFifo work_fifo = {};
 
 	std::mutex service_mutex = {};
 	Mt32ServicePtr service   = {};
@@ -0,0 +1,109 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "midi_work_fifo.h"
+
+#include <cassert>
+
+void MidiWorkFifo::Resize(const size_t queue_capacity)
+{
+	// Also drops the payloads left behind by stopping
+	work_queue.Resize(queue_capacity);
+	sysex_arena.Resize(SysexArenaSize);
+	sysex_size = 0;
+
+	work_queue.Start();
+	sysex_arena.Start();
+}
+
+bool MidiWorkFifo::IsEmpty() const
+{
+	return work_queue.IsEmpty();
+}
+
+bool MidiWorkFifo::IsRunning() const
+{
+	return work_queue.IsRunning();
+}
+
+size_t MidiWorkFifo::Size() const
+{
+	return work_queue.Size();
+}
+
+void MidiWorkFifo::Stop()
+{
+	work_queue.Stop();
+	sysex_arena.Stop();
+}
+
+bool MidiWorkFifo::EnqueueMessage(const MidiMessage& msg,
+                                  const uint16_t num_pending_audio_frames)
+{
+	MidiWork work = {};
+
+	work.message                  = msg;
+	work.num_pending_audio_frames = num_pending_audio_frames;
+	work.message_type             = MessageType::Channel;
+
+	return work_queue.Enqueue(std::move(work));
+}
+
+bool MidiWorkFifo::EnqueueSysex(uint8_t* sysex, const size_t len,
+                                const uint16_t num_pending_audio_frames)
+{
+	assert(sysex);
+	assert(len <= MIDI_SYSEX_SIZE);
+
+	// The arena only fills up when the renderer falls behind by several
+	// large SysEx messages, in which case we sleep until it has read enough
+	// of their payloads
+	if (!sysex_arena.BulkEnqueue({sysex, len})) {
+		return false;
+	}
+
+	MidiWork work = {};
+
+	work.sysex_size               = static_cast<uint16_t>(len);
+	work.num_pending_audio_frames = num_pending_audio_frames;
+	work.message_type             = MessageType::SysEx;
+
+	return work_queue.Enqueue(std::move(work));
+}
+
+std::optional<MidiWork> MidiWorkFifo::Dequeue()
+{
+	auto work = work_queue.Dequeue();
+
+	if (work && work->message_type == MessageType::SysEx) {
+		// The payload was written to the arena before its work was
+		// queued, so it's always there in full
+		sysex_size = sysex_arena.NonblockingBulkDequeue(
+		        {sysex_buffer.data(), work->sysex_size});
+		assert(sysex_size == work->sysex_size);
+	}
+	return work;
+}
+
+std::span<const uint8_t> MidiWorkFifo::GetSysex() const
+{
+	return {sysex_buffer.data(), sysex_size};
+}
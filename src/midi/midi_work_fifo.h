@@ -0,0 +1,93 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DOSBOX_MIDI_WORK_FIFO_H
+#define DOSBOX_MIDI_WORK_FIFO_H
+
+#include "midi.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "rwqueue.h"
+
+// Carries MIDI work from the emulation thread to a synth's render thread
+// without allocating.
+//
+// Channel messages travel inline in the queued MidiWork items. SysEx payloads
+// are streamed through a fixed byte arena ahead of their work item, so by the
+// time the renderer dequeues the item the payload is waiting in the arena in
+// the same order. The renderer reads it into a reusable buffer, available via
+// GetSysex() until the next Dequeue().
+//
+// Like its queues, there must be exactly one producer and one consumer thread.
+//
+// Once stopped, SysEx payloads whose work couldn't be queued may be left in
+// the arena, so the FIFO can only be restarted by resizing it, which discards
+// them.
+//
+class MidiWorkFifo {
+public:
+	MidiWorkFifo() = default;
+
+	MidiWorkFifo(const MidiWorkFifo&)            = delete;
+	MidiWorkFifo& operator=(const MidiWorkFifo&) = delete;
+
+	// Drops any queued work and (re)starts the FIFO; only call while neither
+	// thread is active
+	void Resize(const size_t queue_capacity);
+
+	bool IsEmpty() const;
+	bool IsRunning() const;
+	size_t Size() const;
+	void Stop();
+
+	// Producer side; potentially blocks until there's room. Returns false
+	// without queueing the message if queueing has stopped.
+	bool EnqueueMessage(const MidiMessage& msg,
+	                    const uint16_t num_pending_audio_frames);
+
+	// The payload's bytes are moved into the arena, which leaves them as
+	// they were.
+	bool EnqueueSysex(uint8_t* sysex, const size_t len,
+	                  const uint16_t num_pending_audio_frames);
+
+	// Consumer side; potentially blocks until work is available. The
+	// payload of dequeued SysEx work is returned by GetSysex().
+	std::optional<MidiWork> Dequeue();
+
+	std::span<const uint8_t> GetSysex() const;
+
+private:
+	// Room for several maximum-sized SysEx messages in flight
+	static constexpr size_t SysexArenaSize = 64 * 1024;
+	static_assert(SysexArenaSize >= MIDI_SYSEX_SIZE);
+
+	SpscRWQueue<MidiWork> work_queue{1};
+	SpscRWQueue<uint8_t> sysex_arena{SysexArenaSize};
+
+	std::array<uint8_t, MIDI_SYSEX_SIZE> sysex_buffer = {};
+	size_t sysex_size                                 = 0;
+};
+
+#endif // DOSBOX_MIDI_WORK_FIFO_H
@@ -25,8 +25,19 @@
 #include "control.h"
 #include "ethernet_slirp.h"
 
+static EthernetConnectionFactory connection_factory = {};
+
+void ETHERNET_SetConnectionFactory(EthernetConnectionFactory factory)
+{
+	connection_factory = std::move(factory);
+}
+
 EthernetConnection *ETHERNET_OpenConnection([[maybe_unused]] const std::string &backend)
 {
+	if (connection_factory) {
+		return connection_factory();
+	}
+
 	EthernetConnection *conn = nullptr;
 #if C_SLIRP
 	// Currently only slirp is supported
@@ -23,6 +23,7 @@
 #if C_SLIRP
 
 #include <algorithm>
+#include <cinttypes>
 #include <map>
 #include <stdexcept>
 
@@ -30,6 +31,11 @@
 #include <sys/socket.h> // AF_INET
 #endif
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "dosbox.h"
 #include "ethernet_slirp.h"
 #include "setup.h"
@@ -129,7 +135,6 @@ SlirpEthernetConnection::SlirpEthernetConnection()
         : EthernetConnection(),
           config(),
           timers(),
-          get_packet_callback(),
           registered_fds(),
 #ifdef WIN32
           readfds(),
@@ -152,8 +157,13 @@ SlirpEthernetConnection::SlirpEthernetConnection()
 
 SlirpEthernetConnection::~SlirpEthernetConnection()
 {
-	if (slirp)
+	// libslirp isn't thread-safe, so the I/O thread must be gone first
+	StopIoThread();
+
+	if (slirp) {
+		LogStats();
 		slirp_cleanup(slirp);
+	}
 }
 
 bool SlirpEthernetConnection::Initialize(Section *dosbox_config)
@@ -172,9 +182,8 @@ bool SlirpEthernetConnection::Initialize(Section *dosbox_config)
 	config.disable_host_loopback = false;
 
 	// The maximum transmission and receive unit sizes.
-	constexpr auto ethernet_frame_size = 14 + 1500; // header + payload
-	config.if_mtu = ethernet_frame_size;
-	config.if_mru = ethernet_frame_size;
+	config.if_mtu = MaxFrameSize;
+	config.if_mru = MaxFrameSize;
 
 	config.enable_emu = 0; // buggy - keep this at 0
 	config.in_enabled = 1;
@@ -217,6 +226,10 @@ bool SlirpEthernetConnection::Initialize(Section *dosbox_config)
 		ClearPortForwards(is_udp, forwarded_udp_ports);
 		forwarded_udp_ports = SetupPortForwards(is_udp, section->Get_string("udp_port_forwards"));
 
+		if (!StartIoThread()) {
+			LOG_MSG("SLIRP: Failed to start the I/O thread");
+			return false;
+		}
 		LOG_MSG("SLIRP: Successfully initialized");
 		return true;
 	} else {
@@ -368,21 +381,34 @@ void SlirpEthernetConnection::SendPacket(const uint8_t *packet, int len)
 		            len, GetMTU());
 		return;
 	}
-	slirp_input(slirp, packet, len);
+	auto frame = tx_frames.GetWriteSlot();
+	if (!frame) {
+		++tx_stats.drops;
+		return;
+	}
+	frame->size = len;
+	std::copy_n(packet, len, frame->bytes.begin());
+	tx_frames.Push();
+
+	WakeIoThread();
 }
 
 void SlirpEthernetConnection::GetPackets(std::function<int(const uint8_t *, int)> callback)
 {
-	get_packet_callback = callback;
-	uint32_t timeout_ms = 0;
-	PollsClear();
-	PollsAddRegistered();
-	slirp_pollfds_fill(slirp, &timeout_ms, slirp_add_poll, this);
-	const bool poll_failed = !PollsPoll(timeout_ms);
-	slirp_pollfds_poll(slirp, poll_failed, slirp_get_revents, this);
-	TimersRun();
+	// Only hand over the frames that are already here; the I/O thread
+	// might keep adding more while we're at it
+	auto frames_to_get = rx_frames.Size();
+	while (frames_to_get--) {
+		const auto frame = rx_frames.Front();
+		assert(frame);
+		if (callback(frame->bytes.data(), frame->size) < 0) {
+			++rx_stats.drops;
+		}
+		rx_frames.Pop();
+	}
 }
 
+// Called on the I/O thread
 int SlirpEthernetConnection::ReceivePacket(const uint8_t *packet, int len)
 {
 	// sentinels
@@ -393,7 +419,139 @@ int SlirpEthernetConnection::ReceivePacket(const uint8_t *packet, int len)
 		            len, GetMRU());
 		return -1;
 	}
-	return get_packet_callback(packet, len);
+	auto frame = rx_frames.GetWriteSlot();
+	if (!frame) {
+		++rx_stats.drops;
+		return len;
+	}
+	frame->size = len;
+	std::copy_n(packet, len, frame->bytes.begin());
+	rx_frames.Push();
+
+	++rx_stats.packets;
+	rx_stats.bytes += static_cast<uint64_t>(len);
+	return len;
+}
+
+bool SlirpEthernetConnection::StartIoThread()
+{
+	assert(!is_io_thread_running);
+
+#ifndef WIN32
+	if (pipe(wakeup_fds) != 0) {
+		return false;
+	}
+	for (const auto fd : wakeup_fds) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+#endif
+	is_io_thread_running = true;
+	io_thread = std::thread(&SlirpEthernetConnection::RunIoThread, this);
+	return true;
+}
+
+void SlirpEthernetConnection::StopIoThread()
+{
+	if (!is_io_thread_running) {
+		return;
+	}
+	is_io_thread_running = false;
+
+#ifndef WIN32
+	// Make sure the thread doesn't sit out its full poll timeout
+	is_wakeup_pending = false;
+#endif
+	WakeIoThread();
+	io_thread.join();
+
+#ifndef WIN32
+	for (auto& fd : wakeup_fds) {
+		close(fd);
+		fd = -1;
+	}
+#endif
+}
+
+void SlirpEthernetConnection::WakeIoThread()
+{
+#ifndef WIN32
+	if (!is_wakeup_pending.exchange(true)) {
+		const uint8_t wakeup = 1;
+		[[maybe_unused]] const auto written = write(wakeup_fds[1],
+		                                            &wakeup,
+		                                            sizeof(wakeup));
+	}
+#endif
+}
+
+void SlirpEthernetConnection::SendQueuedFrames()
+{
+	while (const auto frame = tx_frames.Front()) {
+		slirp_input(slirp, frame->bytes.data(), frame->size);
+
+		++tx_stats.packets;
+		tx_stats.bytes += static_cast<uint64_t>(frame->size);
+
+		tx_frames.Pop();
+	}
+}
+
+void SlirpEthernetConnection::RunIoThread()
+{
+	// Upper bound on how long the thread sleeps when neither the host
+	// sockets nor the timers need attention. On Windows, nothing can wake
+	// up select() when the guest sends a frame, so we keep the delay to
+	// the resolution of the emulator's tick there.
+#ifdef WIN32
+	constexpr uint32_t MaxPollTimeoutMs = 1;
+#else
+	constexpr uint32_t MaxPollTimeoutMs = 100;
+#endif
+
+	while (is_io_thread_running) {
+		SendQueuedFrames();
+
+		auto timeout_ms = TimersGetTimeoutMs(MaxPollTimeoutMs);
+		PollsClear();
+
+#ifndef WIN32
+		constexpr auto WakeupPollIndex = 0;
+		PollAdd(wakeup_fds[0], SLIRP_POLL_IN);
+#endif
+		// libslirp adds every socket it's interested in with just the
+		// events it needs; any more would make poll() return at once
+		slirp_pollfds_fill(slirp, &timeout_ms, slirp_add_poll, this);
+
+		const bool poll_failed = !PollsPoll(timeout_ms);
+
+#ifndef WIN32
+		if (!poll_failed && (PollGetSlirpRevents(WakeupPollIndex) & SLIRP_POLL_IN)) {
+			uint8_t wakeups[64];
+			while (read(wakeup_fds[0], wakeups, sizeof(wakeups)) > 0) {
+			}
+
+			// Only re-arm the wake-up once the pipe is empty; a
+			// wake-up written in between would otherwise be drained
+			// while still marked as pending, silencing all later ones
+			is_wakeup_pending = false;
+		}
+#endif
+		slirp_pollfds_poll(slirp, poll_failed, slirp_get_revents, this);
+		TimersRun();
+	}
+}
+
+void SlirpEthernetConnection::LogStats() const
+{
+	LOG_MSG("SLIRP: Sent %" PRIu64 " packets (%" PRIu64 " bytes), dropped %" PRIu64,
+	        tx_stats.packets.load(),
+	        tx_stats.bytes.load(),
+	        tx_stats.drops.load());
+
+	LOG_MSG("SLIRP: Received %" PRIu64 " packets (%" PRIu64 " bytes), dropped %" PRIu64,
+	        rx_stats.packets.load(),
+	        rx_stats.bytes.load(),
+	        rx_stats.drops.load());
 }
 
 struct slirp_timer *SlirpEthernetConnection::TimerNew(SlirpTimerCb cb, void *cb_opaque)
@@ -437,6 +595,20 @@ void SlirpEthernetConnection::TimersClear()
 	timers.clear();
 }
 
+uint32_t SlirpEthernetConnection::TimersGetTimeoutMs(const uint32_t max_timeout_ms) const
+{
+	const int64_t now = slirp_clock_get_ns(nullptr);
+
+	int64_t timeout_ns = int64_t{max_timeout_ms} * 1'000'000;
+	for (const struct slirp_timer *timer : timers) {
+		if (timer->expires_ns) {
+			timeout_ns = std::min(timeout_ns, timer->expires_ns - now);
+		}
+	}
+	// Round up so we don't wake up just before the timer expires
+	return static_cast<uint32_t>(std::max(timeout_ns + 999'999, int64_t{0}) / 1'000'000);
+}
+
 void SlirpEthernetConnection::PollRegister(const int fd)
 {
 	// sentinel
@@ -458,13 +630,6 @@ void SlirpEthernetConnection::PollUnregister(const int fd)
 	registered_fds.erase(std::remove(registered_fds.begin(), registered_fds.end(), fd), registered_fds.end());
 }
 
-void SlirpEthernetConnection::PollsAddRegistered()
-{
-	for (const auto fd : registered_fds)
-		if (fd >= 0)
-			PollAdd(fd, SLIRP_POLL_IN | SLIRP_POLL_OUT);
-}
-
 /* Begin the bulk of the platform-specific code.
  * This mostly involves handling data structures and mapping
  * libslirp's view of our polling system to whatever we use
@@ -568,6 +733,13 @@ int SlirpEthernetConnection::PollAdd(int fd, int slirp_events)
 
 bool SlirpEthernetConnection::PollsPoll(uint32_t timeout_ms)
 {
+	// select() fails at once without any descriptors, so we wait out the
+	// timeout ourselves to not spin the I/O thread
+	if (readfds.fd_count == 0 && writefds.fd_count == 0 &&
+	    exceptfds.fd_count == 0) {
+		Delay(timeout_ms);
+		return false;
+	}
 	struct timeval timeout;
 	timeout.tv_sec = timeout_ms / 1000;
 	timeout.tv_usec = (timeout_ms % 1000) * 1000;
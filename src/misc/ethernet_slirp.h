@@ -25,8 +25,11 @@
 
 #if C_SLIRP
 
-#include <map>
+#include <array>
+#include <atomic>
 #include <deque>
+#include <map>
+#include <thread>
 #include <vector>
 
 // Specific unreleased slirp to work with MSVC
@@ -40,6 +43,7 @@
 
 #include "config.h"
 #include "ethernet.h"
+#include "spsc_queue.h"
 
 /*
  * libslirp really wants a poll() API, so we'll use that when we're
@@ -70,6 +74,12 @@ struct slirp_timer {
  * This backend uses a virtual Ethernet device. Only TCP, UDP and some ICMP
  * work over this interface. This is because libslirp terminates guest
  * connections during routing and passes them to sockets created in the host.
+ *
+ * libslirp runs on its own I/O thread, which does all the polling of the host
+ * sockets and runs libslirp's timers. Sent and received frames cross between
+ * the emulation thread and the I/O thread through lock-free queues, so
+ * SendPacket and GetPackets never make any system calls themselves (apart
+ * from waking up the I/O thread).
  */
 class SlirpEthernetConnection : public EthernetConnection {
 public:
@@ -88,6 +98,9 @@ public:
 	/* Called by libslirp when it has a packet for us */
 	int ReceivePacket(const uint8_t* packet, int len);
 
+	// Header + payload
+	static constexpr int MaxFrameSize = 14 + 1500;
+
 	// Used in callbacks to bounds-check packet lengths
 	int GetMTU() const
 	{
@@ -110,15 +123,23 @@ public:
 	void PollUnregister(int fd);
 
 private:
+	/* The I/O thread and the work it does */
+	bool StartIoThread();
+	void StopIoThread();
+	void RunIoThread();
+	void WakeIoThread();
+	void SendQueuedFrames();
+	void LogStats() const;
+
 	/* Runs and clears all the timers*/
 	void TimersRun();
 	void TimersClear();
+	uint32_t TimersGetTimeoutMs(const uint32_t max_timeout_ms) const;
 
 	void ClearPortForwards(const bool is_udp, std::map<int, int> &existing_port_forwards);
 	std::map<int, int> SetupPortForwards(const bool is_udp, const std::string &port_forward_rules);
 
 	/* Builds a list of descriptors and polls them */
-	void PollsAddRegistered();
 	void PollsClear();
 	bool PollsPoll(uint32_t timeout_ms);
 
@@ -127,15 +148,39 @@ private:
 	SlirpCb slirp_callbacks = {};  /*!< Callbacks used by libslirp */
 	std::deque<struct slirp_timer *> timers = {}; /*!< Stored timers */
 
-	/** The GetPacket callback
-	 * When libslirp has a new packet for us it calls ReceivePacket,
-	 * but the EthernetConnection interface requires users to poll
-	 * for new packets using GetPackets. We temporarily store the
-	 * callback from GetPackets here for ReceivePacket.
-	 * This might seem racy, but keep in mind we control when
-	 * libslirp sends us packets via our polling system.
+	/** Frames in flight between the emulation and the I/O thread
+	 * Frames sent by the guest are queued by SendPacket for the I/O
+	 * thread to pass to libslirp, and frames libslirp has for the guest
+	 * are queued by ReceivePacket on the I/O thread for GetPackets.
+	 * Frames that don't fit into a full queue are dropped, just like a
+	 * real network would drop them.
 	 */
-	std::function<int(const uint8_t *, int)> get_packet_callback = nullptr;
+	struct Frame {
+		int size                                = 0;
+		std::array<uint8_t, MaxFrameSize> bytes = {};
+	};
+	static constexpr size_t FrameQueueSize = 256;
+
+	SpscQueue<Frame, FrameQueueSize> tx_frames = {};
+	SpscQueue<Frame, FrameQueueSize> rx_frames = {};
+
+	struct FrameStats {
+		std::atomic<uint64_t> packets = 0;
+		std::atomic<uint64_t> bytes   = 0;
+		std::atomic<uint64_t> drops   = 0;
+	};
+	FrameStats tx_stats = {};
+	FrameStats rx_stats = {}; /*!< Drops include frames the card had no room for */
+
+	std::thread io_thread                  = {};
+	std::atomic<bool> is_io_thread_running = false;
+
+#ifndef WIN32
+	/* Pipe to wake up the I/O thread from poll() when there are frames
+	 * to send; only written if there's no wake-up pending already */
+	int wakeup_fds[2]                   = {-1, -1};
+	std::atomic<bool> is_wakeup_pending = false;
+#endif
 
 	std::deque<int> registered_fds = {}; /*!< File descriptors to watch */
 
@@ -22,6 +22,7 @@
 
 #include "../capture/image/image_saver.h"
 
+#include <algorithm>
 #include <cassert>
 
 template <typename T>
@@ -255,19 +256,244 @@ bool RWQueue<T>::BulkDequeue(std::vector<T>& into_target, const size_t num_reque
 	return !into_target.empty();
 }
 
+// SPSC RW Queue
+// ~~~~~~~~~~~~~
+template <typename T>
+SpscRWQueue<T>::SpscRWQueue(size_t queue_capacity)
+{
+	Resize(queue_capacity);
+}
+
+// Any queued items are dropped
+template <typename T>
+void SpscRWQueue<T>::Resize(size_t queue_capacity)
+{
+	ring.Resize(queue_capacity);
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::Size() const
+{
+	return ring.Size();
+}
+
+template <typename T>
+bool SpscRWQueue<T>::IsEmpty() const
+{
+	return ring.IsEmpty();
+}
+
+template <typename T>
+bool SpscRWQueue<T>::IsRunning() const
+{
+	return is_running;
+}
+
+template <typename T>
+void SpscRWQueue<T>::Start()
+{
+	is_running = true;
+}
+
+template <typename T>
+void SpscRWQueue<T>::Stop()
+{
+	if (!is_running.exchange(false)) {
+		return;
+	}
+	// wake up both sides, regardless of what they're waiting for
+	++has_items_signal;
+	has_items_signal.notify_all();
+
+	++has_room_signal;
+	has_room_signal.notify_all();
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::MaxCapacity() const
+{
+	return ring.GetCapacity();
+}
+
+template <typename T>
+float SpscRWQueue<T>::GetPercentFull() const
+{
+	const auto cur_level = static_cast<float>(Size());
+	const auto max_level = static_cast<float>(ring.GetCapacity());
+	return (100.0f * cur_level) / max_level;
+}
+
+// A waiting side publishes how many items (or how much room) it needs before
+// checking the queue a final time, while the other side updates its position
+// before checking what's needed. As these are all sequentially consistent,
+// at least one of them sees the other's update, so a wake-up is never lost.
+// The waker only bumps the signal (and makes the syscall) when the sleeper's
+// need is actually met, and claims the need so it wakes the sleeper just
+// once.
+
+template <typename T>
+size_t SpscRWQueue<T>::WaitForItems(const size_t num_wanted)
+{
+	auto num_available = Size();
+
+	while (num_available < num_wanted && is_running) {
+		const auto signal = has_items_signal.load();
+
+		num_items_wanted.store(num_wanted);
+
+		if (ring.GetNumQueued() < num_wanted && is_running) {
+			has_items_signal.wait(signal);
+		}
+		num_items_wanted.store(0);
+
+		num_available = Size();
+	}
+	return num_available;
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::WaitForRoom(const size_t num_wanted)
+{
+	auto num_free = ring.GetFreeSpace();
+
+	while (num_free < num_wanted && is_running) {
+		const auto signal = has_room_signal.load();
+
+		room_wanted.store(num_wanted);
+
+		if (ring.GetFreeSpace() < num_wanted && is_running) {
+			has_room_signal.wait(signal);
+		}
+		room_wanted.store(0);
+
+		num_free = ring.GetFreeSpace();
+	}
+	return num_free;
+}
+
+template <typename T>
+void SpscRWQueue<T>::NotifyItems()
+{
+	const auto num_wanted = num_items_wanted.load();
+	if (num_wanted > 0 && Size() >= num_wanted && num_items_wanted.exchange(0) > 0) {
+		++has_items_signal;
+		has_items_signal.notify_one();
+	}
+}
+
+template <typename T>
+void SpscRWQueue<T>::NotifyRoom()
+{
+	const auto num_wanted = room_wanted.load();
+	if (num_wanted > 0 && ring.GetCapacity() - Size() >= num_wanted &&
+	    room_wanted.exchange(0) > 0) {
+		++has_room_signal;
+		has_room_signal.notify_one();
+	}
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::NonblockingBulkEnqueue(std::span<T> from_source)
+{
+	const auto num_items = ring.Write(std::make_move_iterator(from_source.begin()),
+	                                  from_source.size());
+	if (num_items > 0) {
+		NotifyItems();
+	}
+	return num_items;
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::NonblockingBulkDequeue(std::span<T> into_target)
+{
+	const auto num_items = ring.Read(into_target.begin(), into_target.size());
+	if (num_items > 0) {
+		NotifyRoom();
+	}
+	return num_items;
+}
+
+template <typename T>
+bool SpscRWQueue<T>::Enqueue(T&& item)
+{
+	WaitForRoom(1);
+	if (!is_running) {
+		return false;
+	}
+	NonblockingBulkEnqueue(std::span<T>(&item, 1));
+	return true;
+}
+
+template <typename T>
+std::optional<T> SpscRWQueue<T>::Dequeue()
+{
+	// Even if the queue has stopped, we need to drain the (previously)
+	// queued items before we're done.
+	if (WaitForItems(1) == 0) {
+		return {};
+	}
+	auto optional_item = std::optional<T>(std::move(*ring.Front()));
+
+	ring.Pop();
+	NotifyRoom();
+	return optional_item;
+}
+
+// The producer only ever waits for room for a single item while the consumer
+// waits for as many items as it needs (up to the capacity). This way both
+// can't be waiting on each other at the same time.
+
+template <typename T>
+bool SpscRWQueue<T>::BulkEnqueue(std::span<T> from_source)
+{
+	size_t num_queued = 0;
+	while (num_queued < from_source.size()) {
+		WaitForRoom(1);
+		if (!is_running) {
+			return false;
+		}
+		num_queued += NonblockingBulkEnqueue(from_source.subspan(num_queued));
+	}
+	return is_running;
+}
+
+template <typename T>
+size_t SpscRWQueue<T>::BulkDequeue(std::span<T> into_target)
+{
+	size_t num_dequeued = 0;
+	while (num_dequeued < into_target.size()) {
+		const auto num_wanted = std::min(into_target.size() - num_dequeued,
+		                                 ring.GetCapacity());
+
+		// Once stopped and drained, we're done
+		if (WaitForItems(num_wanted) == 0) {
+			break;
+		}
+		num_dequeued += NonblockingBulkDequeue(
+		        into_target.subspan(num_dequeued));
+	}
+	return num_dequeued;
+}
+
 // Explicit template instantiations
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #include <vector>
 // Unit tests
 template class RWQueue<int>;
 template class RWQueue<std::vector<int16_t>>;
+template class SpscRWQueue<int>;
+template class SpscRWQueue<std::vector<int16_t>>;
 
-// FluidSynth and MT-32
+// CD-DA
 #include "audio_frame.h"
 template class RWQueue<AudioFrame>;
 
+// FluidSynth and MT-32
+template class SpscRWQueue<AudioFrame>;
+
 #include "midi.h"
-template class RWQueue<MidiWork>;
+template class SpscRWQueue<MidiWork>;
+template class SpscRWQueue<uint8_t>;
 
 #include "render.h"
-template class RWQueue<SaveImageTask>;
+template class SpscRWQueue<SaveImageTask>;
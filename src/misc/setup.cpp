@@ -1901,7 +1901,9 @@ void Config::ParseArguments()
 	arguments.list_glshaders = cmdline->FindRemoveBoolArgument("list-glshaders");
 	arguments.noconsole   = cmdline->FindRemoveBoolArgument("noconsole");
 	arguments.startmapper = cmdline->FindRemoveBoolArgument("startmapper");
-	arguments.exit        = cmdline->FindRemoveBoolArgument("exit");
+	arguments.headless    = cmdline->FindRemoveBoolArgument("headless");
+	arguments.exit        = cmdline->FindRemoveBoolArgument("exit") ||
+	                        arguments.headless;
 	arguments.securemode = cmdline->FindRemoveBoolArgument("securemode");
 	arguments.noautoexec = cmdline->FindRemoveBoolArgument("noautoexec");
 
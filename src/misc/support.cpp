@@ -273,15 +273,25 @@ int64_t stdio_num_sectors(FILE* f)
 	return stdio_size_with_divisor(f, 512L);
 }
 
-const std_fs::path &GetExecutablePath()
+const std_fs::path &GetExecutableFilePath()
 {
-	static std_fs::path exe_path;
-	if (exe_path.empty()) {
+	static std_fs::path exe_file_path;
+	if (exe_file_path.empty()) {
 		int length = wai_getExecutablePath(nullptr, 0, nullptr);
 		std::string s;
 		s.resize(check_cast<uint16_t>(length));
 		wai_getExecutablePath(&s[0], length, nullptr);
-		exe_path = std_fs::path(s).parent_path();
+		exe_file_path = std_fs::path(s);
+		assert(!exe_file_path.empty());
+	}
+	return exe_file_path;
+}
+
+const std_fs::path &GetExecutablePath()
+{
+	static std_fs::path exe_path;
+	if (exe_path.empty()) {
+		exe_path = GetExecutableFilePath().parent_path();
 		assert(!exe_path.empty());
 	}
 	return exe_path;
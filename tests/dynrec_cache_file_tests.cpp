@@ -0,0 +1,183 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "../src/cpu/dynrec_cache_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr uint64_t BuildId       = 0x1234'5678'9abc'def0;
+constexpr size_t MaxBlocks       = 16;
+constexpr size_t MaxCodeSize     = 8192;
+constexpr int64_t TranslateNs    = 4321;
+constexpr uint8_t HostCodeMarker = 0xa5;
+
+StoredBlock make_block(const uint16_t page_start, const uint8_t seed)
+{
+	StoredBlock stored = {};
+
+	stored.guest_code = {0xb8, seed, 0x00, 0x40, 0xc3};
+
+	const auto guest_size = stored.guest_code.size();
+
+	stored.page_start = page_start;
+	stored.page_end   = static_cast<uint16_t>(page_start + guest_size - 1);
+	stored.code_hash  = hash_bytes(stored.guest_code.data(), guest_size);
+
+	stored.host_code.assign(64, HostCodeMarker);
+	stored.host_code[0] = seed;
+
+	stored.relocs.push_back({2, RelocForm::Abs64, RelocBase::Image, 0, 0x1000});
+	stored.relocs.push_back({20, RelocForm::Rel32, RelocBase::Block, 4, -16});
+	return stored;
+}
+
+class DynrecCacheFile : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		blocks.emplace((uint64_t{3} << 32) | 0x1'0010, make_block(0x10, 1));
+		blocks.emplace((uint64_t{3} << 32) | 0x2'0ff0, make_block(0xff0, 2));
+		blocks.emplace((uint64_t{7} << 32) | 0x1'0010, make_block(0x10, 3));
+	}
+
+	void TearDown() override
+	{
+		std::error_code ec = {};
+		std_fs::remove(path, ec);
+	}
+
+	std::vector<char> ReadFile() const
+	{
+		std::ifstream file(path, std::ios::binary);
+		return {std::istreambuf_iterator<char>(file), {}};
+	}
+
+	void WriteFile(const std::vector<char>& data) const
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+	}
+
+	DynrecCacheLoadResult Load(const uint64_t build_id = BuildId)
+	{
+		return load_dynrec_cache(
+		        path, build_id, MaxBlocks, MaxCodeSize, loaded, translate_ns);
+	}
+
+	const std_fs::path path = std_fs::temp_directory_path() /
+	                          "dosbox_dynrec_cache_test.bin";
+
+	StoredBlocks blocks  = {};
+	StoredBlocks loaded  = {};
+	int64_t translate_ns = 0;
+};
+
+TEST_F(DynrecCacheFile, RoundTrip)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	ASSERT_EQ(Load(), DynrecCacheLoadResult::Loaded);
+	EXPECT_EQ(translate_ns, TranslateNs);
+	EXPECT_EQ(loaded, blocks);
+}
+
+TEST_F(DynrecCacheFile, NoFile)
+{
+	EXPECT_EQ(Load(), DynrecCacheLoadResult::NoFile);
+	EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(DynrecCacheFile, IgnoresOtherBuild)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	EXPECT_EQ(Load(BuildId + 1), DynrecCacheLoadResult::OtherBuild);
+	EXPECT_TRUE(loaded.empty());
+	EXPECT_EQ(translate_ns, 0);
+
+	// It's still valid for its own build
+	EXPECT_TRUE(std_fs::exists(path));
+}
+
+TEST_F(DynrecCacheFile, RejectsCorruptedHostCode)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	auto data = ReadFile();
+	const auto marker = std::find(data.begin(),
+	                              data.end(),
+	                              static_cast<char>(HostCodeMarker));
+	ASSERT_NE(marker, data.end());
+	*marker ^= 0x40;
+	WriteFile(data);
+
+	EXPECT_EQ(Load(), DynrecCacheLoadResult::Corrupt);
+	EXPECT_TRUE(loaded.empty());
+	EXPECT_FALSE(std_fs::exists(path));
+}
+
+TEST_F(DynrecCacheFile, RejectsCorruptedRelocation)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	// The file ends with the addend of the last block's last relocation
+	auto data = ReadFile();
+	data.back() ^= 0x01;
+	WriteFile(data);
+
+	EXPECT_EQ(Load(), DynrecCacheLoadResult::Corrupt);
+	EXPECT_TRUE(loaded.empty());
+	EXPECT_FALSE(std_fs::exists(path));
+}
+
+TEST_F(DynrecCacheFile, RejectsTruncatedFile)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	const auto data = ReadFile();
+	for (const auto size : {size_t{4}, data.size() / 2, data.size() - 1}) {
+		WriteFile({data.begin(), data.begin() + static_cast<ptrdiff_t>(size)});
+
+		EXPECT_EQ(Load(), DynrecCacheLoadResult::Corrupt);
+		EXPECT_TRUE(loaded.empty());
+		EXPECT_FALSE(std_fs::exists(path));
+	}
+}
+
+TEST_F(DynrecCacheFile, RejectsTrailingData)
+{
+	ASSERT_TRUE(save_dynrec_cache(path, BuildId, TranslateNs, blocks));
+
+	auto data = ReadFile();
+	data.push_back(0);
+	WriteFile(data);
+
+	EXPECT_EQ(Load(), DynrecCacheLoadResult::Corrupt);
+	EXPECT_TRUE(loaded.empty());
+}
+
+} // namespace
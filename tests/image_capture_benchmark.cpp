@@ -0,0 +1,169 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the throughput of upscaled PNG image captures, written row by row
+// on a single thread versus in parallel bands.
+// Run with: meson test --benchmark -C <build-dir> --verbose
+
+#include "../src/capture/image/image_scaler.h"
+#include "../src/capture/image/png_writer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr int num_images = 10;
+
+struct TestImage {
+	std::vector<uint8_t> pixels  = {};
+	std::vector<uint8_t> palette = {};
+
+	RenderedImage image = {};
+};
+
+// A paletted image with gradients and dithering, roughly like typical DOS
+// game graphics
+void make_test_image(TestImage& test_image, const uint16_t width,
+                     const uint16_t height, const Fraction& pixel_aspect_ratio)
+{
+	test_image.pixels.resize(static_cast<size_t>(width) * height);
+	for (auto y = 0; y < height; ++y) {
+		for (auto x = 0; x < width; ++x) {
+			const auto dither = ((x ^ y) & 1) * 16;
+			test_image.pixels[y * width + x] = static_cast<uint8_t>(
+			        (x / 8 + y / 4 + dither) & 0xff);
+		}
+	}
+
+	test_image.palette.resize(256 * 4);
+	for (auto i = 0; i < 256; ++i) {
+		test_image.palette[i * 4 + 0] = static_cast<uint8_t>(i);
+		test_image.palette[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+		test_image.palette[i * 4 + 2] = static_cast<uint8_t>(i * 3);
+	}
+
+	auto& image = test_image.image;
+
+	image.params.width              = width;
+	image.params.height             = height;
+	image.params.pixel_aspect_ratio = pixel_aspect_ratio;
+	image.params.pixel_format       = PixelFormat::Indexed8;
+
+	image.params.video_mode.width              = width;
+	image.params.video_mode.height             = height;
+	image.params.video_mode.pixel_aspect_ratio = pixel_aspect_ratio;
+	image.params.video_mode.is_graphics_mode   = true;
+
+	image.pitch        = width;
+	image.image_data   = test_image.pixels.data();
+	image.palette_data = test_image.palette.data();
+}
+
+bool init_png_writer(PngWriter& png_writer, FILE* outfile,
+                     const ImageScaler& image_scaler, const RenderedImage& image)
+{
+	const auto width  = image_scaler.GetOutputWidth();
+	const auto height = image_scaler.GetOutputHeight();
+
+	if (image_scaler.GetOutputPixelFormat() == OutputPixelFormat::Indexed8) {
+		return png_writer.InitIndexed8(outfile,
+		                               width,
+		                               height,
+		                               Fraction{1},
+		                               image.params.video_mode,
+		                               image.palette_data);
+	}
+	return png_writer.InitRgb888(
+	        outfile, width, height, Fraction{1}, image.params.video_mode);
+}
+
+void write_serial(FILE* outfile, const RenderedImage& image)
+{
+	PngWriter png_writer     = {};
+	ImageScaler image_scaler = {};
+	image_scaler.Init(image);
+
+	ASSERT_TRUE(init_png_writer(png_writer, outfile, image_scaler, image));
+
+	auto rows_to_write = image_scaler.GetOutputHeight();
+	while (rows_to_write--) {
+		png_writer.WriteRow(image_scaler.GetNextOutputRow());
+	}
+}
+
+void write_in_bands(FILE* outfile, const RenderedImage& image)
+{
+	PngWriter png_writer     = {};
+	ImageScaler image_scaler = {};
+	image_scaler.Init(image);
+
+	ASSERT_TRUE(init_png_writer(png_writer, outfile, image_scaler, image));
+
+	png_writer.WriteScaledRowsInBands(image,
+	                                  image_scaler.GetOutputRowsPerInputRow());
+}
+
+template <typename Func>
+void measure(const char* name, const RenderedImage& image, Func&& write_png)
+{
+	long file_size = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < num_images; ++i) {
+		FILE* outfile = std::tmpfile();
+		ASSERT_NE(outfile, nullptr);
+
+		write_png(outfile, image);
+
+		file_size = std::ftell(outfile);
+		std::fclose(outfile);
+	}
+	const auto seconds = std::chrono::duration<double>(
+	                             std::chrono::steady_clock::now() - start)
+	                             .count();
+
+	std::printf("%-36s %8.1f images/s %8ld KB\n",
+	            name,
+	            num_images / seconds,
+	            file_size / 1024);
+}
+
+TEST(image_capture_benchmark, upscaled_png_throughput)
+{
+	// Integer upscaling, written as a paletted PNG (320x200 to 1600x1200)
+	TestImage mode_13h = {};
+	make_test_image(mode_13h, 320, 200, Fraction{5, 6});
+
+	measure("320x200, serial", mode_13h.image, write_serial);
+	measure("320x200, in bands", mode_13h.image, write_in_bands);
+
+	// Sharp-bilinear upscaling, written as an RGB PNG (640x350 to 1400x1050)
+	TestImage ega_350 = {};
+	make_test_image(ega_350, 640, 350, Fraction{35, 48});
+
+	measure("640x350, serial", ega_350.image, write_serial);
+	measure("640x350, in bands", ega_350.image, write_in_bands);
+}
+
+} // namespace
@@ -0,0 +1,114 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the port dispatch throughput of the IO handler containers.
+// Run with: meson test --benchmark -C <build-dir> --verbose
+
+#include "../src/hardware/iohandler_containers.cpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr int num_accesses = 20'000'000;
+
+// Ports typical of register banging: the VGA CRTC index/data pair, the SB
+// DSP status port, and the IDE data port
+constexpr io_port_t crtc_port     = 0x3d4;
+constexpr io_port_t sb_dsp_port   = 0x22e;
+constexpr io_port_t ide_data_port = 0x1f0;
+
+uint8_t crtc_regs[2] = {};
+
+io_val_t read_crtc(io_port_t port, io_width_t)
+{
+	return crtc_regs[port - crtc_port];
+}
+
+void write_crtc(io_port_t port, io_val_t val, io_width_t)
+{
+	crtc_regs[port - crtc_port] = static_cast<uint8_t>(val);
+}
+
+void report(const char* name, const std::chrono::steady_clock::duration elapsed)
+{
+	const auto seconds = std::chrono::duration<double>(elapsed).count();
+	std::printf("%-36s %8.1f M accesses/s\n",
+	            name,
+	            num_accesses / seconds / 1'000'000);
+}
+
+template <typename Func>
+void measure(const char* name, Func&& access)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < num_accesses; ++i) {
+		access(i);
+	}
+	report(name, std::chrono::steady_clock::now() - start);
+}
+
+TEST(iohandler_containers_benchmark, port_throughput)
+{
+	IO_RegisterReadHandler(crtc_port, read_crtc, io_width_t::byte, 2);
+	IO_RegisterWriteHandler(crtc_port, write_crtc, io_width_t::byte, 2);
+
+	// Handlers bound to device state, like most devices register
+	uint32_t dsp_polls = 0;
+	IO_RegisterReadHandler(
+	        sb_dsp_port,
+	        [&](io_port_t, io_width_t) -> io_val_t { return ++dsp_polls & 0x80; },
+	        io_width_t::byte);
+
+	uint16_t ide_word = 0;
+	IO_RegisterReadHandler(
+	        ide_data_port,
+	        [&](io_port_t, io_width_t) -> io_val_t { return ide_word++; },
+	        io_width_t::word);
+
+	measure("byte writes (plain function)", [](const int i) {
+		write_byte_to_port(crtc_port + (i & 1), static_cast<uint8_t>(i));
+	});
+
+	uint32_t sum = 0;
+	measure("byte reads (plain function)", [&](const int i) {
+		sum += read_byte_from_port(crtc_port + (i & 1));
+	});
+	measure("byte reads (capturing lambda)",
+	        [&](const int) { sum += read_byte_from_port(sb_dsp_port); });
+	measure("word reads (capturing lambda)",
+	        [&](const int) { sum += read_word_from_port(ide_data_port); });
+	measure("word reads (split into bytes)",
+	        [&](const int) { sum += read_word_from_port(crtc_port); });
+
+	EXPECT_EQ(dsp_polls, static_cast<uint32_t>(num_accesses));
+	EXPECT_NE(sum, 0u);
+
+	IO_FreeReadHandler(crtc_port, io_width_t::byte, 2);
+	IO_FreeWriteHandler(crtc_port, io_width_t::byte, 2);
+	IO_FreeReadHandler(sb_dsp_port, io_width_t::byte);
+	IO_FreeReadHandler(ide_data_port, io_width_t::word);
+}
+
+} // namespace
@@ -195,4 +195,180 @@ TEST(iohandler_containers, adjacent_dword_write)
 	EXPECT_EQ(read_word_from_port(word_port_start), val >> 16);
 }
 
+TEST(iohandler_containers, freed_handlers_block)
+{
+	constexpr io_port_t port = 0x1234;
+
+	IO_RegisterWriteHandler(port, write_word_new, io_width_t::word, 2);
+	IO_RegisterReadHandler(port, read_word_new, io_width_t::word, 2);
+
+	write_word_to_port(port, 0x5678);
+	EXPECT_EQ(read_word_from_port(port), 0x5678);
+	EXPECT_EQ(read_word_from_port(port + 1), 0x5678);
+
+	IO_FreeWriteHandler(port, io_width_t::word, 2);
+	IO_FreeReadHandler(port, io_width_t::word, 2);
+
+	EXPECT_EQ(io_read_handlers.Find(io_width_t::word, port), nullptr);
+	EXPECT_EQ(io_read_handlers.Find(io_width_t::byte, port + 1), nullptr);
+
+	// Freed ports are blocked again
+	write_word_to_port(port, 0x1111);
+	EXPECT_EQ(read_word_from_port(port), 0xffff);
+	EXPECT_EQ(word_val_new, 0x5678);
+}
+
+TEST(iohandler_containers, reregistered_handler_replaces)
+{
+	constexpr io_port_t port = 0x2345;
+
+	IO_RegisterReadHandler(port, read_byte_new, io_width_t::byte);
+	IO_RegisterReadHandler(port, read_word_new, io_width_t::byte);
+
+	word_val_new = 0x42;
+	byte_val_new = 0x24;
+	EXPECT_EQ(read_byte_from_port(port), 0x42);
+
+	IO_FreeReadHandler(port, io_width_t::byte);
+}
+
+TEST(iohandler_containers, range_shares_one_slot)
+{
+	constexpr io_port_t port  = 0x3456;
+	constexpr io_port_t range = 16;
+
+	IO_RegisterReadHandler(port, read_dword_new, io_width_t::dword, range);
+
+	const auto slot = io_read_handlers.Find(io_width_t::byte, port);
+	ASSERT_NE(slot, nullptr);
+	EXPECT_EQ(slot->num_ports, range * io_widths);
+
+	for (io_port_t p = port; p < port + range; ++p) {
+		EXPECT_EQ(io_read_handlers.Find(io_width_t::byte, p), slot);
+		EXPECT_EQ(io_read_handlers.Find(io_width_t::word, p), slot);
+		EXPECT_EQ(io_read_handlers.Find(io_width_t::dword, p), slot);
+	}
+	EXPECT_EQ(io_read_handlers.Find(io_width_t::byte, port + range), nullptr);
+
+	IO_FreeReadHandler(port, io_width_t::dword, range);
+	EXPECT_EQ(io_read_handlers.Find(io_width_t::byte, port), nullptr);
+}
+
+static io_val_t read_port_number(io_port_t port, io_width_t)
+{
+	return port & 0xff;
+}
+
+TEST(iohandler_containers, plain_function_called_directly)
+{
+	constexpr io_port_t port = 0x4567;
+
+	IO_RegisterReadHandler(port, read_port_number, io_width_t::byte);
+
+	const auto slot = io_read_handlers.Find(io_width_t::byte, port);
+	ASSERT_NE(slot, nullptr);
+	EXPECT_EQ(slot->function, &read_port_number);
+	EXPECT_EQ(read_byte_from_port(port), port & 0xff);
+
+	// Capturing handlers go through the std::function
+	constexpr uint8_t val = 0x99;
+	IO_RegisterReadHandler(port, [=](io_port_t, io_width_t) { return val; },
+	                       io_width_t::byte);
+
+	const auto lambda_slot = io_read_handlers.Find(io_width_t::byte, port);
+	ASSERT_NE(lambda_slot, nullptr);
+	EXPECT_EQ(lambda_slot->function, nullptr);
+	EXPECT_EQ(read_byte_from_port(port), val);
+
+	IO_FreeReadHandler(port, io_width_t::byte);
+}
+
+TEST(iohandler_containers, block_handlers)
+{
+	constexpr io_port_t port = 0x1f0;
+
+	uint8_t buffer[8] = {};
+
+	// Ports without a block handler move nothing
+	EXPECT_EQ(read_block_from_port(port, io_width_t::word, buffer, 4), 0u);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::word, buffer, 4), 0u);
+
+	// Block handlers need a regular handler to attach to
+	IO_RegisterBlockWriteHandler(port, [](io_port_t, io_width_t, const uint8_t*, size_t) {
+		return size_t{1};
+	});
+	EXPECT_EQ(write_block_to_port(port, io_width_t::word, buffer, 4), 0u);
+
+	IO_RegisterWriteHandler(port, write_word_new, io_width_t::word);
+	IO_RegisterReadHandler(port, read_word_new, io_width_t::word);
+
+	// Handlers may accept fewer units than requested
+	size_t units_written = 0;
+	IO_RegisterBlockWriteHandler(port,
+	                             [&](io_port_t, io_width_t, const uint8_t*, size_t num_units) {
+		                             units_written += num_units;
+		                             return num_units / 2;
+	                             });
+	IO_RegisterBlockReadHandler(port,
+	                            [](io_port_t, io_width_t width, uint8_t* dest, size_t num_units) {
+		                            const auto num_bytes = num_units *
+		                                                   static_cast<size_t>(width);
+		                            for (size_t i = 0; i < num_bytes; ++i) {
+			                            dest[i] = static_cast<uint8_t>(i);
+		                            }
+		                            return num_units;
+	                            });
+
+	EXPECT_EQ(write_block_to_port(port, io_width_t::word, buffer, 4), 2u);
+	EXPECT_EQ(units_written, 4u);
+
+	EXPECT_EQ(read_block_from_port(port, io_width_t::word, buffer, 4), 4u);
+	EXPECT_EQ(buffer[7], 7);
+
+	IO_FreeBlockWriteHandler(port);
+	IO_FreeBlockReadHandler(port);
+	EXPECT_EQ(read_block_from_port(port, io_width_t::word, buffer, 4), 0u);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::word, buffer, 4), 0u);
+
+	IO_FreeWriteHandler(port, io_width_t::word);
+	IO_FreeReadHandler(port, io_width_t::word);
+}
+
+TEST(iohandler_containers, block_handlers_follow_port_ownership)
+{
+	constexpr io_port_t port = 0x3c9;
+
+	uint8_t buffer[4] = {};
+
+	const auto block_write = [](io_port_t, io_width_t, const uint8_t*,
+	                            size_t num_units) { return num_units; };
+
+	// Freeing the regular handler drops the block handler
+	IO_RegisterWriteHandler(port, write_byte_new, io_width_t::byte);
+	IO_RegisterBlockWriteHandler(port, block_write);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::byte, buffer, 4), 4u);
+
+	IO_FreeWriteHandler(port, io_width_t::byte);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::byte, buffer, 4), 0u);
+
+	// The new owner of the port doesn't inherit the old block handler
+	IO_RegisterWriteHandler(port, write_byte_new, io_width_t::byte);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::byte, buffer, 4), 0u);
+
+	// Nor does it when it takes over the port from a live handler
+	IO_RegisterBlockWriteHandler(port, block_write);
+	IO_RegisterWriteHandler(port, write_word_new, io_width_t::byte);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::byte, buffer, 4), 0u);
+
+	// A block handler on one port of a range leaves the others alone
+	IO_RegisterWriteHandler(port, write_byte_new, io_width_t::byte, 2);
+	IO_RegisterBlockWriteHandler(port, block_write);
+	EXPECT_EQ(write_block_to_port(port + 1, io_width_t::byte, buffer, 4), 0u);
+
+	IO_FreeWriteHandler(port, io_width_t::byte);
+	EXPECT_EQ(write_block_to_port(port, io_width_t::byte, buffer, 4), 0u);
+
+	IO_FreeWriteHandler(port + 1, io_width_t::byte);
+}
+
 } // namespace
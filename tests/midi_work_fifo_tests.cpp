@@ -0,0 +1,224 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "../src/midi/midi_work_fifo.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Count the heap allocations made while counting is enabled, to check the
+// MIDI work path doesn't allocate. The default operator delete frees memory
+// from malloc() on all supported platforms, so it's left as is.
+static std::atomic<bool> is_counting_allocations = false;
+static std::atomic<int> num_allocations          = 0;
+
+void* operator new(const size_t size)
+{
+	if (is_counting_allocations) {
+		++num_allocations;
+	}
+	if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+namespace {
+
+constexpr size_t QueueCapacity = 64;
+
+std::vector<uint8_t> make_sysex(const size_t len, const uint8_t seed)
+{
+	std::vector<uint8_t> sysex(len);
+	for (size_t i = 0; i < len; ++i) {
+		sysex[i] = static_cast<uint8_t>(seed + i);
+	}
+	sysex.front() = MidiStatus::SystemExclusive;
+	sysex.back()  = MidiStatus::EndOfExclusive;
+	return sysex;
+}
+
+TEST(MidiWorkFifo, MessagesArriveInOrder)
+{
+	MidiWorkFifo fifo = {};
+	fifo.Resize(QueueCapacity);
+
+	const MidiMessage note_on  = {0x90, 60, 100};
+	const MidiMessage note_off = {0x80, 60, 0};
+	auto sysex                 = make_sysex(20, 7);
+
+	EXPECT_TRUE(fifo.EnqueueMessage(note_on, 1));
+	EXPECT_TRUE(fifo.EnqueueSysex(sysex.data(), sysex.size(), 2));
+	EXPECT_TRUE(fifo.EnqueueMessage(note_off, 3));
+	EXPECT_EQ(fifo.Size(), 3);
+
+	auto work = fifo.Dequeue();
+	ASSERT_TRUE(work);
+	EXPECT_EQ(work->message_type, MessageType::Channel);
+	EXPECT_EQ(work->message.data, note_on.data);
+	EXPECT_EQ(work->num_pending_audio_frames, 1);
+
+	work = fifo.Dequeue();
+	ASSERT_TRUE(work);
+	EXPECT_EQ(work->message_type, MessageType::SysEx);
+	EXPECT_EQ(work->num_pending_audio_frames, 2);
+
+	const auto payload = fifo.GetSysex();
+	EXPECT_EQ(std::vector<uint8_t>(payload.begin(), payload.end()), sysex);
+
+	work = fifo.Dequeue();
+	ASSERT_TRUE(work);
+	EXPECT_EQ(work->message_type, MessageType::Channel);
+	EXPECT_EQ(work->message.data, note_off.data);
+	EXPECT_EQ(work->num_pending_audio_frames, 3);
+
+	EXPECT_TRUE(fifo.IsEmpty());
+}
+
+TEST(MidiWorkFifo, StoppedFifoRejectsWork)
+{
+	MidiWorkFifo fifo = {};
+	fifo.Resize(QueueCapacity);
+
+	auto sysex = make_sysex(10, 0);
+
+	EXPECT_TRUE(fifo.EnqueueSysex(sysex.data(), sysex.size(), 0));
+	fifo.Stop();
+
+	EXPECT_FALSE(fifo.EnqueueMessage({0x90, 60, 100}, 0));
+	EXPECT_FALSE(fifo.EnqueueSysex(sysex.data(), sysex.size(), 0));
+
+	// Work queued before stopping is still handed out
+	const auto work = fifo.Dequeue();
+	ASSERT_TRUE(work);
+	EXPECT_EQ(fifo.GetSysex().size(), sysex.size());
+
+	EXPECT_FALSE(fifo.Dequeue());
+}
+
+TEST(MidiWorkFifo, StopWakesProducerWaitingForArena)
+{
+	MidiWorkFifo fifo = {};
+	fifo.Resize(QueueCapacity);
+
+	auto sysex = make_sysex(MIDI_SYSEX_SIZE, 5);
+
+	// Nothing is dequeued, so the producer fills the arena and then waits
+	// for room until it's stopped
+	std::atomic<bool> was_rejected = false;
+
+	std::thread producer([&] {
+		for (size_t i = 0; i < QueueCapacity; ++i) {
+			if (!fifo.EnqueueSysex(sysex.data(), sysex.size(), 0)) {
+				was_rejected = true;
+				return;
+			}
+		}
+	});
+
+	// The 64 KB arena holds eight maximum-sized payloads
+	while (fifo.Size() < 8) {
+		std::this_thread::yield();
+	}
+	fifo.Stop();
+	producer.join();
+
+	EXPECT_TRUE(was_rejected);
+
+	// Resizing discards what was left behind and restarts the FIFO
+	fifo.Resize(QueueCapacity);
+	EXPECT_TRUE(fifo.EnqueueSysex(sysex.data(), sysex.size(), 0));
+
+	ASSERT_TRUE(fifo.Dequeue());
+	EXPECT_EQ(fifo.GetSysex().size(), sysex.size());
+	EXPECT_EQ(fifo.GetSysex().front(), sysex.front());
+}
+
+TEST(MidiWorkFifo, DoesNotAllocate)
+{
+	MidiWorkFifo fifo = {};
+	fifo.Resize(QueueCapacity);
+
+	// Maximum-sized SysEx messages wrap around the arena many times
+	auto sysex = make_sysex(MIDI_SYSEX_SIZE, 3);
+
+	num_allocations         = 0;
+	is_counting_allocations = true;
+
+	for (int i = 0; i < 1000; ++i) {
+		const auto status = static_cast<uint8_t>(0x90 + i % 16);
+		fifo.EnqueueMessage({status, 60, 100}, 1);
+		fifo.EnqueueSysex(sysex.data(), sysex.size(), 0);
+		fifo.EnqueueMessage({status, 60, 0}, 1);
+
+		for (int j = 0; j < 3; ++j) {
+			[[maybe_unused]] const auto work = fifo.Dequeue();
+		}
+	}
+
+	is_counting_allocations = false;
+	EXPECT_EQ(num_allocations, 0);
+}
+
+TEST(MidiWorkFifo, ConcurrentWorkArrivesIntact)
+{
+	constexpr int NumRounds = 2000;
+
+	MidiWorkFifo fifo = {};
+	fifo.Resize(QueueCapacity);
+
+	std::thread producer([&] {
+		for (int i = 0; i < NumRounds; ++i) {
+			const auto seed = static_cast<uint8_t>(i);
+			const auto len  = 4 + static_cast<size_t>(i * 37) % (MIDI_SYSEX_SIZE - 4);
+
+			auto sysex = make_sysex(len, seed);
+			fifo.EnqueueMessage({0x90, seed, 100}, 0);
+			fifo.EnqueueSysex(sysex.data(), sysex.size(), 0);
+		}
+	});
+
+	for (int i = 0; i < NumRounds; ++i) {
+		const auto seed = static_cast<uint8_t>(i);
+		const auto len  = 4 + static_cast<size_t>(i * 37) % (MIDI_SYSEX_SIZE - 4);
+
+		auto work = fifo.Dequeue();
+		ASSERT_TRUE(work);
+		ASSERT_EQ(work->message_type, MessageType::Channel);
+		ASSERT_EQ(work->message[1], seed);
+
+		work = fifo.Dequeue();
+		ASSERT_TRUE(work);
+		ASSERT_EQ(work->message_type, MessageType::SysEx);
+
+		const auto payload = fifo.GetSysex();
+		ASSERT_EQ(std::vector<uint8_t>(payload.begin(), payload.end()),
+		          make_sysex(len, seed));
+	}
+	producer.join();
+}
+
+} // namespace
@@ -0,0 +1,411 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the NE2000's packet throughput with the card attached to a
+// loopback connection instead of a real backend, so no network access is
+// needed. The card is driven through its I/O ports the same way DOS packet
+// drivers do it: received frames are pulled out of the receive ring and
+// frames to send are pushed into the card's memory by remote DMA through the
+// data port. Emulated time advances one tick (1 ms) at a time, which is when
+// the card picks up incoming frames and completes transmissions.
+//
+// Run with: meson test --benchmark -C <build-dir> --verbose
+
+#include "config.h"
+
+#if C_SLIRP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "control.h"
+#include "ethernet.h"
+#include "inout.h"
+#include "pic.h"
+#include "timer.h"
+
+#include "dosbox_test_fixture.h"
+
+namespace {
+
+// Stands in for a real backend: frames the guest sends are collected, and
+// injected frames are handed to the card at a given number per tick
+class LoopbackEthernetConnection final : public EthernetConnection {
+public:
+	bool Initialize(Section*) override
+	{
+		return true;
+	}
+
+	void SendPacket(const uint8_t* packet, int size) override
+	{
+		++sent_frames;
+		sent_bytes += static_cast<uint64_t>(size);
+		last_sent_frame.assign(packet, packet + size);
+	}
+
+	void GetPackets(std::function<int(const uint8_t*, int)> callback) override
+	{
+		auto frames_to_get = frames_per_tick;
+		while (frames_to_get-- && !injected_frames.empty()) {
+			const auto& frame = injected_frames.front();
+			if (callback(frame.data(), static_cast<int>(frame.size())) < 0) {
+				++dropped_frames;
+			}
+			injected_frames.pop_front();
+		}
+	}
+
+	void Inject(const std::vector<uint8_t>& frame)
+	{
+		injected_frames.push_back(frame);
+	}
+
+	int frames_per_tick = 1;
+
+	std::deque<std::vector<uint8_t>> injected_frames = {};
+
+	uint64_t sent_frames    = 0;
+	uint64_t sent_bytes     = 0;
+	uint64_t dropped_frames = 0;
+
+	std::vector<uint8_t> last_sent_frame = {};
+};
+
+// Registers at the default base port
+constexpr io_port_t NicBase  = 0x300;
+constexpr io_port_t RegCr    = NicBase + 0x00;
+constexpr io_port_t RegData  = NicBase + 0x10;
+constexpr io_port_t RegReset = NicBase + 0x1f;
+
+// Page 0
+constexpr io_port_t RegPstart = NicBase + 0x01;
+constexpr io_port_t RegPstop  = NicBase + 0x02;
+constexpr io_port_t RegBnry   = NicBase + 0x03;
+constexpr io_port_t RegTpsr   = NicBase + 0x04;
+constexpr io_port_t RegTbcr0  = NicBase + 0x05;
+constexpr io_port_t RegTbcr1  = NicBase + 0x06;
+constexpr io_port_t RegIsr    = NicBase + 0x07;
+constexpr io_port_t RegRsar0  = NicBase + 0x08;
+constexpr io_port_t RegRsar1  = NicBase + 0x09;
+constexpr io_port_t RegRbcr0  = NicBase + 0x0a;
+constexpr io_port_t RegRbcr1  = NicBase + 0x0b;
+constexpr io_port_t RegRcr    = NicBase + 0x0c;
+constexpr io_port_t RegTcr    = NicBase + 0x0d;
+constexpr io_port_t RegDcr    = NicBase + 0x0e;
+constexpr io_port_t RegImr    = NicBase + 0x0f;
+
+// Page 1
+constexpr io_port_t RegCurr = NicBase + 0x07;
+
+// Command register bits
+constexpr uint8_t CrStop     = 0x01;
+constexpr uint8_t CrStart    = 0x02;
+constexpr uint8_t CrTransmit = 0x04;
+constexpr uint8_t CrDmaRead  = 0x08;
+constexpr uint8_t CrDmaWrite = 0x10;
+constexpr uint8_t CrDmaAbort = 0x20;
+constexpr uint8_t CrPage0    = 0x00;
+constexpr uint8_t CrPage1    = 0x40;
+
+// Interrupt status bits
+constexpr uint8_t IsrReceived    = 0x01;
+constexpr uint8_t IsrTransmitted = 0x02;
+constexpr uint8_t IsrDmaDone     = 0x40;
+
+// Memory layout, in 256-byte pages: a transmit buffer for one full frame,
+// followed by the receive ring up to the end of the card's memory
+constexpr uint8_t TxPage      = 0x40;
+constexpr uint8_t RxFirstPage = 0x46;
+constexpr uint8_t RxEndPage   = 0x80;
+
+constexpr int MinFrameSize = 60;
+constexpr int MaxFrameSize = 1514;
+
+class NE2000Benchmark : public DOSBoxTestFixture {
+public:
+	void SetUp() override
+	{
+		ETHERNET_SetConnectionFactory([this]() -> EthernetConnection* {
+			connection = new LoopbackEthernetConnection();
+			return connection;
+		});
+		DOSBoxTestFixture::SetUp();
+
+		control->GetSection("ethernet")->ExecuteInit();
+		ASSERT_NE(connection, nullptr);
+
+		InitCard();
+	}
+
+	void TearDown() override
+	{
+		// The card owns and deletes the connection
+		control->GetSection("ethernet")->ExecuteDestroy();
+		connection = nullptr;
+
+		ETHERNET_SetConnectionFactory({});
+		DOSBoxTestFixture::TearDown();
+	}
+
+protected:
+	// Same sequence as the usual DOS packet drivers
+	void InitCard()
+	{
+		IO_WriteB(RegReset, IO_ReadB(RegReset));
+
+		IO_WriteB(RegCr, CrPage0 | CrDmaAbort | CrStop);
+
+		// Word-wide DMA, normal operation (no loopback)
+		IO_WriteB(RegDcr, 0x49);
+		IO_WriteB(RegRbcr0, 0);
+		IO_WriteB(RegRbcr1, 0);
+
+		// Accept all frames; the frames we inject are for the card
+		// anyway, and this way we don't depend on the MAC address
+		IO_WriteB(RegRcr, 0x10);
+		IO_WriteB(RegTcr, 0x00);
+
+		IO_WriteB(RegTpsr, TxPage);
+		IO_WriteB(RegPstart, RxFirstPage);
+		IO_WriteB(RegPstop, RxEndPage);
+		IO_WriteB(RegBnry, RxFirstPage);
+
+		IO_WriteB(RegIsr, 0xff);
+
+		// Polled operation, as we have no CPU servicing interrupts
+		IO_WriteB(RegImr, 0x00);
+
+		IO_WriteB(RegCr, CrPage1 | CrDmaAbort | CrStop);
+		IO_WriteB(RegCurr, RxFirstPage + 1);
+
+		IO_WriteB(RegCr, CrPage0 | CrDmaAbort | CrStart);
+	}
+
+	// Advances emulated time by one tick, which runs the card's poller and
+	// any pending transmit-complete events
+	void AdvanceTick()
+	{
+		TIMER_AddTick();
+		PIC_RunQueue();
+	}
+
+	void SetRemoteDma(const uint16_t address, const uint16_t num_bytes)
+	{
+		IO_WriteB(RegRsar0, static_cast<uint8_t>(address & 0xff));
+		IO_WriteB(RegRsar1, static_cast<uint8_t>(address >> 8));
+		IO_WriteB(RegRbcr0, static_cast<uint8_t>(num_bytes & 0xff));
+		IO_WriteB(RegRbcr1, static_cast<uint8_t>(num_bytes >> 8));
+	}
+
+	void ReadRemote(const uint16_t address, uint8_t* out, const uint16_t num_bytes)
+	{
+		const uint16_t num_bytes_even = (num_bytes + 1) & ~1;
+		SetRemoteDma(address, num_bytes_even);
+		IO_WriteB(RegCr, CrPage0 | CrDmaRead | CrStart);
+
+		for (uint16_t i = 0; i < num_bytes_even; i += 2) {
+			const auto word = IO_ReadW(RegData);
+			out[i] = static_cast<uint8_t>(word & 0xff);
+			if (i + 1 < num_bytes) {
+				out[i + 1] = static_cast<uint8_t>(word >> 8);
+			}
+		}
+		IO_WriteB(RegIsr, IsrDmaDone);
+	}
+
+	// Takes all received frames out of the receive ring; returns their
+	// number
+	int ReceiveFrames(std::vector<uint8_t>& frame)
+	{
+		if (!(IO_ReadB(RegIsr) & IsrReceived)) {
+			return 0;
+		}
+		IO_WriteB(RegIsr, IsrReceived);
+
+		IO_WriteB(RegCr, CrPage1 | CrDmaAbort | CrStart);
+		const auto curr_page = IO_ReadB(RegCurr);
+		IO_WriteB(RegCr, CrPage0 | CrDmaAbort | CrStart);
+
+		auto num_frames = 0;
+
+		auto next_page = static_cast<uint8_t>(IO_ReadB(RegBnry) + 1);
+		if (next_page >= RxEndPage) {
+			next_page = RxFirstPage;
+		}
+		while (next_page != curr_page) {
+			uint8_t header[4] = {};
+			ReadRemote(static_cast<uint16_t>(next_page << 8), header, 4);
+
+			// The length includes the 4-byte CRC
+			const auto frame_size = static_cast<uint16_t>(
+			        (header[2] | (header[3] << 8)) - 4);
+
+			frame.resize(frame_size);
+			ReadRemote(static_cast<uint16_t>((next_page << 8) + 4),
+			           frame.data(),
+			           frame_size);
+			++num_frames;
+
+			next_page     = header[1];
+			auto boundary = static_cast<uint8_t>(next_page - 1);
+			if (boundary < RxFirstPage) {
+				boundary = RxEndPage - 1;
+			}
+			IO_WriteB(RegBnry, boundary);
+		}
+		return num_frames;
+	}
+
+	void SendFrame(const std::vector<uint8_t>& frame)
+	{
+		const auto frame_size = static_cast<uint16_t>(frame.size());
+
+		SetRemoteDma(TxPage << 8, frame_size);
+		IO_WriteB(RegCr, CrPage0 | CrDmaWrite | CrStart);
+
+		for (uint16_t i = 0; i < frame_size; i += 2) {
+			const uint8_t hi = (i + 1 < frame_size) ? frame[i + 1] : 0;
+			IO_WriteW(RegData, static_cast<uint16_t>(frame[i] | (hi << 8)));
+		}
+		IO_WriteB(RegIsr, IsrDmaDone);
+
+		IO_WriteB(RegTbcr0, static_cast<uint8_t>(frame_size & 0xff));
+		IO_WriteB(RegTbcr1, static_cast<uint8_t>(frame_size >> 8));
+		IO_WriteB(RegCr, CrPage0 | CrDmaAbort | CrTransmit | CrStart);
+	}
+
+	// Like drivers, wait for the previous frame to go out before sending
+	// the next one
+	void WaitForTransmit()
+	{
+		while (!(IO_ReadB(RegIsr) & IsrTransmitted)) {
+			AdvanceTick();
+		}
+		IO_WriteB(RegIsr, IsrTransmitted);
+	}
+
+	LoopbackEthernetConnection* connection = nullptr;
+};
+
+std::vector<uint8_t> make_frame(const int size, const int sequence)
+{
+	std::vector<uint8_t> frame(static_cast<size_t>(size));
+	for (size_t i = 0; i < frame.size(); ++i) {
+		frame[i] = static_cast<uint8_t>(i + sequence);
+	}
+	return frame;
+}
+
+void report(const char* name, const uint64_t num_frames, const uint64_t num_bytes,
+            const uint64_t num_drops,
+            const std::chrono::steady_clock::duration elapsed)
+{
+	const auto seconds = std::chrono::duration<double>(elapsed).count();
+	std::printf("%-36s %9.0f frames/s %7.1f MB/s %6llu dropped\n",
+	            name,
+	            static_cast<double>(num_frames) / seconds,
+	            static_cast<double>(num_bytes) / seconds / (1024 * 1024),
+	            static_cast<unsigned long long>(num_drops));
+}
+
+constexpr int num_frames = 20'000;
+
+TEST_F(NE2000Benchmark, ReceiveThroughput)
+{
+	for (const auto frame_size : {MinFrameSize, MaxFrameSize}) {
+		for (const auto frames_per_tick : {1, 4, 16}) {
+			connection->frames_per_tick = frames_per_tick;
+			connection->dropped_frames  = 0;
+
+			for (auto i = 0; i < num_frames; ++i) {
+				connection->Inject(make_frame(frame_size, i));
+			}
+
+			std::vector<uint8_t> frame = {};
+			uint64_t received_frames   = 0;
+			uint64_t received_bytes    = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			while (!connection->injected_frames.empty()) {
+				AdvanceTick();
+				const auto n = ReceiveFrames(frame);
+				received_frames += static_cast<uint64_t>(n);
+				received_bytes += static_cast<uint64_t>(n) * frame.size();
+			}
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+
+			EXPECT_EQ(received_frames + connection->dropped_frames,
+			          static_cast<uint64_t>(num_frames));
+			if (connection->dropped_frames == 0) {
+				EXPECT_EQ(frame, make_frame(frame_size, num_frames - 1));
+			}
+
+			char name[64];
+			std::snprintf(name,
+			              sizeof(name),
+			              "rx %4d-byte frames, %2d per tick",
+			              frame_size,
+			              frames_per_tick);
+			report(name,
+			       received_frames,
+			       received_bytes,
+			       connection->dropped_frames,
+			       elapsed);
+		}
+	}
+}
+
+TEST_F(NE2000Benchmark, TransmitThroughput)
+{
+	for (const auto frame_size : {MinFrameSize, MaxFrameSize}) {
+		const auto sent_frames_before = connection->sent_frames;
+		const auto sent_bytes_before  = connection->sent_bytes;
+
+		std::vector<uint8_t> frame = {};
+
+		const auto start = std::chrono::steady_clock::now();
+		for (auto i = 0; i < num_frames; ++i) {
+			frame = make_frame(frame_size, i);
+			SendFrame(frame);
+			WaitForTransmit();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		EXPECT_EQ(connection->last_sent_frame, frame);
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "tx %4d-byte frames", frame_size);
+		report(name,
+		       connection->sent_frames - sent_frames_before,
+		       connection->sent_bytes - sent_bytes_before,
+		       0,
+		       elapsed);
+	}
+}
+
+} // namespace
+
+#endif // C_SLIRP
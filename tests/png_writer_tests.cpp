@@ -0,0 +1,250 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "../src/capture/image/image_scaler.h"
+#include "../src/capture/image/png_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <png.h>
+#include <zlib.h>
+
+namespace {
+
+// Enough threads for several bands, whatever the machine
+constexpr unsigned NumThreads = 4;
+
+struct TestImage {
+	std::vector<uint8_t> pixels  = {};
+	std::vector<uint8_t> palette = {};
+
+	RenderedImage image = {};
+};
+
+void make_test_image(TestImage& test_image, const uint16_t width,
+                     const uint16_t height, const Fraction& pixel_aspect_ratio)
+{
+	test_image.pixels.resize(static_cast<size_t>(width) * height);
+	for (auto y = 0; y < height; ++y) {
+		for (auto x = 0; x < width; ++x) {
+			const auto dither = ((x ^ y) & 1) * 16;
+			test_image.pixels[y * width + x] = static_cast<uint8_t>(
+			        (x / 8 + y / 4 + dither) & 0xff);
+		}
+	}
+
+	test_image.palette.resize(256 * 4);
+	for (auto i = 0; i < 256; ++i) {
+		test_image.palette[i * 4 + 0] = static_cast<uint8_t>(i);
+		test_image.palette[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+		test_image.palette[i * 4 + 2] = static_cast<uint8_t>(i * 3);
+	}
+
+	auto& image = test_image.image;
+
+	image.params.width              = width;
+	image.params.height             = height;
+	image.params.pixel_aspect_ratio = pixel_aspect_ratio;
+	image.params.pixel_format       = PixelFormat::Indexed8;
+
+	image.params.video_mode.width              = width;
+	image.params.video_mode.height             = height;
+	image.params.video_mode.pixel_aspect_ratio = pixel_aspect_ratio;
+	image.params.video_mode.is_graphics_mode   = true;
+
+	image.pitch        = width;
+	image.image_data   = test_image.pixels.data();
+	image.palette_data = test_image.palette.data();
+}
+
+enum class WriteMode { Serial, InBands };
+
+void write_upscaled_png(FILE* outfile, const RenderedImage& image,
+                        const WriteMode mode)
+{
+	PngWriter png_writer     = {};
+	ImageScaler image_scaler = {};
+	image_scaler.Init(image);
+
+	const auto width  = image_scaler.GetOutputWidth();
+	const auto height = image_scaler.GetOutputHeight();
+
+	if (image_scaler.GetOutputPixelFormat() == OutputPixelFormat::Indexed8) {
+		ASSERT_TRUE(png_writer.InitIndexed8(outfile,
+		                                    width,
+		                                    height,
+		                                    Fraction{1},
+		                                    image.params.video_mode,
+		                                    image.palette_data));
+	} else {
+		ASSERT_TRUE(png_writer.InitRgb888(
+		        outfile, width, height, Fraction{1}, image.params.video_mode));
+	}
+
+	if (mode == WriteMode::Serial) {
+		auto rows_to_write = height;
+		while (rows_to_write--) {
+			png_writer.WriteRow(image_scaler.GetNextOutputRow());
+		}
+	} else {
+		png_writer.WriteScaledRowsInBands(image,
+		                                  image_scaler.GetOutputRowsPerInputRow(),
+		                                  NumThreads);
+	}
+}
+
+std::vector<uint8_t> get_upscaled_png(const RenderedImage& image,
+                                      const WriteMode mode)
+{
+	FILE* outfile = std::tmpfile();
+	EXPECT_NE(outfile, nullptr);
+	if (!outfile) {
+		return {};
+	}
+
+	// The PNG is complete once the writer has gone out of scope
+	write_upscaled_png(outfile, image, mode);
+
+	std::vector<uint8_t> contents(static_cast<size_t>(std::ftell(outfile)));
+	std::rewind(outfile);
+	EXPECT_EQ(std::fread(contents.data(), 1, contents.size(), outfile),
+	          contents.size());
+	std::fclose(outfile);
+	return contents;
+}
+
+uint32_t read_be32(const uint8_t* data)
+{
+	return (static_cast<uint32_t>(data[0]) << 24) |
+	       (static_cast<uint32_t>(data[1]) << 16) |
+	       (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+// Returns the concatenated data of all IDAT chunks and their count
+std::vector<uint8_t> get_image_data(const std::vector<uint8_t>& png,
+                                    int& num_idat_chunks)
+{
+	constexpr size_t SignatureSize = 8;
+
+	std::vector<uint8_t> data = {};
+	num_idat_chunks           = 0;
+
+	size_t pos = SignatureSize;
+	while (pos + 12 <= png.size()) {
+		const auto length = read_be32(&png[pos]);
+		const auto type   = &png[pos + 4];
+		const auto start  = png.begin() + static_cast<ptrdiff_t>(pos + 8);
+
+		if (std::equal(type, type + 4, "IDAT")) {
+			data.insert(data.end(), start, start + length);
+			++num_idat_chunks;
+		}
+		pos += 12 + length;
+	}
+	EXPECT_EQ(pos, png.size());
+	return data;
+}
+
+std::vector<uint8_t> decode_png(const std::vector<uint8_t>& png,
+                                png_uint_32& width, png_uint_32& height)
+{
+	png_image decoded = {};
+	decoded.version   = PNG_IMAGE_VERSION;
+
+	EXPECT_TRUE(png_image_begin_read_from_memory(&decoded, png.data(), png.size()));
+	decoded.format = PNG_FORMAT_RGB;
+
+	std::vector<uint8_t> pixels(PNG_IMAGE_SIZE(decoded));
+	EXPECT_TRUE(png_image_finish_read(
+	        &decoded, nullptr, pixels.data(), 0, nullptr));
+	EXPECT_EQ(decoded.warning_or_error, 0u) << decoded.message;
+
+	width  = decoded.width;
+	height = decoded.height;
+	return pixels;
+}
+
+void check_banded_png(const RenderedImage& image)
+{
+	const auto serial_png = get_upscaled_png(image, WriteMode::Serial);
+	const auto banded_png = get_upscaled_png(image, WriteMode::InBands);
+
+	// The bands are written as a single IDAT chunk holding one zlib
+	// stream, which inflates with a valid Adler-32 trailer
+	int num_idat_chunks  = 0;
+	const auto zlib_data = get_image_data(banded_png, num_idat_chunks);
+	EXPECT_EQ(num_idat_chunks, 1);
+
+	// Every band but the last one ends with a sync flush marker
+	constexpr uint8_t SyncFlushMarker[] = {0x00, 0x00, 0xff, 0xff};
+
+	auto num_markers = 0;
+	for (auto it = zlib_data.begin();
+	     (it = std::search(it,
+	                       zlib_data.end(),
+	                       std::begin(SyncFlushMarker),
+	                       std::end(SyncFlushMarker))) != zlib_data.end();
+	     ++it) {
+		++num_markers;
+	}
+	EXPECT_GE(num_markers, 2);
+
+	png_uint_32 width  = 0;
+	png_uint_32 height = 0;
+
+	const auto serial_pixels = decode_png(serial_png, width, height);
+	const auto banded_pixels = decode_png(banded_png, width, height);
+
+	std::vector<uint8_t> inflated(serial_pixels.size() + height);
+	auto inflated_size = static_cast<uLongf>(inflated.size());
+	ASSERT_EQ(uncompress(inflated.data(),
+	                     &inflated_size,
+	                     zlib_data.data(),
+	                     static_cast<uLong>(zlib_data.size())),
+	          Z_OK);
+
+	ASSERT_FALSE(serial_pixels.empty());
+	EXPECT_EQ(banded_pixels, serial_pixels);
+}
+
+TEST(png_writer, banded_indexed_png_matches_serial)
+{
+	// Integer upscaling, written as a paletted PNG (320x200 to 1600x1200)
+	TestImage mode_13h = {};
+	make_test_image(mode_13h, 320, 200, Fraction{5, 6});
+
+	check_banded_png(mode_13h.image);
+}
+
+TEST(png_writer, banded_rgb_png_matches_serial)
+{
+	// Sharp-bilinear upscaling, written as an RGB PNG (640x350 to 1400x1050)
+	TestImage ega_350 = {};
+	make_test_image(ega_350, 640, 350, Fraction{35, 48});
+
+	check_banded_png(ega_350.image);
+}
+
+} // namespace
@@ -0,0 +1,166 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Measures the throughput of the mutex-based RW Queue versus its lock-free
+// SPSC variant, with a producer and a consumer thread passing items in the
+// patterns of the unit tests.
+// Run with: meson test --benchmark -C <build-dir> --verbose
+
+#include "rwqueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr int num_items = 4'000'000;
+
+void report(const char* name, const std::chrono::steady_clock::duration elapsed)
+{
+	const auto seconds = std::chrono::duration<double>(elapsed).count();
+	std::printf("%-44s %8.1f M items/s\n", name, num_items / seconds / 1'000'000);
+}
+
+template <typename Producer, typename Consumer>
+void measure(const char* name, Producer&& produce, Consumer&& consume)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::thread producer(produce);
+	consume();
+	producer.join();
+
+	report(name, std::chrono::steady_clock::now() - start);
+}
+
+// Single items, like the MIDI work FIFO
+void single_items(const size_t queue_capacity)
+{
+	char name[64] = {};
+
+	RWQueue<int> rw_queue(queue_capacity);
+	std::snprintf(name, sizeof(name), "RWQueue, singles, capacity %zu", queue_capacity);
+	measure(
+	        name,
+	        [&] {
+		        for (int i = 0; i < num_items; ++i) {
+			        rw_queue.Enqueue(std::move(i));
+		        }
+	        },
+	        [&] {
+		        for (int i = 0; i < num_items; ++i) {
+			        ASSERT_EQ(*rw_queue.Dequeue(), i);
+		        }
+	        });
+
+	SpscRWQueue<int> spsc_queue(queue_capacity);
+	std::snprintf(name, sizeof(name), "SpscRWQueue, singles, capacity %zu", queue_capacity);
+	measure(
+	        name,
+	        [&] {
+		        for (int i = 0; i < num_items; ++i) {
+			        spsc_queue.Enqueue(std::move(i));
+		        }
+	        },
+	        [&] {
+		        for (int i = 0; i < num_items; ++i) {
+			        ASSERT_EQ(*spsc_queue.Dequeue(), i);
+		        }
+	        });
+}
+
+// Bulk transfers, like a synth rendering audio frames in small runs for the
+// mixer pulling them in larger blocks
+void bulk_items(const size_t queue_capacity, const size_t num_per_enqueue,
+                const size_t num_per_dequeue)
+{
+	char name[64] = {};
+
+	RWQueue<int> rw_queue(queue_capacity);
+	std::snprintf(name,
+	              sizeof(name),
+	              "RWQueue, bulk %zu -> %zu, capacity %zu",
+	              num_per_enqueue,
+	              num_per_dequeue,
+	              queue_capacity);
+	measure(
+	        name,
+	        [&] {
+		        std::vector<int> items = {};
+		        for (int i = 0; i < num_items;) {
+			        items.resize(num_per_enqueue);
+			        for (auto& item : items) {
+				        item = i++;
+			        }
+			        rw_queue.BulkEnqueue(items, num_per_enqueue);
+		        }
+	        },
+	        [&] {
+		        std::vector<int> items = {};
+		        for (int i = 0; i < num_items;) {
+			        rw_queue.BulkDequeue(items, num_per_dequeue);
+			        ASSERT_EQ(items.front(), i);
+			        i += static_cast<int>(num_per_dequeue);
+		        }
+	        });
+
+	SpscRWQueue<int> spsc_queue(queue_capacity);
+	std::snprintf(name,
+	              sizeof(name),
+	              "SpscRWQueue, bulk %zu -> %zu, capacity %zu",
+	              num_per_enqueue,
+	              num_per_dequeue,
+	              queue_capacity);
+	measure(
+	        name,
+	        [&] {
+		        std::vector<int> items(num_per_enqueue);
+		        for (int i = 0; i < num_items;) {
+			        for (auto& item : items) {
+				        item = i++;
+			        }
+			        spsc_queue.BulkEnqueue(items);
+		        }
+	        },
+	        [&] {
+		        std::vector<int> items(num_per_dequeue);
+		        for (int i = 0; i < num_items;) {
+			        spsc_queue.BulkDequeue(items);
+			        ASSERT_EQ(items.front(), i);
+			        i += static_cast<int>(num_per_dequeue);
+		        }
+	        });
+}
+
+TEST(rwqueue_benchmark, throughput)
+{
+	single_items(8);
+	single_items(10'420);
+
+	bulk_items(1'920, 1, 64);
+	bulk_items(1'920, 64, 64);
+	bulk_items(1'920, 256, 100);
+}
+
+} // namespace
@@ -556,4 +556,179 @@ TEST(RWQueue, StopBulkMidway)
 	EXPECT_TRUE(items.empty());
 }
 
+// SPSC RW Queue
+// ~~~~~~~~~~~~~
+
+TEST(SpscRWQueue, TrivialSerial)
+{
+	SpscRWQueue<int> q(65);
+	for (int iteration = 0; iteration != 128;
+	     ++iteration) { // check there's no problem with mismatch
+		            // between nominal and allocated capacity
+		EXPECT_EQ(q.MaxCapacity(), 65);
+		EXPECT_EQ(q.Size(), 0);
+		EXPECT_TRUE(q.IsEmpty());
+		for (int i = 0; i != 65; ++i)
+			q.Enqueue(std::move(i));
+		EXPECT_EQ(q.Size(), 65);
+
+		for (int i = 0; i != 65; ++i) {
+			const auto item = q.Dequeue();
+			EXPECT_EQ(*item, i);
+		}
+		EXPECT_TRUE(q.IsEmpty());
+	}
+}
+
+TEST(SpscRWQueue, NonblockingBulkStopsWhenFullOrEmpty)
+{
+	SpscRWQueue<int> q(5);
+
+	std::vector<int> items = {1, 2, 3, 4, 5, 6, 7};
+	EXPECT_EQ(q.NonblockingBulkEnqueue(items), 5);
+	EXPECT_EQ(q.GetPercentFull(), 100.0f);
+
+	std::vector<int> dequeued(7);
+	EXPECT_EQ(q.NonblockingBulkDequeue(dequeued), 5);
+	EXPECT_TRUE(q.IsEmpty());
+
+	const std::vector<int> expected_items = {1, 2, 3, 4, 5};
+	dequeued.resize(5);
+	EXPECT_EQ(dequeued, expected_items);
+}
+
+TEST(SpscRWQueue, ContainerMoveAsync)
+{
+	SpscRWQueue<container_t> q(8);
+
+	std::thread writer([&] {
+		for (int i = 0; i != iterations; ++i) {
+			container_t item(3, static_cast<int16_t>(i));
+			q.Enqueue(std::move(item));
+		}
+	});
+	for (int i = 0; i != iterations; ++i) {
+		const auto item = q.Dequeue();
+		ASSERT_EQ(item->size(), 3);
+		EXPECT_EQ(item->front(), static_cast<int16_t>(i));
+	}
+	writer.join();
+	EXPECT_TRUE(q.IsEmpty());
+}
+
+void spsc_bulk_enqueue(SpscRWQueue<int>& q, const size_t total_to_enqueue,
+                       const size_t num_per_bulk_enqueue)
+{
+	std::vector<int> items(num_per_bulk_enqueue);
+
+	size_t num_enqueued = 0;
+	while (num_enqueued < total_to_enqueue) {
+		const auto num_items = std::min(total_to_enqueue - num_enqueued,
+		                                num_per_bulk_enqueue);
+		for (size_t i = 0; i < num_items; ++i) {
+			items[i] = static_cast<int>(num_enqueued + i);
+		}
+		EXPECT_TRUE(q.BulkEnqueue({items.data(), num_items}));
+		num_enqueued += num_items;
+	}
+}
+
+void spsc_bulk_dequeue(SpscRWQueue<int>& q, const size_t total_to_dequeue,
+                       const size_t num_per_bulk_dequeue)
+{
+	std::vector<int> items(num_per_bulk_dequeue);
+
+	size_t num_dequeued = 0;
+	while (num_dequeued < total_to_dequeue) {
+		const auto num_items = std::min(total_to_dequeue - num_dequeued,
+		                                num_per_bulk_dequeue);
+
+		EXPECT_EQ(q.BulkDequeue({items.data(), num_items}), num_items);
+
+		for (size_t i = 0; i < num_items; ++i) {
+			EXPECT_EQ(items[i], static_cast<int>(num_dequeued + i));
+		}
+		num_dequeued += num_items;
+	}
+}
+
+TEST(SpscRWQueue, AsyncBulkIO)
+{
+	for (const auto& [queue_capacity,
+	                  num_per_bulk_enqueue,
+	                  num_per_bulk_dequeue,
+	                  total_to_queue] : {
+
+	             bulk_params_t{1, 1, 1, 50},
+	             bulk_params_t{50, 1, 1, 242},
+	             bulk_params_t{10, 10, 10, 50},
+	             bulk_params_t{10, 3, 10, 50},
+	             bulk_params_t{10, 10, 3, 50},
+
+	             // requests larger than the queue
+	             bulk_params_t{3, 100, 3, 340},
+	             bulk_params_t{4, 10, 30, 97},
+	             bulk_params_t{7, 50, 50, 1000},
+
+	     }) {
+		SpscRWQueue<int> q(queue_capacity);
+
+		std::thread writer(spsc_bulk_enqueue,
+		                   std::ref(q),
+		                   total_to_queue,
+		                   num_per_bulk_enqueue);
+		std::thread reader(spsc_bulk_dequeue,
+		                   std::ref(q),
+		                   total_to_queue,
+		                   num_per_bulk_dequeue);
+		writer.join();
+		reader.join();
+
+		EXPECT_TRUE(q.IsEmpty());
+	}
+}
+
+TEST(SpscRWQueue, StopUnblocksBothSides)
+{
+	SpscRWQueue<int> empty_q(4);
+	std::thread reader([&] { EXPECT_FALSE(empty_q.Dequeue().has_value()); });
+
+	SpscRWQueue<int> full_q(1);
+	full_q.Enqueue(1);
+	std::thread writer([&] { EXPECT_FALSE(full_q.Enqueue(2)); });
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	empty_q.Stop();
+	full_q.Stop();
+
+	reader.join();
+	writer.join();
+}
+
+TEST(SpscRWQueue, StopBulkMidway)
+{
+	SpscRWQueue<int> q(8);
+
+	std::vector<int> items = {1, 2, 3, 4, 5};
+	EXPECT_TRUE(q.BulkEnqueue(items));
+	EXPECT_EQ(q.Size(), 5);
+
+	q.Stop();
+
+	// Bulking enqueuing fails after being stopped
+	items = {6, 7};
+	EXPECT_FALSE(q.BulkEnqueue(items));
+	EXPECT_FALSE(q.IsRunning());
+	EXPECT_EQ(q.Size(), 5);
+
+	// But the queued items can still be dequeued, even when over-requested
+	items.resize(10);
+	EXPECT_EQ(q.BulkDequeue(items), 5);
+	EXPECT_EQ(items[0], 1);
+	EXPECT_EQ(items[4], 5);
+
+	EXPECT_EQ(q.BulkDequeue(items), 0);
+	EXPECT_FALSE(q.Dequeue().has_value());
+}
+
 } // namespace
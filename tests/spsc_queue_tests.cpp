@@ -0,0 +1,199 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_queue.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(SpscQueue, EmptyHasNoFront)
+{
+	SpscQueue<int, 4> queue = {};
+	EXPECT_TRUE(queue.IsEmpty());
+	EXPECT_EQ(queue.Front(), nullptr);
+}
+
+TEST(SpscQueue, FirstInFirstOut)
+{
+	SpscQueue<int, 4> queue = {};
+
+	for (int i = 1; i <= 3; ++i) {
+		auto slot = queue.GetWriteSlot();
+		ASSERT_NE(slot, nullptr);
+		*slot = i;
+		queue.Push();
+	}
+	EXPECT_EQ(queue.Size(), 3);
+
+	for (int i = 1; i <= 3; ++i) {
+		auto item = queue.Front();
+		ASSERT_NE(item, nullptr);
+		EXPECT_EQ(*item, i);
+		queue.Pop();
+	}
+	EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SpscQueue, NoSlotWhenFull)
+{
+	SpscQueue<int, 4> queue = {};
+
+	for (size_t i = 0; i < queue.GetCapacity(); ++i) {
+		ASSERT_NE(queue.GetWriteSlot(), nullptr);
+		queue.Push();
+	}
+	EXPECT_EQ(queue.GetWriteSlot(), nullptr);
+
+	queue.Pop();
+	EXPECT_NE(queue.GetWriteSlot(), nullptr);
+}
+
+TEST(SpscQueue, WrapsAround)
+{
+	SpscQueue<int, 4> queue = {};
+
+	for (int i = 0; i < 100; ++i) {
+		*queue.GetWriteSlot() = i;
+		queue.Push();
+		*queue.GetWriteSlot() = i + 1000;
+		queue.Push();
+
+		EXPECT_EQ(*queue.Front(), i);
+		queue.Pop();
+		EXPECT_EQ(*queue.Front(), i + 1000);
+		queue.Pop();
+	}
+	EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SpscQueue, ConcurrentItemsArriveInOrder)
+{
+	constexpr int NumItems = 200000;
+
+	SpscQueue<std::array<int, 16>, 64> queue = {};
+
+	std::thread producer([&] {
+		for (int i = 1; i <= NumItems; ++i) {
+			std::array<int, 16>* slot = nullptr;
+			while ((slot = queue.GetWriteSlot()) == nullptr) {
+				std::this_thread::yield();
+			}
+			slot->fill(i);
+			queue.Push();
+		}
+	});
+
+	int expected = 1;
+	while (expected <= NumItems) {
+		const auto item = queue.Front();
+		if (!item) {
+			std::this_thread::yield();
+			continue;
+		}
+		for (const auto value : *item) {
+			ASSERT_EQ(value, expected);
+		}
+		queue.Pop();
+		++expected;
+	}
+	producer.join();
+}
+
+TEST(SpscRingBuffer, WritesOnlyWhatFits)
+{
+	SpscRingBuffer<uint8_t, 8> ring = {};
+
+	const uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	EXPECT_EQ(ring.Write(data, 5), 5);
+	EXPECT_EQ(ring.Write(data + 5, 5), 3);
+	EXPECT_EQ(ring.GetFreeSpace(), 0);
+
+	uint8_t out[10] = {};
+	EXPECT_EQ(ring.Read(out, 10), 8);
+	for (int i = 0; i < 8; ++i) {
+		EXPECT_EQ(out[i], data[i]);
+	}
+	EXPECT_TRUE(ring.IsEmpty());
+	EXPECT_EQ(ring.Read(out, 10), 0);
+}
+
+TEST(SpscRingBuffer, RunsWrapAround)
+{
+	SpscRingBuffer<uint8_t, 8> ring = {};
+
+	uint8_t next_in  = 0;
+	uint8_t next_out = 0;
+
+	for (int i = 0; i < 100; ++i) {
+		uint8_t data[5] = {};
+		for (auto& value : data) {
+			value = next_in++;
+		}
+		ASSERT_EQ(ring.Write(data, 5), 5);
+
+		uint8_t out[5] = {};
+		ASSERT_EQ(ring.Read(out, 5), 5);
+		for (const auto value : out) {
+			EXPECT_EQ(value, next_out++);
+		}
+	}
+}
+
+TEST(SpscRingBuffer, ConcurrentBytesArriveInOrder)
+{
+	constexpr size_t NumBytes = 200000;
+
+	SpscRingBuffer<uint8_t, 256> ring = {};
+
+	std::thread producer([&] {
+		std::vector<uint8_t> data(97);
+		size_t written = 0;
+		while (written < NumBytes) {
+			const auto num_bytes = std::min(data.size(),
+			                                NumBytes - written);
+			for (size_t i = 0; i < num_bytes; ++i) {
+				data[i] = static_cast<uint8_t>(written + i);
+			}
+			size_t pos = 0;
+			while (pos < num_bytes) {
+				pos += ring.Write(data.data() + pos, num_bytes - pos);
+			}
+			written += num_bytes;
+		}
+	});
+
+	size_t num_read = 0;
+	uint8_t out[61] = {};
+	while (num_read < NumBytes) {
+		const auto count = ring.Read(out, sizeof(out));
+		for (size_t i = 0; i < count; ++i) {
+			ASSERT_EQ(out[i], static_cast<uint8_t>(num_read + i));
+		}
+		num_read += count;
+	}
+	producer.join();
+}
+
+} // namespace
@@ -0,0 +1,99 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "triple_buffer.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(TripleBuffer, NothingPublished)
+{
+	TripleBuffer<int> buffer = {};
+	EXPECT_FALSE(buffer.Update());
+}
+
+TEST(TripleBuffer, ReadsLatestPublished)
+{
+	TripleBuffer<int> buffer = {};
+
+	for (int i = 1; i <= 3; ++i) {
+		buffer.GetWriteBuffer() = i;
+		buffer.Publish();
+	}
+	ASSERT_TRUE(buffer.Update());
+	EXPECT_EQ(buffer.GetReadBuffer(), 3);
+
+	// The same value isn't handed out twice
+	EXPECT_FALSE(buffer.Update());
+	EXPECT_EQ(buffer.GetReadBuffer(), 3);
+}
+
+TEST(TripleBuffer, WriterNeverGetsReadBuffer)
+{
+	TripleBuffer<int> buffer = {};
+
+	buffer.GetWriteBuffer() = 1;
+	buffer.Publish();
+	ASSERT_TRUE(buffer.Update());
+
+	// Overwriting everything the writer can reach leaves the read value
+	for (int i = 2; i <= 10; ++i) {
+		buffer.GetWriteBuffer() = i;
+		buffer.Publish();
+		EXPECT_EQ(buffer.GetReadBuffer(), 1);
+	}
+	ASSERT_TRUE(buffer.Update());
+	EXPECT_EQ(buffer.GetReadBuffer(), 10);
+}
+
+TEST(TripleBuffer, ConcurrentValuesOnlyIncrease)
+{
+	constexpr int NumValues = 200000;
+
+	TripleBuffer<std::array<int, 16>> buffer = {};
+
+	std::thread writer([&] {
+		for (int i = 1; i <= NumValues; ++i) {
+			buffer.GetWriteBuffer().fill(i);
+			buffer.Publish();
+		}
+	});
+
+	int last_value = 0;
+	while (last_value < NumValues) {
+		if (!buffer.Update()) {
+			continue;
+		}
+		const auto& values = buffer.GetReadBuffer();
+
+		// A value is never torn nor older than the previous one
+		for (const auto value : values) {
+			ASSERT_EQ(value, values[0]);
+		}
+		ASSERT_GT(values[0], last_value);
+		last_value = values[0];
+	}
+	writer.join();
+}
+
+} // namespace
@@ -0,0 +1,150 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/voodoo_texel.h"
+
+#include <cstdlib>
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(VoodooTexel, DecodeRgb565)
+{
+	EXPECT_EQ(decode_rgb565(0x0000), 0xff000000);
+	EXPECT_EQ(decode_rgb565(0xffff), 0xffffffff);
+	EXPECT_EQ(decode_rgb565(0xf800), 0xffff0000);
+	EXPECT_EQ(decode_rgb565(0x07e0), 0xff00ff00);
+	EXPECT_EQ(decode_rgb565(0x001f), 0xff0000ff);
+}
+
+TEST(VoodooTexel, DecodeArgb1555)
+{
+	EXPECT_EQ(decode_argb1555(0x0000), 0x00000000);
+	EXPECT_EQ(decode_argb1555(0x8000), 0xff000000);
+	EXPECT_EQ(decode_argb1555(0x7c00), 0x00ff0000);
+	EXPECT_EQ(decode_argb1555(0x03e0), 0x0000ff00);
+	EXPECT_EQ(decode_argb1555(0x001f), 0x000000ff);
+}
+
+TEST(VoodooTexel, DecodeArgb4444)
+{
+	EXPECT_EQ(decode_argb4444(0x0000), 0x00000000);
+	EXPECT_EQ(decode_argb4444(0xf000), 0xff000000);
+	EXPECT_EQ(decode_argb4444(0x0a00), 0x00aa0000);
+	EXPECT_EQ(decode_argb4444(0x0050), 0x00005500);
+	EXPECT_EQ(decode_argb4444(0x0003), 0x00000033);
+}
+
+TEST(VoodooTexel, BilinearScalarCorners)
+{
+	constexpr voodoo_argb_t rgb00 = 0x11223344;
+	constexpr voodoo_argb_t rgb01 = 0x55667788;
+	constexpr voodoo_argb_t rgb10 = 0x99aabbcc;
+	constexpr voodoo_argb_t rgb11 = 0xddeeff00;
+
+	// Zero fractions select the top-left texel
+	EXPECT_EQ(rgba_bilinear_filter_scalar(rgb00, rgb01, rgb10, rgb11, 0, 0), rgb00);
+
+	// A uniform footprint stays unchanged at any fraction
+	EXPECT_EQ(rgba_bilinear_filter_scalar(rgb01, rgb01, rgb01, rgb01, 0x80, 0x40),
+	          rgb01);
+}
+
+#if defined(__SSE2__)
+
+voodoo_argb_t to_argb(const __m128i val, const int lane)
+{
+	alignas(16) voodoo_argb_t lanes[4] = {};
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), val);
+	return lanes[lane];
+}
+
+// Every 16-bit texel must decode identically on the SIMD and scalar paths
+TEST(VoodooTexel, DecodeSimdMatchesScalar)
+{
+	for (const auto format : {TexelRgb565, TexelArgb1555, TexelArgb4444}) {
+		for (uint32_t val = 0; val < 0x10000; val += 4) {
+			const auto decoded = decode_texel16_x4(
+			        format,
+			        _mm_setr_epi32(static_cast<int>(val),
+			                       static_cast<int>(val + 1),
+			                       static_cast<int>(val + 2),
+			                       static_cast<int>(val + 3)));
+			for (int lane = 0; lane < 4; ++lane) {
+				const auto texel = static_cast<uint16_t>(val + lane);
+				ASSERT_EQ(to_argb(decoded, lane),
+				          decode_texel16(format, texel))
+				        << "format " << static_cast<int>(format)
+				        << ", texel " << texel;
+			}
+		}
+	}
+}
+
+TEST(VoodooTexel, BilinearSimdCorners)
+{
+	constexpr voodoo_argb_t rgb00 = 0x11223344;
+	constexpr voodoo_argb_t rgb01 = 0x55667788;
+	constexpr voodoo_argb_t rgb10 = 0x99aabbcc;
+	constexpr voodoo_argb_t rgb11 = 0xddeeff00;
+
+	const auto texels = _mm_setr_epi32(static_cast<int>(rgb00),
+	                                   static_cast<int>(rgb01),
+	                                   static_cast<int>(rgb10),
+	                                   static_cast<int>(rgb11));
+
+	EXPECT_EQ(rgba_bilinear_filter_x4(texels, 0, 0), rgb00);
+}
+
+// The SIMD filter keeps one less fractional bit between the horizontal and
+// vertical passes, so it may differ from the scalar path by one step per
+// channel, but never more.
+TEST(VoodooTexel, BilinearSimdMatchesScalar)
+{
+	std::mt19937 rng(0x3df);
+
+	for (int i = 0; i < 200000; ++i) {
+		const voodoo_argb_t rgb00 = rng();
+		const voodoo_argb_t rgb01 = rng();
+		const voodoo_argb_t rgb10 = rng();
+		const voodoo_argb_t rgb11 = rng();
+		const auto u = static_cast<uint8_t>(rng());
+		const auto v = static_cast<uint8_t>(rng());
+
+		const auto simd = rgba_bilinear_filter(rgb00, rgb01, rgb10, rgb11, u, v);
+		const auto scalar = rgba_bilinear_filter_scalar(rgb00, rgb01, rgb10, rgb11, u, v);
+
+		for (int shift = 0; shift < 32; shift += 8) {
+			const int simd_channel   = (simd >> shift) & 0xff;
+			const int scalar_channel = (scalar >> shift) & 0xff;
+			ASSERT_LE(std::abs(simd_channel - scalar_channel), 1)
+			        << std::hex << "texels " << rgb00 << ' ' << rgb01
+			        << ' ' << rgb10 << ' ' << rgb11 << std::dec
+			        << ", u " << static_cast<int>(u) << ", v "
+			        << static_cast<int>(v);
+		}
+	}
+}
+
+#endif // __SSE2__
+
+} // namespace